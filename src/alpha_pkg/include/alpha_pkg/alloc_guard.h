@@ -0,0 +1,49 @@
+/************************************************************
+ * Name: alloc_guard.h
+
+ * Description: Debug hook that checks the perception hot path
+ 				does not touch the heap. When the package is
+ 				configured with -DALPHA_PKG_ALLOC_GUARD=ON, the
+ 				global operator new is replaced by a counting
+ 				version and ALPHA_PKG_NO_ALLOC_SCOPE() aborts if
+ 				anything allocates inside the enclosing block
+ 				once the warm-up frames are over.
+
+ 				In normal builds the macro expands to nothing.
+ ************************************************************/
+
+#ifndef ALPHA_PKG_ALLOC_GUARD_H
+#define ALPHA_PKG_ALLOC_GUARD_H
+
+#ifdef ALPHA_PKG_ALLOC_GUARD
+
+#include <stddef.h>
+
+namespace alpha_pkg {
+
+class NoAllocScope {
+public:
+	// `site` names the scope in the failure message, `warmup` is the
+	// number of entries into this site that are allowed to allocate
+	NoAllocScope(const char* site, unsigned& entries, unsigned warmup);
+	~NoAllocScope();
+
+private:
+	const char* site_;
+	bool armed_;
+	size_t start_count_;
+};
+
+} // namespace alpha_pkg
+
+#define ALPHA_PKG_NO_ALLOC_SCOPE(site) \
+	static unsigned alpha_pkg_alloc_entries_ = 0; \
+	alpha_pkg::NoAllocScope alpha_pkg_no_alloc_scope_(site, alpha_pkg_alloc_entries_, 5)
+
+#else
+
+#define ALPHA_PKG_NO_ALLOC_SCOPE(site) ((void)0)
+
+#endif // ALPHA_PKG_ALLOC_GUARD
+
+#endif // ALPHA_PKG_ALLOC_GUARD_H
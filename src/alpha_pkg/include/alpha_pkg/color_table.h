@@ -0,0 +1,97 @@
+/************************************************************
+ * Name: color_table.h
+
+ * Description: Color classes of a cmvision colors.txt file and
+ 				the YUV lookup tables used to classify pixels.
+
+ 				File format, as read by cmvision:
+
+ 				[Colors]
+ 				(r, g, b) merge expected_blobs name
+ 				...
+ 				[Thresholds]
+ 				(y_low:y_high, u_low:u_high, v_low:v_high)
+ 				...
+
+ 				The n-th threshold line belongs to the n-th
+ 				color. Each class owns one bit; a pixel's class
+ 				bits are y_class[Y] & u_class[U] & v_class[V],
+ 				and like cmvision the lowest set bit wins.
+ ************************************************************/
+
+#ifndef ALPHA_PKG_COLOR_TABLE_H
+#define ALPHA_PKG_COLOR_TABLE_H
+
+#include <string>
+#include <vector>
+#include <stdint.h>
+
+namespace alpha_pkg {
+
+const int kMaxColorClasses = 32;
+
+struct ColorClass {
+	std::string name;
+	uint8_t rgb[3];			// color reported in the blobs
+	float merge;
+	int expected_blobs;
+	uint8_t y_low, y_high;	// inclusive
+	uint8_t u_low, u_high;
+	uint8_t v_low, v_high;
+};
+
+/************************************************************
+ * Function Name: rgbToYuv
+
+ * Description: RGB to YUV with the coefficients of cmvision's
+ 				conversion, in 8.8 fixed point
+*************************************************************/
+
+inline void rgbToYuv(int r, int g, int b, int& y, int& u, int& v){
+	y = (66*r + 129*g + 25*b + 4096 + 128) >> 8;
+	u = (-38*r - 74*g + 112*b + 32768 + 128) >> 8;
+	v = (112*r - 94*g - 18*b + 32768 + 128) >> 8;
+}
+
+class ColorTable {
+public:
+	ColorTable();
+
+	bool load(const std::string& path, std::string& error);
+	bool parse(const std::string& text, std::string& error);
+	bool save(const std::string& path, std::string& error) const;
+
+	void clear();
+	bool addClass(const ColorClass& color);
+
+	size_t numClasses() const { return classes_.size(); }
+	const ColorClass& colorClass(size_t index) const { return classes_[index]; }
+
+	// Index of the class reported with this color, -1 if none
+	int find(const uint8_t* rgb) const;
+
+	// Index of the class called `name`, -1 if none
+	int findName(const std::string& name) const;
+
+	uint32_t classify(int y, int u, int v) const {
+		return y_class_[y] & u_class_[u] & v_class_[v];
+	}
+
+	uint32_t classifyRgb(int r, int g, int b) const {
+		int y, u, v;
+		rgbToYuv(r, g, b, y, u, v);
+		return classify(y, u, v);
+	}
+
+private:
+	void rebuild();
+
+	std::vector<ColorClass> classes_;
+	uint32_t y_class_[256];
+	uint32_t u_class_[256];
+	uint32_t v_class_[256];
+};
+
+} // namespace alpha_pkg
+
+#endif // ALPHA_PKG_COLOR_TABLE_H
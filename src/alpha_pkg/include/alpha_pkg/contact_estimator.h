@@ -0,0 +1,80 @@
+/************************************************************
+ * Name: contact_estimator.h
+
+ * Description: Time to contact per sector of the depth band,
+ 				from the change of the sector's near depth (see
+ 				DepthScan::sector_near_depth) between depth
+ 				frames. The change over the frame interval is
+ 				the closing speed; the robot's own forward speed
+ 				over the interval is taken off, so what is kept
+ 				(and smoothed) is the speed the obstacle itself
+ 				approaches at. The time to contact at any
+ 				forward speed v is then depth/(v + closing).
+
+ 				A level, forward-looking camera sees a static
+ 				obstacle come closer by exactly the distance
+ 				driven. Turning moves obstacles across sectors,
+ 				so frames taken while turning faster than
+ 				max_turn per frame are not compared, nor are
+ 				frames more than max_interval apart. A depth
+ 				step faster than max_speed is a different
+ 				obstacle taking over the sector and restarts its
+ 				estimate.
+ ************************************************************/
+
+#ifndef ALPHA_PKG_CONTACT_ESTIMATOR_H
+#define ALPHA_PKG_CONTACT_ESTIMATOR_H
+
+#include <alpha_pkg/perception.h>
+
+namespace alpha_pkg {
+
+struct ContactConfig {
+	float smoothing;			// weight of the newest closing speed
+	float max_speed;			// m/s, faster depth changes restart a sector
+	float max_turn;				// rad of turn between compared frames
+	float max_interval;			// s between compared frames
+	int first_sector;			// sectors in the robot's path
+	int last_sector;
+};
+
+// A fifth of the weight on the newest frame, people walk up to
+// 1.5 m/s, a third of a sector of turn, 0.5 s, the middle half of
+// the band (the 0.35 m wide base from about 0.6 m on)
+ContactConfig defaultContactConfig();
+
+class ContactEstimator {
+public:
+	explicit ContactEstimator(const ContactConfig& config);
+
+	void reset();
+
+	// Near depths of the depth frame stamped `stamp` (s), with the
+	// robot driving at `linear` (m/s) and turning at `angular`
+	// (rad/s) since the previous frame
+	void update(double stamp, const float* near_depth, float linear, float angular);
+
+	// Speed at which the obstacle of `sector` comes closer on its
+	// own, m/s, negative when it moves away
+	float closingSpeed(int sector) const { return closing_[sector]; }
+	float depth(int sector) const { return depth_[sector]; }
+
+	// At forward speed `linear`, +inf if not closing
+	float timeToContact(int sector, float linear) const;
+
+	// Sector of the path with the shortest time to contact at
+	// `linear`, -1 if none is closing
+	int nearestContact(float linear) const;
+
+private:
+	ContactConfig config_;
+	bool has_previous_;
+	double stamp_;
+	float depth_[kNumSectors];			// m, of the last frame
+	float closing_[kNumSectors];		// m/s, smoothed
+	bool tracked_[kNumSectors];			// closing_ has an estimate
+};
+
+} // namespace alpha_pkg
+
+#endif // ALPHA_PKG_CONTACT_ESTIMATOR_H
@@ -0,0 +1,130 @@
+/************************************************************
+ * Name: controller.h
+
+ * Description: State machine of the follower, free of ROS so
+ 				the node, the A/B harness and the simulator run
+ 				the same decisions.
+
+ 				States:
+ 				0. look around: rotate until the target is seen
+ 				1. seek: approach the target with P control
+ 				2. avoid: retreat/turn/advance after a bumper
+ 				   hit, rotate away from a depth obstacle
+ 				3. goal reached: stay forever
+
+ 				The avoidance maneuvers are timed phases. step()
+ 				returns the command of the current phase until
+ 				it expires, so the caller keeps spinning while a
+ 				maneuver runs.
+
+ 				With contact_time set, every forward command is
+ 				capped so the obstacle ahead (see
+ 				contact_estimator.h) stays at least contact_time
+ 				away: the robot slows down while it closes in,
+ 				before the depth obstacle is raised at min_z.
+
+ 				With wait_time set, a depth obstacle that is
+ 				moving (see motion_detector.h) stops the robot
+ 				in states 0 and 1 for up to wait_time, so a
+ 				person walking past is let through instead of
+ 				avoided; if it is still there then, or stops
+ 				moving, the robot avoids it as usual.
+ ************************************************************/
+
+#ifndef ALPHA_PKG_CONTROLLER_H
+#define ALPHA_PKG_CONTROLLER_H
+
+#include <string>
+#include <stdint.h>
+
+namespace alpha_pkg {
+
+struct ControllerConfig {
+	float linear_speed;			// m/s
+	float angular_speed;		// rad/s
+	float angular_speed_thresh;	// rad/s, limit of the seek turn rate
+	float seek_gain;			// P gain on goal_x, times angular_speed
+	float seek_speed_scale;		// fraction of linear_speed while seeking
+	float goal_reached_area;	// px, blob area that counts as arrived
+	float retreat_time;			// s, maneuver phases in state 2
+	float turn_time;
+	float advance_time;
+	float clear_advance_time;
+	float contact_time;			// s, slow down below this time to contact; 0 never
+	float wait_time;			// s, stopped for a moving obstacle; 0 never
+};
+
+// The values the node has always used
+ControllerConfig defaultControllerConfig();
+
+// Set the field named `key`, false if there is none
+bool setControllerParameter(ControllerConfig& config, const std::string& key, float value);
+
+// Read "key: value" lines (flat YAML) over `config`. Unknown keys
+// are an error so a typo does not silently compare defaults.
+bool loadControllerConfig(const std::string& path, ControllerConfig& config, std::string& error);
+
+struct ControllerInputs {
+	bool goal_found;
+	bool obstacle_found;
+	bool bumper;
+	uint32_t goal_area;			// px
+	float goal_x;				// px from the image center
+	float contact_depth;		// m, obstacle ahead, +inf if none
+	float contact_closing_speed;	// m/s, its own speed towards the robot
+	bool obstacle_moving;		// a sector with close points is moving
+};
+
+struct Command {
+	float linear;
+	float angular;
+};
+
+class Controller {
+public:
+	explicit Controller(const ControllerConfig& config);
+
+	// Run one control cycle at time `now` (s). Returns true and
+	// sets `command` if a velocity should be sent this cycle.
+	bool step(double now, const ControllerInputs& inputs, Command& command);
+
+	uint16_t state() const { return state_; }
+	bool maneuvering() const { return phase_ < num_phases_; }
+
+	// The last command was capped by contact_time
+	bool speedLimited() const { return speed_limited_; }
+
+	// The last command was a stop for a moving obstacle
+	bool waiting() const { return waiting_; }
+
+	const ControllerConfig& config() const { return config_; }
+	void setConfig(const ControllerConfig& config) { config_ = config; }
+
+private:
+	struct Phase {
+		Command command;
+		float duration;
+	};
+
+	bool decide(double now, const ControllerInputs& inputs, Command& command);
+	bool waitFor(double now, const ControllerInputs& inputs);
+	void rotate(Command& command) const;
+	void seek(const ControllerInputs& inputs, Command& command) const;
+	void startManeuver(double now);
+	void addPhase(float linear, float angular, float duration);
+
+	ControllerConfig config_;
+	uint16_t state_;
+
+	Phase phases_[3];
+	int num_phases_;
+	int phase_;
+	double phase_end_;
+	bool speed_limited_;
+	bool waiting_;
+	double wait_end_;			// <0 until an obstacle is waited for
+};
+
+} // namespace alpha_pkg
+
+#endif // ALPHA_PKG_CONTROLLER_H
@@ -0,0 +1,46 @@
+/************************************************************
+ * Name: debug_overlay.h
+
+ * Description: Annotated debug image of what the follower
+ 				perceives, drawn in the 640x480 pixel frame of
+ 				the camera so it lines up with the RGB image.
+ 				The obstacle band is shaded per sector by its
+ 				nearest depth (red near, green far, grey empty,
+ 				bright red below min_z), the columns holding
+ 				close points are marked in yellow, the nearest
+ 				depth of each column is plotted as a cyan
+ 				profile, the blobs are boxed in their color,
+ 				the goal centroid gets a magenta crosshair and
+ 				the state and close-point count are printed in
+ 				the top left corner.
+
+ 				The overlay only reads results the perception
+ 				stage already produced, it never scans a frame.
+ ************************************************************/
+
+#ifndef ALPHA_PKG_DEBUG_OVERLAY_H
+#define ALPHA_PKG_DEBUG_OVERLAY_H
+
+#include <alpha_pkg/perception.h>
+#include <stddef.h>
+#include <stdint.h>
+
+namespace alpha_pkg {
+
+struct OverlayFrame {
+	const DepthScan* scan;			// last depth result
+	const float* column_min_depth;	// kImageWidth depths, or NULL
+	float min_z;					// m, obstacle threshold
+	const BlobObservation* blobs;	// last blobs message
+	size_t num_blobs;
+	GoalEstimate goal;
+	int state;
+};
+
+// Draw `frame` over a kImageWidth x kImageHeight packed RGB8
+// image whose rows are `step` bytes apart
+void drawOverlay(const OverlayFrame& frame, uint8_t* rgb, size_t step);
+
+} // namespace alpha_pkg
+
+#endif // ALPHA_PKG_DEBUG_OVERLAY_H
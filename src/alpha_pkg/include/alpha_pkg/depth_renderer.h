@@ -0,0 +1,135 @@
+/************************************************************
+ * Name: depth_renderer.h
+
+ * Description: 2.5D ray caster producing the depth frames the
+ 				simulator feeds to the perception kernels. The
+ 				scene is a Scenario: vertical boxes and
+ 				cylinders standing on a flat floor, seen by a
+ 				level pinhole camera.
+
+ 				Every image column is one horizontal ray. When
+ 				the pose is set, each obstacle is intersected
+ 				with all rays; its hit columns are contiguous
+ 				and, per column, it covers the rows that see its
+ 				front face, at a constant depth, and the rows
+ 				that see its top, at the depth of a plane of its
+ 				height. Rendering a row then takes the floor
+ 				depth and, for each obstacle spanning that row,
+ 				a min/select over its columns only, in
+ 				structure-of-arrays form that the compiler turns
+ 				into SIMD code.
+
+ 				Depth is the camera z (optical axis), like the
+ 				organized cloud of the real sensor. Pixels with
+ 				no return, or outside [min_range, max_range],
+ 				are NaN (0 in the millimetre image).
+ ************************************************************/
+
+#ifndef ALPHA_PKG_DEPTH_RENDERER_H
+#define ALPHA_PKG_DEPTH_RENDERER_H
+
+#include <alpha_pkg/perception.h>
+#include <alpha_pkg/scenario.h>
+#include <vector>
+#include <stdint.h>
+
+namespace alpha_pkg {
+
+struct CameraModel {
+	float fx, fy, cx, cy;		// px
+	float height;				// optical center above the floor, m
+	float min_range, max_range;	// m, valid depth returns
+};
+
+CameraModel defaultCameraModel();
+
+struct DepthNoise {
+	float sigma_coeff;			// noise std. dev. is sigma_coeff*z^2, m
+	float dropout;				// probability of a NaN pixel
+	uint64_t seed;
+};
+
+/************************************************************
+ * Class Name: DepthRenderer
+
+ * Description: Renders rows of a kImageWidth wide depth image.
+ 				Call setScene() once, setPose() per frame, then
+ 				one of the render functions for the rows needed
+ 				(usually the obstacle band).
+*************************************************************/
+
+class DepthRenderer {
+public:
+	DepthRenderer(const CameraModel& camera, const DepthNoise& noise);
+
+	void setScene(const Scenario& scenario);
+
+	// Moves a cylinder of the scene, index -1 being the target
+	void moveCylinder(int index, float x, float y);
+
+	// heading: rad, 0 = +y, counter-clockwise
+	void setPose(float x, float y, float heading);
+
+	// z only, `rows` rows of kImageWidth floats; DepthView stride 1
+	void renderDepth(float* z, int first_row, int rows);
+
+	// x, y, z at the start of each `stride` floats, like a
+	// pcl::PointXYZ cloud (stride 4)
+	void renderPoints(float* points, size_t stride, int first_row, int rows);
+
+	// Millimetres, 0 for no return, like a 16UC1 depth image
+	void renderDepthImage(uint16_t* mm, int first_row, int rows);
+
+	// Surface seen by each pixel, for the color renderer: one of
+	// the constants below or kSurfaceObstacle + i for obstacle i,
+	// the boxes of the scenario in order, then the target, then
+	// the other cylinders. No range limits or noise.
+	void renderSurfaces(uint8_t* surfaces, int first_row, int rows);
+
+	static const uint8_t kSurfaceNone = 0;
+	static const uint8_t kSurfaceFloor = 1;
+	static const uint8_t kSurfaceObstacle = 2;
+
+	const CameraModel& camera() const { return camera_; }
+
+private:
+	// Screen footprint of one obstacle; its per-column data sits
+	// at `offset` in the span arrays, indexed by column - first_col
+	struct Span {
+		int first_col, last_col;		// columns, last exclusive
+		float first_row, last_row;		// rows, inclusive
+		float solid_first, solid_last;	// rows where every column sees the front
+		float drop;						// camera height - obstacle height
+		int obstacle;
+		size_t offset;
+	};
+
+	bool columnRange(float x, float y, float radius, float fwd_x, float fwd_y, int& first, int& last) const;
+	void addObstacle(const float* z_in, const float* z_out, int first, int last, float height, int obstacle);
+	void renderRow(int row, float* out, int32_t* surfaces);
+	void renderSpanSurfaces(const Span& span, float v, float inv_below, float* out, int32_t* surfaces);
+	void finishRow(float* out);
+
+	CameraModel camera_;
+	DepthNoise noise_;
+	uint64_t rng_state_;
+
+	// Per column ray slopes: lateral offset per metre of depth
+	float column_slope_[kImageWidth];
+	float min_angle_, max_angle_;	// rad, of the first and last column
+
+	// Scene, structure of arrays
+	std::vector<float> box_min_x_, box_min_y_, box_max_x_, box_max_y_, box_height_;
+	std::vector<float> cyl_x_, cyl_y_, cyl_radius_, cyl_height_;
+
+	// Obstacles hit from the current pose; the span arrays hold
+	// kImageWidth floats per obstacle, sized in setScene()
+	std::vector<Span> spans_;
+	std::vector<float> span_front_z_, span_front_first_, span_front_last_, span_first_;
+
+	std::vector<float> noise_table_;
+};
+
+} // namespace alpha_pkg
+
+#endif // ALPHA_PKG_DEPTH_RENDERER_H
@@ -0,0 +1,162 @@
+/************************************************************
+ * Name: fault_injection.h
+
+ * Description: Fault and latency injection between the input
+ 				streams (depth, blobs, bumper) and the follower
+ 				logic. Every message offered to the injector is
+ 				dropped, delayed, duplicated or held back behind
+ 				its successor according to the per-stream
+ 				settings, and bumper edges may chatter. Within a
+ 				stream delivery stays in arrival order unless a
+ 				message is explicitly reordered, as on a TCP
+ 				transport whose latency varies.
+
+ 				The injector schedules handles, not payloads:
+ 				the caller keeps the messages (ring of ConstPtr
+ 				in the node, index entries in replay, perception
+ 				results in the simulator) and processes them
+ 				when poll() releases their handle. A seed makes
+ 				every run reproducible.
+
+ 				Config files hold "key: value" lines, keys being
+ 				<stream>_<field> with stream in depth, blobs,
+ 				bumper and field in delay, jitter, delay_model
+ 				(fixed, uniform, normal, exponential), drop,
+ 				duplicate, reorder, plus bounce, bounce_count,
+ 				bounce_interval and seed.
+ ************************************************************/
+
+#ifndef ALPHA_PKG_FAULT_INJECTION_H
+#define ALPHA_PKG_FAULT_INJECTION_H
+
+#include <string>
+#include <vector>
+#include <stdint.h>
+
+namespace alpha_pkg {
+
+enum FaultStream {
+	FAULT_DEPTH = 0,
+	FAULT_BLOBS = 1,
+	FAULT_BUMPER = 2,
+	NUM_FAULT_STREAMS = 3
+};
+
+enum DelayModel {
+	DELAY_FIXED = 0,		// delay
+	DELAY_UNIFORM = 1,		// delay +- jitter
+	DELAY_NORMAL = 2,		// delay, sigma jitter, clipped at 0
+	DELAY_EXPONENTIAL = 3	// mean delay, jitter unused
+};
+
+struct StreamFaults {
+	int delay_model;		// DelayModel
+	float delay;			// s
+	float jitter;			// s
+	float drop;				// probability a message is lost
+	float duplicate;		// probability a message arrives twice
+	float reorder;			// probability the next message overtakes it
+};
+
+struct FaultConfig {
+	StreamFaults streams[NUM_FAULT_STREAMS];
+	float bounce;			// probability a bumper edge chatters
+	int bounce_count;		// extra release/press pairs per chatter
+	float bounce_interval;	// s between chatter flips
+	uint64_t seed;
+};
+
+// No fault on any stream; chatter shape 2 flips x 20 ms
+FaultConfig defaultFaultConfig();
+
+// True if any setting can alter the message flow
+bool faultsEnabled(const FaultConfig& config);
+
+// Set one key of the config file format
+bool setFaultParameter(FaultConfig& config, const std::string& key, const std::string& value, std::string& error);
+
+// Read "key: value" lines over `config`; unknown keys are an error
+bool loadFaultConfig(const std::string& path, FaultConfig& config, std::string& error);
+
+const char* faultStreamName(int stream);
+
+struct FaultDelivery {
+	int stream;				// FaultStream
+	uint32_t handle;		// as offered
+	double stamp;			// s, arrival of the original message
+	double release;			// s, delivery time
+	uint8_t bumper_state;	// FAULT_BUMPER: state to apply
+};
+
+struct FaultStats {
+	uint64_t offered[NUM_FAULT_STREAMS];
+	uint64_t delivered[NUM_FAULT_STREAMS];
+	uint64_t dropped[NUM_FAULT_STREAMS];
+	uint64_t duplicated[NUM_FAULT_STREAMS];
+	uint64_t reordered[NUM_FAULT_STREAMS];
+	uint64_t bounces;
+	uint64_t overflows;		// lost because the queue was full
+};
+
+/************************************************************
+ * Class Name: FaultInjector
+
+ * Description: Schedules offered messages by release time.
+ 				The queue is allocated up front, so offer() and
+ 				poll() are safe in the allocation-free callbacks.
+*************************************************************/
+
+class FaultInjector {
+public:
+	explicit FaultInjector(const FaultConfig& config, size_t capacity = 1024);
+
+	bool enabled() const { return enabled_; }
+	const FaultConfig& config() const { return config_; }
+
+	// Forget pending messages and restart the random sequence
+	void reset();
+
+	// A message of `stream` arrived at `stamp`. Returns how many
+	// times its handle will be released: 0 if dropped, 2 if
+	// duplicated, bumper chatter not included.
+	int offer(int stream, double stamp, uint32_t handle, uint8_t bumper_state = 0);
+
+	// Next delivery released at or before `now`, in release order
+	bool poll(double now, FaultDelivery& delivery);
+
+	size_t pending() const { return queue_.size(); }
+	const FaultStats& stats() const { return stats_; }
+
+private:
+	struct Pending {
+		FaultDelivery delivery;
+		uint64_t order;
+	};
+
+	struct Later {
+		bool operator()(const Pending& a, const Pending& b) const {
+			return a.delivery.release > b.delivery.release ||
+				   (a.delivery.release == b.delivery.release && a.order > b.order);
+		}
+	};
+
+	uint64_t next();
+	float uniform();
+	double sampleDelay(const StreamFaults& faults);
+	bool schedule(const FaultDelivery& delivery);
+
+	FaultConfig config_;
+	bool enabled_;
+	size_t capacity_;
+	uint64_t rng_state_;
+	uint64_t order_;
+	std::vector<Pending> queue_;
+	double last_release_[NUM_FAULT_STREAMS];
+	bool has_held_[NUM_FAULT_STREAMS];
+	FaultDelivery held_[NUM_FAULT_STREAMS];
+	FaultStats stats_;
+};
+
+} // namespace alpha_pkg
+
+#endif // ALPHA_PKG_FAULT_INJECTION_H
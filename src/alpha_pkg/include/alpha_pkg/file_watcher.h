@@ -0,0 +1,51 @@
+/************************************************************
+ * Name: file_watcher.h
+
+ * Description: Calls back from its own thread when a file is
+ 				rewritten. The parent directory is watched with
+ 				inotify rather than the file itself, so editors
+ 				that save by writing a temporary file and
+ 				renaming it over the original are seen too, and
+ 				the watch survives the file being replaced.
+ 				Events arriving within a short settle time are
+ 				coalesced into one callback.
+ ************************************************************/
+
+#ifndef ALPHA_PKG_FILE_WATCHER_H
+#define ALPHA_PKG_FILE_WATCHER_H
+
+#include <atomic>
+#include <functional>
+#include <string>
+#include <thread>
+
+namespace alpha_pkg {
+
+class FileWatcher {
+public:
+	typedef std::function<void()> Callback;
+
+	FileWatcher();
+	~FileWatcher();
+
+	// Watch `path`; returns false with `error` set if inotify or
+	// the directory watch cannot be set up
+	bool start(const std::string& path, const Callback& on_change, std::string& error);
+	void stop();
+
+private:
+	FileWatcher(const FileWatcher&);
+	FileWatcher& operator=(const FileWatcher&);
+
+	void watch();
+
+	std::string name_;
+	Callback on_change_;
+	int inotify_fd_;
+	std::atomic<bool> running_;
+	std::thread thread_;
+};
+
+} // namespace alpha_pkg
+
+#endif // ALPHA_PKG_FILE_WATCHER_H
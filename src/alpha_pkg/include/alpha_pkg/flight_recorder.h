@@ -0,0 +1,101 @@
+/************************************************************
+ * Name: flight_recorder.h
+
+ * Description: In-memory flight recorder. Keeps the last N
+ 				control decisions with a downsampled summary of
+ 				what the robot saw (sector depths, goal
+ 				features, state, command) in a fixed-size ring
+ 				buffer. trigger() snapshots the ring and a
+ 				background thread writes it to a compact binary
+ 				file, so the control loop never waits on disk.
+
+ 				File layout (little endian):
+ 				FlightFileHeader, then `count` FlightRecords
+ 				from oldest to newest.
+ ************************************************************/
+
+#ifndef ALPHA_PKG_FLIGHT_RECORDER_H
+#define ALPHA_PKG_FLIGHT_RECORDER_H
+
+#include <alpha_pkg/perception.h>
+#include <condition_variable>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include <stdint.h>
+
+namespace alpha_pkg {
+
+enum FlightFlags {
+	FLIGHT_GOAL_FOUND = 1 << 0,
+	FLIGHT_OBSTACLE_FOUND = 1 << 1,
+	FLIGHT_BUMPER = 1 << 2,
+	FLIGHT_OBSTACLE_MOVING = 1 << 3
+};
+
+struct FlightRecord {
+	double stamp;						// ROS time, s
+	uint8_t state;
+	uint8_t flags;						// FlightFlags
+	uint16_t goal_blob_area;
+	uint32_t close_points;
+	float goal_x;						// px from image center
+	float cmd_linear;					// m/s
+	float cmd_angular;					// rad/s
+	float sector_min_depth[kNumSectors];	// m, +inf if empty
+	uint32_t reserved;					// zeroed by record(); no padding is left
+};
+
+struct FlightFileHeader {
+	char magic[4];						// "AFLT"
+	uint16_t version;
+	uint16_t record_size;
+	uint32_t count;
+	uint32_t num_sectors;
+	double trigger_stamp;
+	char reason[16];
+};
+
+class FlightRecorder {
+public:
+	// Holds `capacity` records; files are written into `directory`
+	FlightRecorder(size_t capacity, const std::string& directory);
+	~FlightRecorder();
+
+	void record(const FlightRecord& record);
+
+	// Snapshot the ring and queue it for writing. Returns false if
+	// the previous dump is still being written.
+	bool trigger(const char* reason, double stamp);
+
+	size_t capacity() const { return ring_.size(); }
+	size_t memoryBytes() const { return 2*ring_.size()*sizeof(FlightRecord); }
+
+private:
+	FlightRecorder(const FlightRecorder&);
+	FlightRecorder& operator=(const FlightRecorder&);
+
+	void writerLoop();
+	void writeSnapshot();
+
+	std::vector<FlightRecord> ring_;
+	size_t head_;
+	size_t count_;
+
+	// Owned by the writer thread while pending_ is set
+	std::vector<FlightRecord> snapshot_;
+	size_t snapshot_count_;
+	FlightFileHeader snapshot_header_;
+
+	std::string directory_;
+	std::mutex mutex_;
+	std::condition_variable wake_;
+	bool pending_;
+	bool stop_;
+	std::thread writer_;
+};
+
+} // namespace alpha_pkg
+
+#endif // ALPHA_PKG_FLIGHT_RECORDER_H
@@ -0,0 +1,49 @@
+/************************************************************
+ * Name: follower_params.h
+
+ * Description: The tunable settings of the follower in one
+ 				value: the controller config (speeds, turn rate
+ 				limit, the 0.7 seek gains, maneuver timing)
+ 				plus the perception thresholds min_z and the
+ 				goal area. The node keeps it in a SnapshotStore
+ 				so a file edit retunes the running robot.
+
+ 				Keys are the ControllerConfig field names, min_z
+ 				and goal_area_threshold. Files hold "key: value"
+ 				lines as for loadControllerConfig().
+ ************************************************************/
+
+#ifndef ALPHA_PKG_FOLLOWER_PARAMS_H
+#define ALPHA_PKG_FOLLOWER_PARAMS_H
+
+#include <alpha_pkg/controller.h>
+#include <string>
+#include <stddef.h>
+#include <stdint.h>
+
+namespace alpha_pkg {
+
+struct FollowerParams {
+	ControllerConfig controller;
+	float min_z;					// m, depth of a close band point
+	uint32_t goal_area_threshold;	// px, blob area of a seen goal
+};
+
+// The values the node has always used
+FollowerParams defaultFollowerParams();
+
+// Every key, for reading them from the parameter server
+extern const char* const kFollowerParameterNames[];
+extern const size_t kNumFollowerParameters;
+
+// Set one key. Negative values, a zero min_z and unknown keys are
+// an error.
+bool setFollowerParameter(FollowerParams& params, const std::string& key, double value, std::string& error);
+
+// Read "key: value" lines over `params`. On error `params` may be
+// partly updated, so load into a copy.
+bool loadFollowerParams(const std::string& path, FollowerParams& params, std::string& error);
+
+} // namespace alpha_pkg
+
+#endif // ALPHA_PKG_FOLLOWER_PARAMS_H
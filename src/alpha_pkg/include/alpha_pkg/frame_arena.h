@@ -0,0 +1,63 @@
+/************************************************************
+ * Name: frame_arena.h
+
+ * Description: Frame-scoped bump allocator for the perception
+ 				callbacks. Every scratch buffer a callback needs
+ 				(closest points, sectors, masks, blob clusters)
+ 				is carved out of one preallocated block and the
+ 				whole block is released at once by reset() at
+ 				the start of the next frame.
+
+ 				If a frame asks for more than the block holds,
+ 				the request is served from an overflow block and
+ 				the main block is grown to the high-water mark on
+ 				the next reset(), so the steady state performs no
+ 				heap allocations at all.
+ ************************************************************/
+
+#ifndef ALPHA_PKG_FRAME_ARENA_H
+#define ALPHA_PKG_FRAME_ARENA_H
+
+#include <stddef.h>
+#include <vector>
+
+namespace alpha_pkg {
+
+class FrameArena {
+public:
+	static const size_t kDefaultAlignment = 16;
+
+	explicit FrameArena(size_t capacity);
+	~FrameArena();
+
+	// Release every allocation of the previous frame
+	void reset();
+
+	// Uninitialized storage of `bytes` bytes, never NULL
+	void* allocate(size_t bytes, size_t alignment = kDefaultAlignment);
+
+	// Uninitialized storage for `count` objects of trivial type T
+	template <typename T>
+	T* allocate(size_t count){
+		return static_cast<T*>(allocate(count*sizeof(T), alignof(T) > kDefaultAlignment ? alignof(T) : kDefaultAlignment));
+	}
+
+	size_t capacity() const { return capacity_; }
+	size_t used() const { return used_; }
+	size_t highWater() const { return high_water_; }
+
+private:
+	FrameArena(const FrameArena&);
+	FrameArena& operator=(const FrameArena&);
+
+	char* base_;
+	size_t capacity_;
+	size_t offset_;
+	size_t used_;
+	size_t high_water_;
+	std::vector<void*> overflow_;
+};
+
+} // namespace alpha_pkg
+
+#endif // ALPHA_PKG_FRAME_ARENA_H
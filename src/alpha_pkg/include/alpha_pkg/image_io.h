@@ -0,0 +1,28 @@
+/************************************************************
+ * Name: image_io.h
+
+ * Description: Binary PPM (P6, 8-bit) reading and writing, the
+ 				exchange format of the offline color tools. Any
+ 				image viewer opens it and the camera frames of a
+ 				bag convert to it with image_view's
+ 				extract_images or ImageMagick.
+ ************************************************************/
+
+#ifndef ALPHA_PKG_IMAGE_IO_H
+#define ALPHA_PKG_IMAGE_IO_H
+
+#include <string>
+#include <vector>
+#include <stddef.h>
+#include <stdint.h>
+
+namespace alpha_pkg {
+
+// Packed RGB8 rows of 3*width bytes
+bool readPpm(const std::string& path, std::vector<uint8_t>& rgb, int& width, int& height, std::string& error);
+
+bool writePpm(const std::string& path, const uint8_t* rgb, int width, int height, size_t step, std::string& error);
+
+} // namespace alpha_pkg
+
+#endif // ALPHA_PKG_IMAGE_IO_H
@@ -0,0 +1,47 @@
+/************************************************************
+ * Name: image_renderer.h
+
+ * Description: Low-cost synthetic RGB frames for the simulator.
+ 				The geometry comes from the depth renderer's
+ 				surface labels; every surface has one flat color
+ 				(obstacle color, floor, backdrop) scaled by the
+ 				gain of the scenario's lighting profile, plus
+ 				per-pixel sensor noise of the profile's
+ 				strength. That is enough to exercise the color
+ 				thresholds of colors.txt under varied lighting.
+ ************************************************************/
+
+#ifndef ALPHA_PKG_IMAGE_RENDERER_H
+#define ALPHA_PKG_IMAGE_RENDERER_H
+
+#include <alpha_pkg/depth_renderer.h>
+#include <alpha_pkg/scenario.h>
+#include <vector>
+#include <stddef.h>
+#include <stdint.h>
+
+namespace alpha_pkg {
+
+class ImageRenderer {
+public:
+	ImageRenderer(const CameraModel& camera, uint64_t seed);
+
+	void setScene(const Scenario& scenario);
+	void moveCylinder(int index, float x, float y) { geometry_.moveCylinder(index, x, y); }
+	void setPose(float x, float y, float heading) { geometry_.setPose(x, y, heading); }
+
+	// Full kImageWidth x kImageHeight frame of packed RGB8, rows
+	// `step` bytes apart
+	void render(uint8_t* rgb, size_t step);
+
+private:
+	DepthRenderer geometry_;
+	uint64_t rng_state_;
+	uint8_t palette_[256][3];
+	std::vector<uint8_t> surfaces_;
+	std::vector<int16_t> noise_;
+};
+
+} // namespace alpha_pkg
+
+#endif // ALPHA_PKG_IMAGE_RENDERER_H
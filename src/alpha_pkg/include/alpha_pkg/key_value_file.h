@@ -0,0 +1,34 @@
+/************************************************************
+ * Name: key_value_file.h
+
+ * Description: Reader of the flat "key: value" files of the
+ 				controller, follower and fault configs. Blank
+ 				lines and # comments are skipped; every other
+ 				line holds one key of letters, digits and
+ 				underscores, a colon and one value. Each pair is
+ 				handed to a setter, which owns the keys and the
+ 				checks of their values.
+ ************************************************************/
+
+#ifndef ALPHA_PKG_KEY_VALUE_FILE_H
+#define ALPHA_PKG_KEY_VALUE_FILE_H
+
+#include <functional>
+#include <string>
+
+namespace alpha_pkg {
+
+// Set `key` from `value`; false with `error` set rejects the file
+typedef std::function<bool(const std::string& key, const std::string& value, std::string& error)> KeyValueSetter;
+
+// Read `path` line by line into `set`. A line that does not parse,
+// is longer than 255 characters or is rejected by the setter stops
+// the read with `error` ending in " in <path>:<line>".
+bool readKeyValueFile(const std::string& path, const KeyValueSetter& set, std::string& error);
+
+// `value` as a number, or an error naming `key`
+bool parseNumber(const std::string& key, const std::string& value, double& number, std::string& error);
+
+} // namespace alpha_pkg
+
+#endif // ALPHA_PKG_KEY_VALUE_FILE_H
@@ -0,0 +1,135 @@
+/************************************************************
+ * Name: loop_monitor.h
+
+ * Description: Deadline-miss detector for the control loop.
+ 				Records the actual period of every cycle and
+ 				how long each stage of the cycle took. When a
+ 				cycle overruns (ros::Rate::sleep() returns
+ 				false) the overrun is counted, its duration
+ 				accumulated, and it is attributed to the
+ 				slowest stage of that cycle. A summary of the
+ 				last window is published on /diagnostics.
+ ************************************************************/
+
+#ifndef ALPHA_PKG_LOOP_MONITOR_H
+#define ALPHA_PKG_LOOP_MONITOR_H
+
+#include <diagnostic_msgs/DiagnosticArray.h>
+#include <ros/ros.h>
+#include <stdint.h>
+
+namespace alpha_pkg {
+
+class LoopMonitor {
+public:
+	enum Stage {
+		STAGE_DEPTH = 0,	// PointCloud_Callback
+		STAGE_BLOBS,		// blobsCallBack
+		STAGE_BUMPER,		// Bumper_Callback
+		STAGE_SPIN,			// rest of ros::spinOnce()
+		STAGE_FAULTS,		// rest of the fault injector's deliveries
+		STAGE_CONTROL,		// state machine and velocity output
+		NUM_STAGES
+	};
+
+	static const char* stageName(Stage stage);
+
+	LoopMonitor(double rate_hz, const ros::Publisher& diagnostics_publisher);
+
+	// Add time spent in `stage` during the current cycle
+	void addStageTime(Stage stage, double seconds);
+
+	// Time spent in the callback stages (depth, blobs, bumper)
+	// so far in the current cycle
+	double callbackTime() const;
+
+	// Close the current cycle; `met_deadline` is the return
+	// value of ros::Rate::sleep()
+	void endCycle(bool met_deadline);
+
+	// Publish and log the summary of the window since the last
+	// call, then start a new window
+	void publishSummary();
+
+	uint64_t totalOverruns() const { return total_overruns_; }
+
+private:
+	struct Window {
+		uint64_t cycles;
+		double period_sum;
+		double period_max;
+		uint64_t overruns;
+		double overrun_sum;
+		double overrun_max;
+		uint64_t stage_overruns[NUM_STAGES];
+		double stage_sum[NUM_STAGES];
+		double stage_max[NUM_STAGES];
+	};
+
+	void clearWindow();
+
+	double expected_period_;
+	ros::Publisher diagnostics_publisher_;
+
+	double stage_time_[NUM_STAGES];
+	ros::WallTime cycle_start_;
+	bool started_;
+
+	Window window_;
+	ros::WallTime window_start_;
+	uint64_t total_cycles_;
+	uint64_t total_overruns_;
+};
+
+/************************************************************
+ * Class Name: ScopedStageTimer
+
+ * Description: Adds the lifetime of the object to a stage of
+ 				the current cycle
+*************************************************************/
+
+class ScopedStageTimer {
+public:
+	ScopedStageTimer(LoopMonitor& monitor, LoopMonitor::Stage stage)
+		: monitor_(monitor), stage_(stage), start_(ros::WallTime::now()) {}
+	~ScopedStageTimer(){
+		monitor_.addStageTime(stage_, (ros::WallTime::now() - start_).toSec());
+	}
+
+private:
+	LoopMonitor& monitor_;
+	LoopMonitor::Stage stage_;
+	ros::WallTime start_;
+};
+
+/************************************************************
+ * Class Name: ScopedOuterStageTimer
+
+ * Description: Adds the lifetime of the object to a stage of
+ 				the current cycle, less the callback stages
+ 				timed on their own meanwhile. For stages that
+ 				run callbacks: ros::spinOnce() and the fault
+ 				injector's deliveries.
+*************************************************************/
+
+class ScopedOuterStageTimer {
+public:
+	ScopedOuterStageTimer(LoopMonitor& monitor, LoopMonitor::Stage stage)
+		: monitor_(monitor), stage_(stage), start_(ros::WallTime::now()),
+		  callbacks_(monitor.callbackTime()) {}
+	~ScopedOuterStageTimer(){
+		double callbacks = monitor_.callbackTime() - callbacks_;
+		double seconds = (ros::WallTime::now() - start_).toSec() - callbacks;
+		monitor_.addStageTime(stage_, seconds > 0.0 ? seconds : 0.0);
+	}
+
+private:
+	LoopMonitor& monitor_;
+	LoopMonitor::Stage stage_;
+	ros::WallTime start_;
+	double callbacks_;
+};
+
+} // namespace alpha_pkg
+
+#endif // ALPHA_PKG_LOOP_MONITOR_H
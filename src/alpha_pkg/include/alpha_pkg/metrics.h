@@ -0,0 +1,165 @@
+/************************************************************
+ * Name: metrics.h
+
+ * Description: Prometheus-style counters, gauges and
+ 				histograms plus a minimal HTTP server that
+ 				exposes them in the Prometheus text format on a
+ 				localhost port.
+
+ 				Metrics are plain atomics: the control loop
+ 				updates them with relaxed atomic operations and
+ 				the server thread reads them the same way, so a
+ 				scrape never takes a lock the control loop could
+ 				wait on. Metrics register themselves when they
+ 				are constructed, which must happen before the
+ 				server is started (e.g. as globals).
+ ************************************************************/
+
+#ifndef ALPHA_PKG_METRICS_H
+#define ALPHA_PKG_METRICS_H
+
+#include <atomic>
+#include <string>
+#include <thread>
+#include <stdint.h>
+#include <time.h>
+
+namespace alpha_pkg {
+namespace metrics {
+
+class Metric {
+public:
+	// `labels` is the Prometheus label set without braces,
+	// e.g. "callback=\"depth\"", or empty
+	Metric(const char* name, const char* labels, const char* help);
+	virtual ~Metric() {}
+
+	const char* name() const { return name_; }
+	const char* labels() const { return labels_; }
+	const char* help() const { return help_; }
+
+	virtual const char* type() const = 0;
+	virtual void render(std::string& out) const = 0;
+
+protected:
+	const char* name_;
+	const char* labels_;
+	const char* help_;
+};
+
+class Counter : public Metric {
+public:
+	Counter(const char* name, const char* labels, const char* help)
+		: Metric(name, labels, help), value_(0) {}
+
+	void increment(uint64_t n = 1){ value_.fetch_add(n, std::memory_order_relaxed); }
+	uint64_t value() const { return value_.load(std::memory_order_relaxed); }
+
+	const char* type() const { return "counter"; }
+	void render(std::string& out) const;
+
+private:
+	std::atomic<uint64_t> value_;
+};
+
+class Gauge : public Metric {
+public:
+	Gauge(const char* name, const char* labels, const char* help)
+		: Metric(name, labels, help), bits_(0) {}
+
+	void set(double value);
+	double value() const;
+
+	const char* type() const { return "gauge"; }
+	void render(std::string& out) const;
+
+private:
+	std::atomic<uint64_t> bits_;
+};
+
+class Histogram : public Metric {
+public:
+	static const int kMaxBuckets = 16;
+
+	// `bounds` are the upper bounds of the buckets in increasing
+	// order; the +Inf bucket is implicit
+	Histogram(const char* name, const char* labels, const char* help,
+			  const double* bounds, int num_bounds);
+
+	void observe(double value);
+
+	const char* type() const { return "histogram"; }
+	void render(std::string& out) const;
+
+private:
+	double bounds_[kMaxBuckets];
+	int num_bounds_;
+	std::atomic<uint64_t> counts_[kMaxBuckets + 1];
+	std::atomic<uint64_t> sum_bits_;
+};
+
+// Bucket bounds shared by the latency histograms (seconds)
+extern const double kLatencyBounds[];
+extern const int kNumLatencyBounds;
+
+// Render every registered metric in the Prometheus text format
+void renderAll(std::string& out);
+
+// Monotonic clock in seconds, for latency measurements
+inline double monotonicSeconds(){
+	timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec*1e-9;
+}
+
+/************************************************************
+ * Class Name: ScopedLatency
+
+ * Description: Observes the lifetime of the object in a
+ 				histogram
+*************************************************************/
+
+class ScopedLatency {
+public:
+	explicit ScopedLatency(Histogram& histogram)
+		: histogram_(histogram), start_(monotonicSeconds()) {}
+	~ScopedLatency(){ histogram_.observe(monotonicSeconds() - start_); }
+
+private:
+	Histogram& histogram_;
+	double start_;
+};
+
+/************************************************************
+ * Class Name: MetricsServer
+
+ * Description: Serves GET /metrics on 127.0.0.1:<port> from
+ 				its own thread
+*************************************************************/
+
+class MetricsServer {
+public:
+	MetricsServer();
+	~MetricsServer();
+
+	// Bind and start serving; returns false if the port cannot
+	// be bound
+	bool start(int port);
+	void stop();
+
+private:
+	MetricsServer(const MetricsServer&);
+	MetricsServer& operator=(const MetricsServer&);
+
+	void serve();
+	void handleClient(int client_fd);
+
+	int listen_fd_;
+	std::atomic<bool> running_;
+	std::thread thread_;
+};
+
+} // namespace metrics
+} // namespace alpha_pkg
+
+#endif // ALPHA_PKG_METRICS_H
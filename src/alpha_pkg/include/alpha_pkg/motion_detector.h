@@ -0,0 +1,100 @@
+/************************************************************
+ * Name: motion_detector.h
+
+ * Description: Separates moving from static obstacles in the
+ 				depth band. The band is reduced to a grid of
+ 				16x16 px tiles holding the nearest depth of
+ 				their obstacle points; points on or behind the
+ 				floor, as seen by the level camera at
+ 				camera_height, are left out, so the floor does
+ 				not hide what stands on it.
+
+ 				Each frame's grid is compared with a reference
+ 				grid `baseline` s old, long enough for a person
+ 				walking at 1 m/s to move 0.2 m. The ego-motion
+ 				since the reference is undone first: a static
+ 				point comes the distance driven closer, and so
+ 				moves out from the image center, and the turn
+ 				pans it across the image and changes its depth
+ 				along the optical axis. Each tile is looked up,
+ 				by its own depth, in the reference tile its
+ 				content came from. A tile whose depth is then
+ 				out of the range of that reference tile and its
+ 				neighbors by more than min_change +
+ 				depth_change*depth, within max_depth, is moving:
+ 				an obstacle came in front of what was there, or
+ 				went away from it. Taking the range of the
+ 				neighbors keeps edges, where the lookup is a
+ 				tile off, from being taken for motion. A sector
+ 				with min_tiles moving tiles is flagged. The
+ 				flags are renewed every `baseline` s, and the
+ 				band is only reduced then.
+ ************************************************************/
+
+#ifndef ALPHA_PKG_MOTION_DETECTOR_H
+#define ALPHA_PKG_MOTION_DETECTOR_H
+
+#include <alpha_pkg/perception.h>
+#include <stdint.h>
+
+namespace alpha_pkg {
+
+const int kTileSize = 16;
+const int kTileColumns = kImageWidth/kTileSize;
+const int kTileRows = kBandRows/kTileSize;
+
+struct MotionConfig {
+	float fx, fy, cx, cy;		// px, depth camera intrinsics
+	float camera_height;		// m above the floor
+	float floor_margin;			// fraction of the floor depth still taken as floor
+	float baseline;				// s, age of the reference grid
+	float max_interval;			// s between frames before starting over
+	float max_depth;			// m, farther tiles are not watched
+	float min_change;			// m
+	float depth_change;			// m of change per m of depth
+	int min_tiles;				// moving tiles that flag a sector
+};
+
+// The Astra on the Kobuki as in defaultCameraModel(), 0.2 s,
+// changes over 0.1 m plus 2% within 3 m, 3 tiles
+MotionConfig defaultMotionConfig();
+
+// Bit s set if sector s of `scan` holds a point closer than min_z
+uint8_t closeSectors(const DepthScan& scan, float min_z);
+
+class MotionDetector {
+public:
+	explicit MotionDetector(const MotionConfig& config);
+
+	void reset();
+
+	// The band of the depth frame stamped `stamp` (s), with the
+	// robot driving at `linear` (m/s) and turning at `angular`
+	// (rad/s) since the previous frame
+	void update(double stamp, const DepthView& view, float linear, float angular);
+
+	// Bit s set if sector s holds a moving obstacle
+	uint8_t movingSectors() const { return moving_sectors_; }
+	bool moving(int sector) const { return (moving_sectors_ >> sector) & 1; }
+	int movingTiles(int sector) const { return moving_tiles_[sector]; }
+
+private:
+	void reduce(const DepthView& view, float* tiles, float* reference) const;
+	void compare();
+
+	MotionConfig config_;
+	float floor_cut_[kBandRows];		// nearer points of the row are obstacles
+	float tiles_[kTileRows*kTileColumns];		// m, +inf without obstacle points
+	float reference_[kTileRows*kTileColumns];
+	float next_reference_[kTileRows*kTileColumns];
+	bool has_reference_;
+	double reference_stamp_, stamp_;
+	float driven_;						// m since the reference
+	float turned_;						// rad since the reference
+	int moving_tiles_[kNumSectors];
+	uint8_t moving_sectors_;
+};
+
+} // namespace alpha_pkg
+
+#endif // ALPHA_PKG_MOTION_DETECTOR_H
@@ -0,0 +1,256 @@
+/************************************************************
+ * Name: perception.h
+
+ * Description: Perception kernels of the follower, kept free
+ 				of ROS types so the node, the replay tools and
+ 				the simulator all run the same code.
+
+ 				The depth kernel scans the obstacle band (rows
+ 				180 to 419 of the 640x480 organized cloud) and
+ 				produces the closest-point buffer used for the
+ 				obstacle decision together with a per-sector
+ 				summary of the nearest depth and of a robust
+ 				near depth, a low percentile that single speckles
+ 				and dropouts do not move. checkDepthBand()
+ 				reaches the same decision from a subsample of
+ 				the band on most frames.
+ ************************************************************/
+
+#ifndef ALPHA_PKG_PERCEPTION_H
+#define ALPHA_PKG_PERCEPTION_H
+
+#include <alpha_pkg/frame_arena.h>
+#include <stddef.h>
+#include <stdint.h>
+
+namespace alpha_pkg {
+
+const int kImageWidth = 640;
+const int kImageHeight = 480;
+
+// Rows of the depth image checked for obstacles
+const int kBandFirstRow = 180;
+const int kBandRows = 240;
+
+// Vertical sectors the band is divided into, left to right
+const int kNumSectors = 8;
+const int kSectorColumns = kImageWidth/kNumSectors;
+
+// Number of close points above which an obstacle is reported
+const size_t kObstaclePointThreshold = 10;
+
+// Depth histograms behind sector_near_depth: 2 cm bins up to
+// 10.24 m, farther points count in the last bin. Only the band rows
+// above kHorizonRow are counted: below the optical axis the level
+// camera sees the floor, which would hold the percentile at the
+// 0.9 m of the band's bottom row.
+const int kHorizonRow = kImageHeight/2;
+const int kDepthBins = 512;
+const float kDepthBinsPerMetre = 50.0f;
+
+// Fraction of the valid points of a sector nearer than its near
+// depth
+const float kNearDepthFraction = 0.05f;
+
+/************************************************************
+ * Struct Name: DepthView
+
+ * Description: Strided view of the z values of an organized
+ 				depth image, or of a block of its rows. For a
+ 				pcl::PointXYZ cloud, z points at points[0].z,
+ 				stride is 4 floats and first_row is 0; a
+ 				recorded band starts at first_row 180.
+*************************************************************/
+
+struct DepthView {
+	const float* z;
+	size_t stride;		// floats between consecutive pixels
+	int width;
+	int height;			// rows held by the view
+	int first_row;		// image row of the first row held
+
+	const float* row(int image_row) const {
+		return z + static_cast<size_t>(image_row - first_row)*width*stride;
+	}
+	float at(int image_row, int col) const { return row(image_row)[col*stride]; }
+};
+
+/************************************************************
+ * Struct Name: DepthScan
+
+ * Description: Result of scanning the obstacle band of one
+ 				depth frame
+*************************************************************/
+
+struct DepthScan {
+	// Columns of the points closer than min_z, in scan order.
+	// Lives in the frame arena until its next reset().
+	uint16_t* close_columns;
+	size_t num_close_columns;
+	size_t num_close_points;
+
+	// Nearest valid depth per sector, +inf if the sector has none
+	float sector_min_depth[kNumSectors];
+
+	// Depth under which kNearDepthFraction of the valid points of
+	// each sector above kHorizonRow lie, +inf if the sector has
+	// none. Interpolated within the 2 cm histogram bin.
+	float sector_near_depth[kNumSectors];
+
+	// Depth values read to produce the scan
+	size_t points_read;
+
+	// Decided on the coarse sample of checkDepthBand(): the count
+	// is the sample's scaled up, the columns and sector depths are
+	// the sample's
+	bool coarse;
+};
+
+/************************************************************
+ * Struct Name: BlobObservation
+
+ * Description: One color blob as reported by cmvision. Also
+ 				the on-disk blob record of the recording format,
+ 				so its layout is fixed at 16 bytes.
+*************************************************************/
+
+struct BlobObservation {
+	uint8_t red, green, blue;
+	uint8_t reserved;
+	uint32_t area;		// px
+	float x, y;			// centroid, px
+};
+
+// Scan the obstacle band of `view` for points closer than `min_z`.
+// With `column_min_depth`, the nearest valid depth of each of the
+// kImageWidth columns is written there in the same pass (+inf if
+// the column has none).
+void scanDepthBand(const DepthView& view, float min_z, FrameArena& arena, DepthScan& scan,
+				   float* column_min_depth = NULL);
+
+/************************************************************
+ * Struct Name: CoarseCheck
+
+ * Description: Settings of the two-level obstacle check. The
+ 				band is sampled every `stride` rows and columns
+ 				first, each sampled row shifted by one column, so
+ 				every column is read once per stride^2 rows and
+ 				a one pixel wide strip, like an obstacle entering
+ 				the view at the edge or a face seen edge-on, is
+ 				still hit. A sample with no close point
+ 				is clear and one with more than max_ambiguous
+ 				close points is blocked; in between the count is
+ 				near the threshold of 10 and the band is scanned
+ 				in full.
+*************************************************************/
+
+struct CoarseCheck {
+	int stride;					// 1 scans every frame in full
+	size_t max_ambiguous;		// close samples that still need the full scan
+};
+
+// Stride 4 (1/16 of the band), a full scan for 1 to 3 close
+// samples, i.e. an estimate of at most 48 points
+CoarseCheck defaultCoarseCheck();
+
+// scanDepthBand() on frames the sample cannot decide, the sample
+// alone on the others (scan.coarse). Columns are always scanned in
+// full.
+void checkDepthBand(const DepthView& view, float min_z, const CoarseCheck& check, FrameArena& arena,
+					DepthScan& scan, float* column_min_depth = NULL);
+
+/************************************************************
+ * Struct Name: ScanProjection
+
+ * Description: Maps the columns of the depth band onto the
+ 				evenly spaced rays of a planar laser scan. Ray j
+ 				points at angle_min + j*angle_increment, counter
+ 				clockwise from the optical axis, so the rightmost
+ 				column is ray 0. Each ray covers the columns
+ 				closest to it in angle, or the single nearest
+ 				column where the columns are sparser than the
+ 				rays, so no ray is left without a return. A
+ 				column's depth turns into the range along its
+ 				ray through range_scale.
+*************************************************************/
+
+struct ScanProjection {
+	float angle_min;
+	float angle_max;
+	float angle_increment;
+	uint16_t first_column[kImageWidth];	// columns of each ray
+	uint16_t last_column[kImageWidth];
+	float range_scale[kImageWidth];		// 1/cos of the column angle
+};
+
+// Projection of a pinhole camera with focal length `fx` and
+// principal point `cx` (px)
+void makeScanProjection(float fx, float cx, ScanProjection& projection);
+
+// Nearest range of each of the kImageWidth rays, +inf for no return
+void columnDepthToRanges(const float* column_min_depth, const ScanProjection& projection, float* ranges);
+
+// Colors of the target classes in colors.txt
+enum TargetColor {
+	TARGET_PINK = 0,		// Pink indoors
+	TARGET_PINK_OUT = 1		// Pink outdoors
+};
+const uint8_t kTargetColors[2][3] = {{238, 114, 76},
+									 {185, 66, 36}};
+
+// Total blob area above which the goal is reported
+const uint32_t kGoalAreaThreshold = 3000;
+
+/************************************************************
+ * Struct Name: GoalEstimate
+
+ * Description: Area-weighted centroid of the blobs of the
+ 				target color
+*************************************************************/
+
+struct GoalEstimate {
+	bool found;			// area > the area threshold
+	uint32_t area;		// px
+	float x;			// px from the image center, valid if found
+	float y;			// px, valid if found
+	int num_blobs;
+};
+
+/************************************************************
+ * Function Name: fuseBlobs
+
+ * Description: Cumulates x, y and areas of the blobs whose
+ 				color matches `color` into a weighted centroid.
+ 				The goal counts as found above `area_threshold`.
+ 				Works on any blob type with red, green, blue,
+ 				area, x and y members (cmvision::Blob,
+ 				BlobObservation).
+*************************************************************/
+
+template <typename Blob>
+void fuseBlobs(const Blob* blobs, size_t count, const uint8_t* color, GoalEstimate& goal,
+			   uint32_t area_threshold = kGoalAreaThreshold){
+	float sum_x = 0, sum_y = 0;
+	goal.area = 0;
+	goal.num_blobs = 0;
+
+	for(size_t i = 0; i < count; i++){
+		const Blob& blob = blobs[i];
+		if(blob.red == color[0] && blob.green == color[1] && blob.blue == color[2]){
+			sum_x += blob.area*static_cast<float>(blob.x);
+			sum_y += blob.area*static_cast<float>(blob.y);
+			goal.area += blob.area;
+			goal.num_blobs++;
+		}
+	}
+
+	goal.found = goal.area > area_threshold;
+	if(goal.found){
+		goal.x = sum_x/goal.area - kImageWidth/2;
+		goal.y = sum_y/goal.area;
+	}
+}
+
+} // namespace alpha_pkg
+
+#endif // ALPHA_PKG_PERCEPTION_H
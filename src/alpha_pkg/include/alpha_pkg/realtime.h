@@ -0,0 +1,46 @@
+/************************************************************
+ * Name: realtime.h
+
+ * Description: Opt-in real-time execution helpers for the
+ 				control thread: SCHED_FIFO scheduling, CPU
+ 				pinning, locking the process memory and
+ 				prefaulting the stack. Every helper logs the
+ 				permission or limit that is missing instead of
+ 				failing silently, and returns false so the
+ 				caller can carry on in best-effort mode.
+ ************************************************************/
+
+#ifndef ALPHA_PKG_REALTIME_H
+#define ALPHA_PKG_REALTIME_H
+
+#include <stddef.h>
+
+namespace alpha_pkg {
+
+struct RealtimeConfig {
+	bool enabled;
+	int priority;					// SCHED_FIFO priority, 1..99
+	int cpu;						// core to pin the thread to, -1 to leave unpinned
+	size_t stack_prefault_bytes;	// stack to touch after mlockall
+};
+
+// Switch the calling thread to SCHED_FIFO at `priority`
+bool setRealtimePriority(const char* thread_name, int priority);
+
+// Pin the calling thread to `cpu`
+bool pinToCpu(const char* thread_name, int cpu);
+
+// mlockall() current and future pages
+bool lockProcessMemory();
+
+// Touch `bytes` of stack so later calls do not page fault
+void prefaultStack(size_t bytes);
+
+// Apply the whole config to the calling thread. Memory locking is
+// process wide and only done once. Returns true if every step
+// succeeded.
+bool configureRealtimeThread(const char* thread_name, const RealtimeConfig& config);
+
+} // namespace alpha_pkg
+
+#endif // ALPHA_PKG_REALTIME_H
@@ -0,0 +1,165 @@
+/************************************************************
+ * Name: recording.h
+
+ * Description: Native recording format for sensor replay.
+ 				A recording stores, in arrival order:
+ 				- the obstacle band of each depth frame as a
+ 				  640x240 uint16 plane in millimetres (0 for
+ 				  invalid), delta + run-length coded per row,
+ 				- the blob list of each /blobs message as raw
+ 				  BlobObservation records,
+ 				- bumper events,
+ 				followed by a time index. The reader maps the
+ 				whole file, so the index and the blob lists are
+ 				used in place without copies and only the depth
+ 				planes need decoding.
+
+ 				File layout (little endian):
+ 				RecordingHeader
+ 				{ ChunkHeader, payload } * N
+ 				IndexEntry * N    (at header.index_offset)
+ ************************************************************/
+
+#ifndef ALPHA_PKG_RECORDING_H
+#define ALPHA_PKG_RECORDING_H
+
+#include <alpha_pkg/perception.h>
+#include <stdio.h>
+#include <string>
+#include <vector>
+#include <stdint.h>
+
+namespace alpha_pkg {
+
+enum ChunkType {
+	CHUNK_DEPTH = 1,
+	CHUNK_BLOBS = 2,
+	CHUNK_BUMPER = 3
+};
+
+struct RecordingHeader {
+	char magic[4];			// "AREC"
+	uint16_t version;
+	uint16_t width;			// columns of the depth plane
+	uint16_t first_row;		// image row of the first plane row
+	uint16_t rows;			// rows of the depth plane
+	uint32_t reserved;
+	uint64_t index_offset;
+	uint64_t index_count;
+};
+
+struct ChunkHeader {
+	double stamp;
+	uint32_t type;			// ChunkType
+	uint32_t size;			// payload bytes
+};
+
+struct IndexEntry {
+	double stamp;
+	uint64_t offset;		// of the payload
+	uint32_t size;
+	uint32_t type;
+};
+
+struct BumperRecord {
+	uint8_t bumper;
+	uint8_t state;
+	uint8_t reserved[2];
+};
+
+// Delta + run-length coding of one depth plane; see recording.cpp
+size_t encodeDepthPlane(const uint16_t* plane, int width, int rows, std::vector<uint8_t>& out);
+bool decodeDepthPlane(const uint8_t* data, size_t size, int width, int rows, uint16_t* plane);
+
+// Metres <-> millimetres, NaN and out-of-range depths map to 0
+void depthToMillimetres(const DepthView& view, int first_row, int rows, uint16_t* plane);
+void millimetresToDepth(const uint16_t* plane, size_t count, float* z);
+
+/************************************************************
+ * Class Name: RecordingWriter
+
+ * Description: Appends chunks to a new recording and writes
+ 				the index on close()
+*************************************************************/
+
+class RecordingWriter {
+public:
+	RecordingWriter();
+	~RecordingWriter();
+
+	bool open(const std::string& path);
+	bool close();
+
+	bool writeDepth(double stamp, const DepthView& view);
+	bool writeBlobs(double stamp, const BlobObservation* blobs, uint32_t count);
+	bool writeBumper(double stamp, uint8_t bumper, uint8_t state);
+
+	uint64_t rawDepthBytes() const { return raw_depth_bytes_; }
+	uint64_t encodedDepthBytes() const { return encoded_depth_bytes_; }
+	size_t chunkCount() const { return index_.size(); }
+
+private:
+	RecordingWriter(const RecordingWriter&);
+	RecordingWriter& operator=(const RecordingWriter&);
+
+	bool writeChunk(double stamp, ChunkType type, const void* data, uint32_t size);
+
+	FILE* file_;
+	uint64_t offset_;
+	std::vector<IndexEntry> index_;
+	std::vector<uint16_t> plane_;
+	std::vector<uint8_t> encoded_;
+	uint64_t raw_depth_bytes_;
+	uint64_t encoded_depth_bytes_;
+};
+
+/************************************************************
+ * Class Name: RecordingReader
+
+ * Description: Memory-mapped, random-access reader. Pointers
+ 				it returns stay valid until close().
+*************************************************************/
+
+class RecordingReader {
+public:
+	RecordingReader();
+	~RecordingReader();
+
+	// Maps `path`; a file that is not a recording of this band
+	// geometry is rejected with a message in `error`
+	bool open(const std::string& path, std::string& error);
+	void close();
+
+	const RecordingHeader& header() const { return *header_; }
+	const IndexEntry* index() const { return index_; }
+	size_t size() const { return index_count_; }
+
+	// First index entry with stamp >= `stamp`
+	size_t lowerBound(double stamp) const;
+
+	// Raw payload of an entry, in place
+	const uint8_t* payload(const IndexEntry& entry) const { return base_ + entry.offset; }
+
+	// Decode a depth chunk into a width*rows plane
+	bool readDepth(const IndexEntry& entry, uint16_t* plane) const;
+
+	// Blob list of a blobs chunk, in place
+	const BlobObservation* blobs(const IndexEntry& entry, uint32_t& count) const;
+
+	const BumperRecord* bumper(const IndexEntry& entry) const;
+
+private:
+	RecordingReader(const RecordingReader&);
+	RecordingReader& operator=(const RecordingReader&);
+
+	int fd_;
+	const uint8_t* base_;
+	size_t length_;
+	const RecordingHeader* header_;
+	const IndexEntry* index_;
+	size_t index_count_;
+};
+
+} // namespace alpha_pkg
+
+#endif // ALPHA_PKG_RECORDING_H
@@ -0,0 +1,74 @@
+/************************************************************
+ * Name: replay.h
+
+ * Description: Replays the chunks of a recording through the
+ 				perception kernels with the same flag semantics
+ 				as the node callbacks: the bumper latches the
+ 				obstacle flag until a clear depth frame arrives
+ 				after its release, and an empty blob list keeps
+ 				the previous goal. Recordings hold no velocity
+ 				commands to take the ego-motion from, so the
+ 				contact inputs stay clear and no obstacle is
+ 				taken as moving.
+ ************************************************************/
+
+#ifndef ALPHA_PKG_REPLAY_H
+#define ALPHA_PKG_REPLAY_H
+
+#include <alpha_pkg/controller.h>
+#include <alpha_pkg/fault_injection.h>
+#include <alpha_pkg/perception.h>
+#include <alpha_pkg/recording.h>
+#include <vector>
+
+namespace alpha_pkg {
+
+class ReplayPerception {
+public:
+	// `goal_area_threshold` as the node's goal_area_threshold param
+	ReplayPerception(float min_z, int target_color,
+					 uint32_t goal_area_threshold = kGoalAreaThreshold);
+
+	// Apply one chunk; returns false for a corrupt chunk
+	bool apply(const RecordingReader& reader, const IndexEntry& entry);
+
+	// Apply a bumper event of the given state
+	void applyBumper(uint8_t state);
+
+	// Check depth frames with checkDepthBand() from now on
+	void setCoarseCheck(const CoarseCheck& check) { check_ = check; }
+
+	// Flags as the control loop would see them now
+	const ControllerInputs& inputs() const { return inputs_; }
+	const DepthScan& scan() const { return scan_; }
+
+private:
+	float min_z_;
+	const uint8_t* color_;
+	uint32_t goal_area_threshold_;
+	CoarseCheck check_;
+	FrameArena arena_;
+	std::vector<uint16_t> plane_;
+	std::vector<float> depth_;
+	DepthScan scan_;
+	ControllerInputs inputs_;
+};
+
+struct TimedInputs {
+	double stamp;
+	ControllerInputs inputs;
+};
+
+// Sample the inputs at `rate_hz` control ticks over the whole
+// recording, as the 10 Hz loop of the node would see them. With
+// `faults`, the chunks pass through a FaultInjector on the way and
+// the ticks go on past the last chunk until the injector has
+// released everything it holds.
+// A file RecordingReader rejects leaves its reason in `error`.
+bool sampleControlInputs(const std::string& path, float min_z, int target_color,
+						 uint32_t goal_area_threshold, double rate_hz, std::vector<TimedInputs>& samples,
+						 std::string& error, const FaultConfig* faults = NULL);
+
+} // namespace alpha_pkg
+
+#endif // ALPHA_PKG_REPLAY_H
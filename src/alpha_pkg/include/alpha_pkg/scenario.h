@@ -0,0 +1,104 @@
+/************************************************************
+ * Name: scenario.h
+
+ * Description: Seeded procedural generator of 2.5D test
+ 				environments for the simulator: a walled room,
+ 				box and cylinder clutter at a given density,
+ 				occluders between the robot and the target, the
+ 				pink target itself and a lighting profile that
+ 				decides which colors.txt class (Pink / PinkOut)
+ 				the target shows up as.
+
+ 				A scenario depends only on its seed. The random
+ 				numbers come from our own splitmix64 generator
+ 				rather than <random> distributions, whose output
+ 				differs between standard libraries.
+
+ 				World frame: x to the right, y forward, z up,
+ 				metres; the room spans [0, width] x [0, depth].
+ ************************************************************/
+
+#ifndef ALPHA_PKG_SCENARIO_H
+#define ALPHA_PKG_SCENARIO_H
+
+#include <stdio.h>
+#include <vector>
+#include <stdint.h>
+
+namespace alpha_pkg {
+
+enum LightingProfile {
+	LIGHTING_INDOOR = 0,
+	LIGHTING_INDOOR_DIM,
+	LIGHTING_INDOOR_BRIGHT,
+	LIGHTING_OUTDOOR_OVERCAST,
+	LIGHTING_OUTDOOR_SUN,
+	NUM_LIGHTING_PROFILES
+};
+
+struct LightingInfo {
+	const char* name;
+	int target_class;		// TargetColor seen under this light
+	float gain;				// brightness multiplier of the scene
+	float noise;			// std. dev. of pixel noise, 0..255 units
+};
+
+const LightingInfo& lightingInfo(LightingProfile profile);
+
+struct Box {
+	float min_x, min_y, max_x, max_y;
+	float height;
+	uint8_t rgb[3];
+};
+
+struct Cylinder {
+	float x, y;
+	float radius;
+	float height;
+	uint8_t rgb[3];
+};
+
+struct Scenario {
+	uint64_t seed;
+	float width, depth;				// room size
+	float clutter_density;			// obstacles per m^2
+	LightingProfile lighting;
+
+	std::vector<Box> boxes;			// walls first, then clutter and occluders
+	int num_walls;
+	int num_occluders;
+	std::vector<Cylinder> cylinders;
+	Cylinder target;
+
+	float start_x, start_y, start_heading;	// heading: rad, 0 = +y
+};
+
+struct ScenarioParams {
+	float min_room, max_room;			// side length, m
+	float max_clutter_density;			// obstacles per m^2
+	int max_occluders;
+	float min_target_distance;			// from the start, m
+	float target_radius;
+	float target_height;
+	float clearance;					// free radius around start and target
+};
+
+ScenarioParams defaultScenarioParams();
+
+Scenario generateScenario(uint64_t seed, const ScenarioParams& params);
+
+// The standard regression suite: kStandardSuiteSize scenarios
+// whose seeds are derived from kStandardSuiteBaseSeed
+const int kStandardSuiteSize = 2000;
+const uint64_t kStandardSuiteBaseSeed = 0x5eedb10bf011ull;
+uint64_t standardSuiteSeed(int index);
+
+// Digest of a scenario's layout, to check that a build
+// reproduces the suite bit for bit
+uint64_t scenarioDigest(const Scenario& scenario);
+
+void writeScenario(FILE* out, const Scenario& scenario);
+
+} // namespace alpha_pkg
+
+#endif // ALPHA_PKG_SCENARIO_H
@@ -0,0 +1,112 @@
+/************************************************************
+ * Name: segmentation.h
+
+ * Description: Color blob segmentation in the manner of
+ 				cmvision, so the simulator and offline tools can
+ 				turn RGB frames into the blobs the node gets
+ 				from /blobs. Pixels are classified through a
+ 				ColorTable, each row is run-length encoded, runs
+ 				of the same class that overlap on consecutive
+ 				rows are joined with union-find, and every
+ 				region of at least min_area pixels becomes one
+ 				BlobObservation with the class color, its area
+ 				and its centroid.
+
+ 				All buffers are sized at construction; segment()
+ 				does not allocate.
+ ************************************************************/
+
+#ifndef ALPHA_PKG_SEGMENTATION_H
+#define ALPHA_PKG_SEGMENTATION_H
+
+#include <alpha_pkg/color_table.h>
+#include <alpha_pkg/perception.h>
+#include <vector>
+#include <stddef.h>
+#include <stdint.h>
+
+namespace alpha_pkg {
+
+// Pixels [x0, x1) x [y0, y1) of the image
+struct ImageWindow {
+	int x0, y0, x1, y1;
+};
+
+struct SegmentationStats {
+	size_t pixels;			// pixels classified
+	size_t runs;
+	size_t regions;
+	bool truncated;			// ran out of runs, lower rows ignored
+};
+
+class Segmenter {
+public:
+	Segmenter(int width, int height, uint32_t min_area);
+
+	// rgb: packed 8-bit RGB rows, `step` bytes apart. Writes the
+	// max_blobs largest blobs, largest first, and returns their
+	// number.
+	size_t segment(const uint8_t* rgb, size_t step, const ColorTable& table,
+				   BlobObservation* blobs, size_t max_blobs);
+
+	// Same, classifying only the pixels of `window` (clipped to
+	// the image). Centroids stay in image coordinates; regions cut
+	// by the window edge only count their inside part. With
+	// `boxes`, the bounding box of each blob is written there.
+	size_t segment(const uint8_t* rgb, size_t step, const ColorTable& table, const ImageWindow& window,
+				   BlobObservation* blobs, ImageWindow* boxes, size_t max_blobs);
+
+	// Coarse to fine: classifies one pixel per 4x4 cell (1/4
+	// resolution) and segments at full resolution only around the
+	// cells that hit a class. Gives the blobs of segment() for
+	// compact regions; parts of a region more than a cell away
+	// from its sampled pixels, like vertical lines thinner than 2
+	// px or horizontal ones thinner than 4 px, can be missed.
+	// stats().pixels counts both levels.
+	size_t segmentPyramid(const uint8_t* rgb, size_t step, const ColorTable& table,
+						  BlobObservation* blobs, ImageWindow* boxes, size_t max_blobs);
+
+	const SegmentationStats& stats() const { return stats_; }
+
+private:
+	struct Run {
+		uint16_t x, width;
+		uint16_t row;
+		uint8_t color;		// class index
+		int parent;
+	};
+
+	struct Region {
+		uint8_t color;
+		uint32_t area;
+		double sum_x, sum_y;
+		ImageWindow box;
+	};
+
+	struct Span {
+		int x0, x1;
+	};
+
+	int root(int run);
+	void encodeRow(const uint8_t* pixel, int row, int x0, int x1, const ColorTable& table,
+				   size_t& num_runs, size_t& above_first, size_t above_end);
+	size_t report(const ColorTable& table, size_t num_runs,
+				  BlobObservation* blobs, ImageWindow* boxes, size_t max_blobs);
+
+	int width_, height_;
+	uint32_t min_area_;
+	std::vector<Run> runs_;
+	std::vector<Region> regions_;
+	std::vector<int> region_of_;		// per root run
+	std::vector<int> reported_;			// regions of the blobs, largest first
+	std::vector<int8_t> row_classes_;
+	int coarse_cols_, coarse_rows_;
+	std::vector<uint8_t> coarse_;		// cells whose sample has a class
+	std::vector<uint8_t> dilated_;		// coarse_ dilated along the rows
+	std::vector<Span> spans_;			// of marked cells, one cell row
+	SegmentationStats stats_;
+};
+
+} // namespace alpha_pkg
+
+#endif // ALPHA_PKG_SEGMENTATION_H
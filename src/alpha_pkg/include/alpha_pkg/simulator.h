@@ -0,0 +1,173 @@
+/************************************************************
+ * Name: simulator.h
+
+ * Description: Headless closed-loop simulation of the follower
+ 				on a generated scenario. Every control period
+ 				the robot's view is rendered (depth band and RGB
+ 				frame), the RGB frame is segmented with the
+ 				colors.txt thresholds, and the node's kernels
+ 				turn depth and blobs into the controller inputs
+ 				with the node's flag semantics. The controller's
+ 				command then drives a unicycle model; touching
+ 				an obstacle blocks the motion and presses the
+ 				bumper.
+
+ 				With faults configured, the simulated messages
+ 				pass through a FaultInjector, seeded per
+ 				scenario, before the node semantics see them.
+
+ 				With track_target, the RGB frame is segmented
+ 				only in the TargetTracker window; with
+ 				pyramid_search, frames that are not windowed are
+ 				searched coarse to fine. check_tracking also
+ 				segments every frame in full, outside the loop,
+ 				to count the goals these missed.
+
+ 				The near depths of each depth frame go through a
+ 				ContactEstimator, with the command in effect as
+ 				the ego-motion, into the controller's contact
+ 				inputs; they only act with contact_time set in
+ 				the controller config. With detect_motion, the
+ 				band also goes through a MotionDetector for the
+ 				controller's obstacle_moving (see wait_time).
+ ************************************************************/
+
+#ifndef ALPHA_PKG_SIMULATOR_H
+#define ALPHA_PKG_SIMULATOR_H
+
+#include <alpha_pkg/color_table.h>
+#include <alpha_pkg/contact_estimator.h>
+#include <alpha_pkg/controller.h>
+#include <alpha_pkg/depth_renderer.h>
+#include <alpha_pkg/fault_injection.h>
+#include <alpha_pkg/frame_arena.h>
+#include <alpha_pkg/image_renderer.h>
+#include <alpha_pkg/motion_detector.h>
+#include <alpha_pkg/perception.h>
+#include <alpha_pkg/scenario.h>
+#include <alpha_pkg/segmentation.h>
+#include <alpha_pkg/target_tracker.h>
+#include <vector>
+#include <stdint.h>
+
+namespace alpha_pkg {
+
+struct SimConfig {
+	double control_rate;		// Hz
+	double time_limit;			// s
+	float robot_radius;			// m
+	float min_z;				// m, depth obstacle threshold
+	int color;					// TargetColor followed
+	uint32_t min_blob_area;		// px
+	DepthNoise depth_noise;
+	ControllerConfig controller;
+	FaultConfig faults;
+	bool track_target;			// segment a window around the goal
+	bool pyramid_search;		// coarse to fine instead of full frames
+	bool check_tracking;		// compare each frame with a full scan
+	TrackerConfig tracker;
+	ContactConfig contact;
+	bool detect_motion;			// flag moving obstacles
+	MotionConfig motion;
+};
+
+// The node's values: 10 Hz, min_z 0.7, PinkOut, a Kobuki base,
+// no faults, full frame segmentation
+SimConfig defaultSimConfig();
+
+struct SimResult {
+	uint64_t seed;
+	bool goal_declared;			// controller reached state 3
+	double time_to_goal;		// s, <0 if never
+	float target_distance;		// m, from the robot's edge at the end
+	int bumper_hits;
+	double distance;			// m travelled
+	int steps;
+	int goal_steps;				// steps with goal_found
+	int obstacle_steps;			// steps with obstacle_found
+	uint64_t segmented_pixels;	// pixels classified over the run
+	uint64_t window_pixels;		// of the frames segmented in a window
+	int full_scans;				// frames not segmented in a window
+	int reference_goals;		// check_tracking: frames a full scan finds the goal
+	int tracked_goals;			// check_tracking: of those, found by the simulated search too
+	int limited_steps;			// steps with the forward speed capped by contact_time
+	int moving_steps;			// detect_motion: steps with a moving sector
+	int waiting_steps;			// steps stopped for a moving obstacle
+};
+
+// Goal declared with the robot's edge within min_z of the target
+bool simSucceeded(const SimResult& result, const SimConfig& config);
+
+class Simulator {
+public:
+	Simulator(const SimConfig& config, const ColorTable& colors);
+
+	void reset(const Scenario& scenario);
+
+	// One control period: perceive, decide, move. Returns false
+	// once the run is over (goal declared or time limit).
+	bool step();
+
+	// reset() and step() until done
+	SimResult run(const Scenario& scenario);
+
+	const SimResult& result() const { return result_; }
+	const ControllerInputs& inputs() const { return inputs_; }
+	const Controller& controller() const { return controller_; }
+	const FaultStats& faultStats() const { return faults_.stats(); }
+	float x() const { return x_; }
+	float y() const { return y_; }
+	float heading() const { return heading_; }
+
+private:
+	// What the node takes from one depth and one blobs message
+	struct SensedFrame {
+		double stamp;
+		uint32_t close_points;
+		float near_depth[kNumSectors];
+		uint8_t close_sectors;
+		uint8_t moving_sectors;
+		bool has_blobs;
+		GoalEstimate goal;
+	};
+
+	void perceive();
+	void applyDepth(const SensedFrame& frame);
+	void applyBlobs(const SensedFrame& frame);
+	void applyBumper(bool pressed);
+	void move(const Command& command, double dt);
+	bool collides(float x, float y) const;
+
+	SimConfig config_;
+	const ColorTable& colors_;
+	const uint8_t* target_rgb_;
+
+	DepthRenderer depth_renderer_;
+	ImageRenderer image_renderer_;
+	Segmenter segmenter_;
+	TargetTracker tracker_;
+	ContactEstimator contact_estimator_;
+	MotionDetector motion_detector_;
+	FrameArena arena_;
+	std::vector<float> depth_;
+	std::vector<uint8_t> rgb_;
+	std::vector<BlobObservation> blobs_;
+	std::vector<ImageWindow> boxes_;
+	DepthScan scan_;
+	FaultInjector faults_;
+	std::vector<SensedFrame> frames_;
+
+	const Scenario* scenario_;
+	Controller controller_;
+	ControllerInputs inputs_;
+	Command command_;
+	bool contact_;
+	bool reported_contact_;
+	double now_;
+	float x_, y_, heading_;
+	SimResult result_;
+};
+
+} // namespace alpha_pkg
+
+#endif // ALPHA_PKG_SIMULATOR_H
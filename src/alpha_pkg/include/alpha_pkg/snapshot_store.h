@@ -0,0 +1,112 @@
+/************************************************************
+ * Name: snapshot_store.h
+
+ * Description: Read-copy-update holder of an immutable value,
+ 				for settings that change while the control loop
+ 				runs. A writer (any thread) publishes a new copy
+ 				and swaps the current pointer atomically; the
+ 				reader gets the current snapshot with one atomic
+ 				load, without locking or allocating, and a
+ 				snapshot it holds never changes under it.
+
+ 				Old snapshots are freed once the reader has
+ 				passed a quiescent state after their swap: the
+ 				reader calls quiescent() at a point where it
+ 				holds no snapshot, once per control cycle, and a
+ 				snapshot obtained before that call must not be
+ 				used after it. There is a single reader thread
+ 				(the node's main loop, which also runs the
+ 				callbacks); writers are serialized by a mutex.
+ ************************************************************/
+
+#ifndef ALPHA_PKG_SNAPSHOT_STORE_H
+#define ALPHA_PKG_SNAPSHOT_STORE_H
+
+#include <atomic>
+#include <mutex>
+#include <vector>
+#include <stddef.h>
+#include <stdint.h>
+
+namespace alpha_pkg {
+
+template <typename T>
+class SnapshotStore {
+public:
+	explicit SnapshotStore(const T& initial)
+		: current_(new Snapshot(initial, 1)), epoch_(0), reader_epoch_(0) {}
+
+	~SnapshotStore(){
+		delete current_.load();
+		for(size_t i = 0; i < retired_.size(); i++){
+			delete retired_[i].snapshot;
+		}
+	}
+
+	// Reader side. Valid until the reader's next quiescent().
+	const T& get() const { return current_.load(std::memory_order_acquire)->value; }
+
+	// Number of the current snapshot, 1 for the initial value
+	uint64_t version() const { return current_.load(std::memory_order_acquire)->version; }
+
+	// Reader side: no snapshot obtained so far is in use any more
+	void quiescent(){
+		reader_epoch_.store(epoch_.load(std::memory_order_acquire), std::memory_order_release);
+	}
+
+	// Writer side: make a copy of `value` the current snapshot and
+	// free the retired ones the reader can no longer hold. Returns
+	// the version of the new snapshot.
+	uint64_t publish(const T& value){
+		std::lock_guard<std::mutex> lock(mutex_);
+		Snapshot* old = current_.load(std::memory_order_relaxed);
+		Snapshot* next = new Snapshot(value, old->version + 1);
+		current_.store(next, std::memory_order_release);
+		Retired retired = {old, epoch_.fetch_add(1, std::memory_order_acq_rel) + 1};
+		retired_.push_back(retired);
+
+		uint64_t safe = reader_epoch_.load(std::memory_order_acquire);
+		size_t kept = 0;
+		for(size_t i = 0; i < retired_.size(); i++){
+			if(retired_[i].epoch <= safe){
+				delete retired_[i].snapshot;
+			}
+			else{
+				retired_[kept++] = retired_[i];
+			}
+		}
+		retired_.resize(kept);
+		return next->version;
+	}
+
+	// Snapshots swapped out but possibly still held by the reader
+	size_t retired() const {
+		std::lock_guard<std::mutex> lock(mutex_);
+		return retired_.size();
+	}
+
+private:
+	struct Snapshot {
+		Snapshot(const T& v, uint64_t n) : value(v), version(n) {}
+		const T value;
+		const uint64_t version;
+	};
+
+	struct Retired {
+		Snapshot* snapshot;
+		uint64_t epoch;			// swapped out when epoch_ became this
+	};
+
+	SnapshotStore(const SnapshotStore&);
+	SnapshotStore& operator=(const SnapshotStore&);
+
+	std::atomic<Snapshot*> current_;
+	std::atomic<uint64_t> epoch_;
+	std::atomic<uint64_t> reader_epoch_;
+	mutable std::mutex mutex_;
+	std::vector<Retired> retired_;
+};
+
+} // namespace alpha_pkg
+
+#endif // ALPHA_PKG_SNAPSHOT_STORE_H
@@ -0,0 +1,70 @@
+/************************************************************
+ * Name: target_tracker.h
+
+ * Description: Chooses the part of the RGB frame to segment
+ 				once the target is tracked. The bounding box of
+ 				the target-colored blobs is predicted with a
+ 				constant velocity and grown by a margin and by
+ 				the target's motion per frame. The target is
+ 				tracked from min_area on, well below the goal
+ 				area threshold, so a distant target is tracked
+ 				too. The whole frame is segmented until the
+ 				target has been seen in two frames in a row (the
+ 				velocity is unknown before), after a frame that
+ 				lost it and every full_scan_period frames, so a
+ 				second target-colored region or a jump is picked
+ 				up.
+ ************************************************************/
+
+#ifndef ALPHA_PKG_TARGET_TRACKER_H
+#define ALPHA_PKG_TARGET_TRACKER_H
+
+#include <alpha_pkg/perception.h>
+#include <alpha_pkg/segmentation.h>
+#include <stddef.h>
+#include <stdint.h>
+
+namespace alpha_pkg {
+
+struct TrackerConfig {
+	int full_scan_period;		// frames, every this many is a full scan; 0 never forces one
+	float margin;				// px added on every side
+	float motion_gain;			// px added per px/frame of target motion
+	uint32_t min_area;			// px of target color to track
+};
+
+// A full scan every 10 frames (1 s at the node's rate), 16 px and
+// twice the motion per frame around the box, from 50 px on
+TrackerConfig defaultTrackerConfig();
+
+class TargetTracker {
+public:
+	TargetTracker(const TrackerConfig& config, int width, int height);
+
+	void reset();
+
+	// Part of the next frame to segment
+	ImageWindow window() const;
+
+	// window() is the whole frame
+	bool fullScanDue() const;
+
+	// Blobs and their boxes (see Segmenter::segment) of the frame
+	// segmented in window(); the target is made of the blobs of
+	// `color`
+	void update(const BlobObservation* blobs, const ImageWindow* boxes, size_t count, const uint8_t* color);
+
+	bool tracking() const { return detections_ >= 2; }
+
+private:
+	TrackerConfig config_;
+	int width_, height_;
+	int detections_;			// frames in a row with the target
+	int frames_since_full_;
+	ImageWindow box_;			// of the target in the last frame
+	float vx_, vy_;				// px/frame, smoothed
+};
+
+} // namespace alpha_pkg
+
+#endif // ALPHA_PKG_TARGET_TRACKER_H
@@ -0,0 +1,60 @@
+/************************************************************
+ * Name: velocity_output.h
+
+ * Description: Output stage for the velocity commands. Keeps
+ 				one preallocated geometry_msgs::Twist and
+ 				publishes it through a shared pointer, so
+ 				intra-process subscribers receive it without a
+ 				copy. Commands that are identical (within a
+ 				tolerance) to the last published one are
+ 				suppressed, except that the last command is
+ 				re-sent every keep-alive period so the velocity
+ 				mux does not time out.
+ ************************************************************/
+
+#ifndef ALPHA_PKG_VELOCITY_OUTPUT_H
+#define ALPHA_PKG_VELOCITY_OUTPUT_H
+
+#include <geometry_msgs/Twist.h>
+#include <ros/ros.h>
+#include <stdint.h>
+
+namespace alpha_pkg {
+
+class VelocityOutput {
+public:
+	VelocityOutput(const ros::Publisher& publisher, double tolerance, const ros::Duration& keepalive);
+
+	// Request a velocity; published only if it changed or the
+	// keep-alive period expired
+	void command(double linear, double angular);
+
+	// Log requested vs. published messages and bytes per second
+	// since the previous report
+	void reportStats();
+
+	double lastLinear() const { return msg_->linear.x; }
+	double lastAngular() const { return msg_->angular.z; }
+	uint64_t requestedCount() const { return requested_; }
+	uint64_t publishedCount() const { return published_; }
+
+private:
+	ros::Publisher publisher_;
+	double tolerance_;
+	ros::Duration keepalive_;
+
+	geometry_msgs::TwistPtr msg_;
+	bool has_published_;
+	ros::Time last_publish_;
+
+	uint32_t msg_bytes_;
+	uint64_t requested_;
+	uint64_t published_;
+	uint64_t reported_requested_;
+	uint64_t reported_published_;
+	ros::WallTime last_report_;
+};
+
+} // namespace alpha_pkg
+
+#endif // ALPHA_PKG_VELOCITY_OUTPUT_H
@@ -0,0 +1,62 @@
+/************************************************************
+ * Name: alloc_guard.cpp
+
+ * Description: Counting replacement of the global operator
+ 				new/delete used by ALPHA_PKG_NO_ALLOC_SCOPE().
+ 				Only compiled into the node when the package is
+ 				configured with -DALPHA_PKG_ALLOC_GUARD=ON.
+ ************************************************************/
+
+#include <alpha_pkg/alloc_guard.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <new>
+
+namespace {
+
+// Allocations made by the current thread, and whether a
+// NoAllocScope is active on it
+__thread size_t thread_alloc_count = 0;
+__thread int thread_scope_depth = 0;
+
+void* counted_alloc(size_t size){
+	if(thread_scope_depth > 0){
+		thread_alloc_count++;
+	}
+	void* p = malloc(size > 0 ? size : 1);
+	if(!p){
+		throw std::bad_alloc();
+	}
+	return p;
+}
+
+} // namespace
+
+void* operator new(size_t size){ return counted_alloc(size); }
+void* operator new[](size_t size){ return counted_alloc(size); }
+void operator delete(void* p) throw() { free(p); }
+void operator delete[](void* p) throw() { free(p); }
+void operator delete(void* p, size_t) throw() { free(p); }
+void operator delete[](void* p, size_t) throw() { free(p); }
+
+namespace alpha_pkg {
+
+NoAllocScope::NoAllocScope(const char* site, unsigned& entries, unsigned warmup)
+	: site_(site), armed_(entries >= warmup), start_count_(thread_alloc_count)
+{
+	if(entries < warmup){
+		entries++;
+	}
+	thread_scope_depth++;
+}
+
+NoAllocScope::~NoAllocScope(){
+	thread_scope_depth--;
+	size_t allocations = thread_alloc_count - start_count_;
+	if(armed_ && allocations > 0){
+		fprintf(stderr, "alloc_guard: %zu heap allocation(s) in steady-state %s\n", allocations, site_);
+		abort();
+	}
+}
+
+} // namespace alpha_pkg
@@ -14,12 +14,20 @@
  				by the depth camera or the bumper sensor.
 
  				Topics subscribed to:
- 				1. "/blobs" 
+ 				1. "/blobs", or "/camera/rgb/image_raw" when the
+ 				   node segments the image itself (~segment_rgb)
  				2. "/camera/depth/points"
  				3. "/mobile_base/events/bumper"
 
  				Topics published:
  				1. "cmd_vel_mux/input/teleop"
+ 				2. "band_scan" (sensor_msgs/LaserScan, nearest
+ 				   range of each column of the obstacle band, only
+ 				   computed while subscribed)
+ 				3. "debug_markers" (visualization_msgs/MarkerArray)
+ 				4. "debug_image" (sensor_msgs/Image, see
+ 				   debug_overlay.h)
+ 				The debug topics are only built while subscribed.
 
 * Usage: 		roscore
 				roslaunch turtlebot_bringup minimal.launch
@@ -33,43 +41,321 @@
 				rosrun cmvision cmvision image:=/camera/rgb/image_raw
 
 				rosrun alpha_pkg alpha_pkg_node
+
+				Metrics: curl http://127.0.0.1:9105/metrics (~metrics_port)
+
+				Real-time mode (needs rtprio/memlock limits or
+				CAP_SYS_NICE and CAP_IPC_LOCK):
+				rosrun alpha_pkg alpha_pkg_node _realtime:=true _realtime_priority:=80 _control_cpu:=3
+
+				Fault injection (see fault_injection.h):
+				rosrun alpha_pkg alpha_pkg_node _fault_config:=faults.yaml
+
+				Live tuning (see follower_params.h), the file is
+				re-read whenever it is saved:
+				rosrun alpha_pkg alpha_pkg_node _params_file:=follower.yaml
+
+				Live color calibration, without cmvision: the
+				node segments the RGB image with colors.txt and
+				swaps in the new thresholds on every save:
+				rosrun alpha_pkg alpha_pkg_node _segment_rgb:=true _color_file:=<path/to/colors.txt/file>
+				With _roi_tracking:=true only a window around the
+				tracked target is segmented, with a full frame
+				every ~roi_full_scan_period frames (see
+				target_tracker.h). With _pyramid_search:=true
+				the frames that are not windowed are searched
+				coarse to fine (Segmenter::segmentPyramid).
+
+				Slowing down ahead of obstacles by their time to
+				contact (see contact_estimator.h), e.g. keeping
+				them 3 s away, through the follower parameters:
+				rosrun alpha_pkg alpha_pkg_node _contact_time:=3.0
+
+				Waiting, up to 2 s, for an obstacle that moves
+				(see motion_detector.h) to pass instead of
+				avoiding it:
+				rosrun alpha_pkg alpha_pkg_node _motion_detection:=true _wait_time:=2.0
  ************************************************************/
 
 #include <kobuki_msgs/BumperEvent.h> 
 #include <geometry_msgs/Twist.h>
 #include <ros/ros.h>
 #include <cmvision/Blobs.h>
+#include <sensor_msgs/Image.h>
+#include <sensor_msgs/LaserScan.h>
+#include <visualization_msgs/MarkerArray.h>
 #include <stdio.h>
+#include <string.h>
 #include <vector>
+#include <algorithm>
+#include <memory>
 #include <pcl_ros/point_cloud.h>
 #include <pcl/point_types.h>
 #include <time.h>
 #include <math.h>
 #include <ros/console.h>
+#include <limits>
+#include <alpha_pkg/frame_arena.h>
+#include <alpha_pkg/alloc_guard.h>
+#include <alpha_pkg/velocity_output.h>
+#include <alpha_pkg/realtime.h>
+#include <alpha_pkg/loop_monitor.h>
+#include <alpha_pkg/metrics.h>
+#include <alpha_pkg/perception.h>
+#include <alpha_pkg/flight_recorder.h>
+#include <alpha_pkg/controller.h>
+#include <alpha_pkg/fault_injection.h>
+#include <alpha_pkg/debug_overlay.h>
+#include <alpha_pkg/follower_params.h>
+#include <alpha_pkg/snapshot_store.h>
+#include <alpha_pkg/file_watcher.h>
+#include <alpha_pkg/color_table.h>
+#include <alpha_pkg/segmentation.h>
+#include <alpha_pkg/target_tracker.h>
+#include <alpha_pkg/contact_estimator.h>
+#include <alpha_pkg/motion_detector.h>
 
 typedef pcl::PointCloud<pcl::PointXYZ> PointCloud;
 
 uint16_t state = 0;
 bool goal_found_flag = false;
 bool obstacle_found_flag = false;
+bool obstacle_moving_flag = false;
 bool bumper_flag = false;
-uint16_t goal_blob_area = 0;
+uint32_t goal_blob_area = 0;
 float goal_x = 0;
-float image_height = 480, image_width = 640;
-float linear_speed =0.15, angular_speed = 0.7, angular_speed_thresh = 0.3;
+
+// Tunable settings, owned by main(). Swapped by the file watcher;
+// the callbacks and the loop read the current snapshot lock-free.
+alpha_pkg::SnapshotStore<alpha_pkg::FollowerParams>* follower_params = NULL;
+
+// Color classes of ~color_file and the color blobs of ~target_class
+// are reported with, owned by main(). Rebuilt by a file watcher and
+// swapped in between frames like the parameters.
+struct ColorSnapshot {
+	alpha_pkg::ColorTable table;
+	uint8_t target_rgb[3];
+};
+alpha_pkg::SnapshotStore<ColorSnapshot>* color_store = NULL;
+
+// Segmentation of the RGB image in the node (~segment_rgb), owned
+// by main()
+alpha_pkg::Segmenter* segmenter = NULL;
+alpha_pkg::TargetTracker* rgb_tracker = NULL;		// ~roi_tracking
+bool pyramid_search = false;
+const size_t kMaxRgbBlobs = 64;
+alpha_pkg::BlobObservation rgb_blobs[kMaxRgbBlobs];
+alpha_pkg::ImageWindow rgb_boxes[kMaxRgbBlobs];
+
+// Scratch memory for the perception callbacks, reset once per frame.
+// 1 MB covers the closest-point buffer of a full 640x240 band.
+alpha_pkg::FrameArena frame_arena(1 << 20);
+
+// Result of the last depth frame, from the two-level check when
+// ~coarse_depth_check is set (stride 1 scans every frame in full)
+alpha_pkg::DepthScan depth_scan;
+alpha_pkg::CoarseCheck coarse_check = {1, 0};
+
+// Time to contact from the near depths of consecutive depth frames,
+// with the last velocity sent as the ego-motion; owned by main()
+alpha_pkg::ContactEstimator* contact_estimator = NULL;
+alpha_pkg::VelocityOutput* velocity_output = NULL;
+
+// Moving obstacles in the band, with ~motion_detection; owned by
+// main(), NULL when off
+alpha_pkg::MotionDetector* motion_detector = NULL;
+
+// Nearest depth of each column of the band, filled by the same pass
+// as depth_scan while "band_scan" or "debug_image" has subscribers.
+// scan_pending is set by the depth callback and cleared once the
+// scan is published; columns_valid tells whether the last frame
+// filled the columns.
+float column_min_depth[alpha_pkg::kImageWidth];
+bool columns_wanted = false;
+bool columns_valid = false;
+bool scan_pending = false;
+uint64_t scan_stamp = 0;
+
+// Inputs of the debug topics, kept by the callbacks only while
+// debug_wanted
+const size_t kDebugBlobs = 64;
+bool debug_wanted = false;
+alpha_pkg::GoalEstimate debug_goal;
+alpha_pkg::BlobObservation debug_blobs[kDebugBlobs];
+size_t num_debug_blobs = 0;
+
+// Ring of recent decisions, dumped on bumper hits and watchdog
+// timeouts; owned by main()
+alpha_pkg::FlightRecorder* flight_recorder = NULL;
+
+// Arrival time of the last message of each sensor stream
+ros::Time last_depth_time, last_blobs_time;
+
+// Optional fault injection between the subscriptions and the
+// callbacks' logic, owned by main(). While it is enabled the
+// messages wait in these rings, slot = handle % kFaultRing, until
+// the injector has released their handle as often as it said. The
+// rings are as long as the injector's queue, so a slot is only
+// reused early when older messages of the stream are still held
+// behind more than kFaultRing newer ones.
+alpha_pkg::FaultInjector* fault_injector = NULL;
+const uint32_t kFaultRing = 1024;
+struct FaultedSlot {
+	uint32_t handle;
+	int releases;
+};
+PointCloud::ConstPtr faulted_clouds[kFaultRing];
+cmvision::Blobs::ConstPtr faulted_blobs[kFaultRing];
+FaultedSlot faulted_cloud_slots[kFaultRing], faulted_blobs_slots[kFaultRing];
+uint32_t next_cloud_handle = 0, next_blobs_handle = 0;
+
+// Deadline monitor of the control loop, owned by main()
+alpha_pkg::LoopMonitor* loop_monitor = NULL;
+
+// Metrics exported on the localhost Prometheus endpoint
+namespace metrics = alpha_pkg::metrics;
+const double dwell_bounds[] = {0.5, 1, 2, 5, 10, 20, 30, 60, 120, 300};
+const double age_bounds[] = {0.001, 0.0025, 0.005, 0.01, 0.025, 0.05, 0.1, 0.25, 0.5, 1, 2.5, 5};
+metrics::Histogram depth_latency("alpha_callback_latency_seconds", "callback=\"depth\"", "Callback execution time.", metrics::kLatencyBounds, metrics::kNumLatencyBounds);
+metrics::Histogram blobs_latency("alpha_callback_latency_seconds", "callback=\"blobs\"", "Callback execution time.", metrics::kLatencyBounds, metrics::kNumLatencyBounds);
+metrics::Histogram bumper_latency("alpha_callback_latency_seconds", "callback=\"bumper\"", "Callback execution time.", metrics::kLatencyBounds, metrics::kNumLatencyBounds);
+metrics::Counter depth_frames("alpha_frames_processed_total", "stream=\"depth\"", "Input messages processed.");
+metrics::Counter blobs_frames("alpha_frames_processed_total", "stream=\"blobs\"", "Input messages processed.");
+metrics::Histogram depth_age("alpha_message_age_seconds", "stream=\"depth\"", "Header stamp to callback entry.", age_bounds, 12);
+metrics::Histogram blobs_age("alpha_message_age_seconds", "stream=\"blobs\"", "Header stamp to callback entry.", age_bounds, 12);
+metrics::Counter depth_dropped("alpha_frames_dropped_total", "stream=\"depth\"", "Input messages lost, from header sequence gaps.");
+metrics::Counter blobs_dropped("alpha_frames_dropped_total", "stream=\"blobs\"", "Input messages lost, from header sequence gaps.");
+metrics::Histogram state0_dwell("alpha_state_dwell_seconds", "state=\"0\"", "Time spent in a state before leaving it.", dwell_bounds, 10);
+metrics::Histogram state1_dwell("alpha_state_dwell_seconds", "state=\"1\"", "Time spent in a state before leaving it.", dwell_bounds, 10);
+metrics::Histogram state2_dwell("alpha_state_dwell_seconds", "state=\"2\"", "Time spent in a state before leaving it.", dwell_bounds, 10);
+metrics::Histogram state3_dwell("alpha_state_dwell_seconds", "state=\"3\"", "Time spent in a state before leaving it.", dwell_bounds, 10);
+metrics::Histogram* state_dwell[4] = {&state0_dwell, &state1_dwell, &state2_dwell, &state3_dwell};
+metrics::Gauge current_state("alpha_state", "", "Current state of the follower.");
+metrics::Counter bumper_hits("alpha_bumper_hits_total", "", "Bumper presses (collisions).");
+metrics::Counter goals_reached("alpha_goals_reached_total", "", "Transitions into state 3 (goal reached).");
+metrics::Counter control_overruns("alpha_control_overruns_total", "", "Control loop cycles that missed their deadline.");
+metrics::Counter faults_dropped("alpha_faults_injected_total", "fault=\"drop\"", "Messages perturbed by the fault injector.");
+metrics::Counter faults_duplicated("alpha_faults_injected_total", "fault=\"duplicate\"", "Messages perturbed by the fault injector.");
+metrics::Counter faults_reordered("alpha_faults_injected_total", "fault=\"reorder\"", "Messages perturbed by the fault injector.");
+metrics::Counter faults_bounces("alpha_faults_injected_total", "fault=\"bounce\"", "Messages perturbed by the fault injector.");
+metrics::Counter faults_overflows("alpha_faults_injected_total", "fault=\"overflow\"", "Messages perturbed by the fault injector.");
+metrics::Counter faults_evicted("alpha_faults_injected_total", "fault=\"evicted\"", "Messages perturbed by the fault injector.");
+metrics::Counter params_reloaded("alpha_param_reloads_total", "result=\"ok\"", "Parameter file reloads.");
+metrics::Counter params_rejected("alpha_param_reloads_total", "result=\"error\"", "Parameter file reloads.");
+metrics::Gauge params_version("alpha_params_version", "", "Version of the parameter snapshot in use.");
+metrics::Counter colors_reloaded("alpha_color_reloads_total", "result=\"ok\"", "Color file reloads.");
+metrics::Counter colors_rejected("alpha_color_reloads_total", "result=\"error\"", "Color file reloads.");
+metrics::Counter segmented_pixels("alpha_segmented_pixels_total", "", "Pixels classified by the node's own segmentation.");
+metrics::Counter full_scans("alpha_segmentation_scans_total", "window=\"full\"", "RGB frames segmented by the node.");
+metrics::Counter window_scans("alpha_segmentation_scans_total", "window=\"roi\"", "RGB frames segmented by the node.");
+metrics::Counter pyramid_scans("alpha_segmentation_scans_total", "window=\"pyramid\"", "RGB frames segmented by the node.");
+metrics::Counter depth_points_read("alpha_depth_points_read_total", "", "Depth values read by the obstacle check.");
+metrics::Counter coarse_checks("alpha_depth_checks_total", "level=\"coarse\"", "Depth frames by the level that decided them.");
+metrics::Counter full_checks("alpha_depth_checks_total", "level=\"full\"", "Depth frames by the level that decided them.");
+metrics::Counter contact_limited("alpha_contact_limited_cycles_total", "", "Control cycles with the forward speed capped by the time to contact.");
+metrics::Counter moving_frames("alpha_moving_obstacle_frames_total", "", "Depth frames with a moving obstacle closer than min_z.");
+metrics::Counter waiting_cycles("alpha_waiting_cycles_total", "", "Control cycles stopped for a moving obstacle to pass.");
 
 /************************************************************
- * Function Name: blobsCallBack
+ * Function Name: countDropped
 
- * Description: This is the callback function of the /blobs topic.
- 				The callback function also computes the centroid 
- 				of the blobs detected based on weighted average.
- 				It also raises the goal_found_flag to true when the
- 				goal is seen and false otherwise.
+ * Description: Adds the gap between consecutive header
+ 				sequence numbers of a stream to its dropped
+ 				frames counter
+*************************************************************/
+
+void countDropped(uint32_t seq, uint32_t& last_seq, bool& has_last_seq, metrics::Counter& dropped){
+	if(has_last_seq && seq > last_seq + 1){
+		dropped.increment(seq - last_seq - 1);
+	}
+	last_seq = seq;
+	has_last_seq = true;
+}
+
+/************************************************************
+ * Function Name: holdFaulted
+
+ * Description: Offers a message to the fault injector and keeps
+ 				it in its ring slot until its last release. The
+ 				releases still owed to a message whose slot is
+ 				taken over are counted as evicted.
+*************************************************************/
+
+template <typename ConstPtr>
+void holdFaulted(int stream, double stamp, const ConstPtr& message, uint32_t& next_handle,
+				 ConstPtr* messages, FaultedSlot* slots){
+	uint32_t handle = next_handle++;
+	uint32_t index = handle % kFaultRing;
+	FaultedSlot& slot = slots[index];
+	if(messages[index] && slot.releases > 0){
+		faults_evicted.increment(slot.releases);
+	}
+	slot.handle = handle;
+	slot.releases = fault_injector->offer(stream, stamp, handle);
+	messages[index] = slot.releases > 0 ? message : ConstPtr();
+}
+
+/************************************************************
+ * Function Name: updateGoal
+
+ * Description: Fuses the blobs of the target color into the
+ 				goal estimate and raises or lowers the
+ 				goal_found_flag. A frame without blobs leaves
+ 				the flags unchanged. Shared by the /blobs
+ 				messages and the node's own segmentation.
  ***********************************************************/
 
-void blobsCallBack (const cmvision::Blobs& blobsIn) 
+template <typename Blob>
+void updateGoal(const Blob* blobs, size_t count)
 {
+  	if (count > 0){
+  		// Weighted centroid of the blobs of the target color
+  		alpha_pkg::GoalEstimate goal;
+  		alpha_pkg::fuseBlobs(blobs, count, color_store->get().target_rgb, goal,
+  							 follower_params->get().goal_area_threshold);
+  		goal_blob_area = goal.area;
+  		if(debug_wanted){
+  			debug_goal = goal;
+  			num_debug_blobs = std::min<size_t>(count, kDebugBlobs);
+  			for(size_t i = 0; i < num_debug_blobs; i++){
+  				const Blob& blob = blobs[i];
+  				alpha_pkg::BlobObservation& observation = debug_blobs[i];
+  				observation.red = blob.red;
+  				observation.green = blob.green;
+  				observation.blue = blob.blue;
+  				observation.area = blob.area;
+  				observation.x = blob.x;
+  				observation.y = blob.y;
+  			}
+  		}
+
+		// Raise goal_found_flag to true if goal_blob_area > threshold (3000)
+	    if(goal.found){
+		    goal_x = goal.x;
+	      	if(!goal_found_flag){
+	        	goal_found_flag=true;
+	      	}
+	    }
+	    else{
+	      	goal_found_flag=false;
+	    }
+  	}
+}
+
+/************************************************************
+ * Function Name: processBlobs
+
+ * Description: Handles one /blobs message. The centroid of
+ 				the blobs of the target color and the
+ 				goal_found_flag are updated by updateGoal.
+ ***********************************************************/
+
+void processBlobs (const cmvision::Blobs& blobsIn)
+{
+	ALPHA_PKG_NO_ALLOC_SCOPE("processBlobs");
+	alpha_pkg::ScopedStageTimer stage_timer(*loop_monitor, alpha_pkg::LoopMonitor::STAGE_BLOBS);
+	metrics::ScopedLatency latency(blobs_latency);
+
 	/************************************************************
 	* These blobsIn.blobs[i].red, blobsIn.blobs[i].green, and blobsIn.blobs[i].blue values depend on the
 	* values those are provided in the colors.txt file.
@@ -86,71 +372,172 @@ void blobsCallBack (const cmvision::Blobs& blobsIn)
 	* Similarly, for yellow blob, blobsIn.blobs[i].red and blobsIn.blobs[i].green will be 255, and blobsIn.blobs[i].blue will be 0.
 	************************************************************/
 
-  	if (blobsIn.blob_count > 0){
-    	int num_goal_blobs = 0;		
-	    float goal_sum_x=0, goal_sum_y=0;
-	    goal_blob_area = 0;
+  	updateGoal(blobsIn.blob_count > 0 ? &blobsIn.blobs[0] : NULL, blobsIn.blob_count);
+}
 
-	    int colors[2][3] = {{238, 114, 76},   	// Pink indoors
-	                        {185, 66, 36}};  	// Pink outdoors
+/************************************************************
+ * Function Name: blobsCallBack
 
-	    // Cumulate x, y, areas and number of blobs
-		for (int i = 0; i < blobsIn.blob_count; i++){	  
-	  		int c = 1; 
-	  		if (blobsIn.blobs[i].red == colors[c][0] && blobsIn.blobs[i].green == colors[c][1] && blobsIn.blobs[i].blue == colors[c][2]){
-			    int area = blobsIn.blobs[i].area;
-			    goal_sum_x += area*blobsIn.blobs[i].x; //stores the average x-coordinate of the goal blobs
-			    goal_sum_y += area*blobsIn.blobs[i].y; //stores the average y-coordinate of the goal blobs
-			    goal_blob_area += area;
-			    num_goal_blobs++;
-	  		}
-		}	
+ * Description: This is the callback function of the /blobs topic.
+ 				It accounts the message and hands it to
+ 				processBlobs, through the fault injector when
+ 				one is enabled.
+ ***********************************************************/
 
-	    // std::cout << goal_blob_area << std::endl;
+void blobsCallBack (const cmvision::Blobs::ConstPtr& blobsIn)
+{
+	ALPHA_PKG_NO_ALLOC_SCOPE("blobsCallBack");
+	static uint32_t last_seq = 0;
+	static bool has_last_seq = false;
+	countDropped(blobsIn->header.seq, last_seq, has_last_seq, blobs_dropped);
+	blobs_frames.increment();
+	last_blobs_time = ros::Time::now();
+	if(!blobsIn->header.stamp.isZero()){
+		blobs_age.observe((last_blobs_time - blobsIn->header.stamp).toSec());
+	}
 
-		// Raise goal_found_flag to true if goal_blob_area > threshold (3000)
-	    if(goal_blob_area>3000){
-		    goal_x = goal_sum_x/goal_blob_area;
-		    goal_x-=image_width/2;
-	      	if(!goal_found_flag){
-	        	goal_found_flag=true;
-	      	}
-	    }
-	    else{
-	      	goal_found_flag=false;
-	    }
-  	}
+	if(fault_injector->enabled()){
+		holdFaulted(alpha_pkg::FAULT_BLOBS, last_blobs_time.toSec(), blobsIn, next_blobs_handle,
+					faulted_blobs, faulted_blobs_slots);
+		return;
+	}
+	processBlobs(*blobsIn);
 }
 
 /************************************************************
- * Function Name: PointCloud_Callback
+ * Function Name: Image_Callback
 
- * Description: This is the callback function of the topic
- 				"/camera/depth/points". The function also computes
- 				the number of points that are closer than a threshold
- 				z_min and raises the obstacle_found_flag if the
- 				number of points are greater than a threshold (10)
+ * Description: Callback of "/camera/rgb/image_raw" when the
+ 				node segments the image itself (~segment_rgb).
+ 				The frame is segmented with the current color
+ 				snapshot, so a reloaded colors.txt applies from
+ 				the next frame on, and its blobs go through the
+ 				same goal logic as a /blobs message. With
+ 				~roi_tracking only the tracker's window is
+ 				segmented, with ~pyramid_search the other
+ 				frames are searched coarse to fine. The image
+ 				stream is accounted as the blobs stream; the
+ 				fault injector does not apply to it.
+ ***********************************************************/
+
+void Image_Callback (const sensor_msgs::Image::ConstPtr& image)
+{
+	if(image->encoding != "rgb8" || image->width != alpha_pkg::kImageWidth ||
+	   image->height != alpha_pkg::kImageHeight || image->step < 3*image->width ||
+	   image->data.size() < static_cast<size_t>(image->step)*image->height){
+		ROS_WARN_THROTTLE(5.0, "segment_rgb: need a %dx%d rgb8 image, got %ux%u %s", alpha_pkg::kImageWidth,
+						  alpha_pkg::kImageHeight, image->width, image->height, image->encoding.c_str());
+		return;
+	}
+
+	ALPHA_PKG_NO_ALLOC_SCOPE("Image_Callback");
+	alpha_pkg::ScopedStageTimer stage_timer(*loop_monitor, alpha_pkg::LoopMonitor::STAGE_BLOBS);
+	metrics::ScopedLatency latency(blobs_latency);
+	static uint32_t last_seq = 0;
+	static bool has_last_seq = false;
+	countDropped(image->header.seq, last_seq, has_last_seq, blobs_dropped);
+	blobs_frames.increment();
+	last_blobs_time = ros::Time::now();
+	if(!image->header.stamp.isZero()){
+		blobs_age.observe((last_blobs_time - image->header.stamp).toSec());
+	}
+
+	const ColorSnapshot& colors = color_store->get();
+	alpha_pkg::ImageWindow window = {0, 0, alpha_pkg::kImageWidth, alpha_pkg::kImageHeight};
+	bool full_scan = !rgb_tracker || rgb_tracker->fullScanDue();
+	if(rgb_tracker){
+		window = rgb_tracker->window();
+	}
+	size_t count;
+	if(full_scan && pyramid_search){
+		count = segmenter->segmentPyramid(&image->data[0], image->step, colors.table, rgb_blobs, rgb_boxes, kMaxRgbBlobs);
+		pyramid_scans.increment();
+	}
+	else{
+		count = segmenter->segment(&image->data[0], image->step, colors.table, window, rgb_blobs, rgb_boxes, kMaxRgbBlobs);
+		(full_scan ? full_scans : window_scans).increment();
+	}
+	segmented_pixels.increment(segmenter->stats().pixels);
+	if(rgb_tracker){
+		rgb_tracker->update(rgb_blobs, rgb_boxes, count, colors.target_rgb);
+	}
+	updateGoal(rgb_blobs, count);
+}
+
+/************************************************************
+ * Function Name: loadColorSnapshot
+
+ * Description: Reads a colors.txt file and looks up the color
+ 				of the target class. Runs on the watcher thread
+ 				for reloads; a file without the target class is
+ 				rejected like one that does not parse.
+ ***********************************************************/
+
+bool loadColorSnapshot(const std::string& path, const std::string& target_class, ColorSnapshot& colors, std::string& error){
+	if(!colors.table.load(path, error)){
+		return false;
+	}
+	int target = colors.table.findName(target_class);
+	if(target < 0){
+		error = "no class " + target_class + " in " + path;
+		return false;
+	}
+	memcpy(colors.target_rgb, colors.table.colorClass(target).rgb, 3);
+	return true;
+}
+
+/************************************************************
+ * Function Name: processPointCloud
+
+ * Description: Handles one "/camera/depth/points" frame. The
+ 				function computes the number of points that are
+ 				closer than a threshold z_min and raises the
+ 				obstacle_found_flag if the number of points are
+ 				greater than a threshold (10). With
+ 				~coarse_depth_check most frames are decided on a
+ 				subsample of the band. The sector near depths
+ 				update the time to contact estimate, and with
+ 				~motion_detection obstacle_moving_flag is raised
+ 				if a sector closer than min_z holds a moving
+ 				obstacle.
 *************************************************************/
 
-void PointCloud_Callback (const PointCloud::ConstPtr& cloud){
-	double min_z = 0.7;
-	int y_point = 0;
-	std::vector<double> PCL_closest_points;
-
-  	// Iterate through all the points in the image and populate buffer
-  	// if the z coordinate is lesser than threshold (min_z)
-  	for(int k = 0; k < 240; k++){
-    	for(int i = 0; i < 640; i++){
-      		const pcl::PointXYZ & pt=cloud->points[640*(180+k)+(i)];
-      		if((pt.z < min_z)){
-        		PCL_closest_points.push_back(i); 
-      		}
-    	}
-  	}	
+void processPointCloud (const PointCloud& cloud){
+	ALPHA_PKG_NO_ALLOC_SCOPE("processPointCloud");
+	alpha_pkg::ScopedStageTimer stage_timer(*loop_monitor, alpha_pkg::LoopMonitor::STAGE_DEPTH);
+	metrics::ScopedLatency latency(depth_latency);
+	frame_arena.reset();
+	double min_z = follower_params->get().min_z;
+
+  	// Collect the points of the band whose z coordinate is lesser than
+  	// threshold (min_z), and the nearest depth of each sector
+  	alpha_pkg::DepthView view;
+  	view.z = &cloud.points[0].z;
+  	view.stride = sizeof(pcl::PointXYZ)/sizeof(float);
+  	view.width = 640;
+  	view.height = 480;
+  	view.first_row = 0;
+  	alpha_pkg::checkDepthBand(view, min_z, coarse_check, frame_arena, depth_scan, columns_wanted ? column_min_depth : NULL);
+  	depth_points_read.increment(depth_scan.points_read);
+  	(depth_scan.coarse ? coarse_checks : full_checks).increment();
+  	contact_estimator->update(cloud.header.stamp*1e-6, depth_scan.sector_near_depth,
+  							  velocity_output->lastLinear(), velocity_output->lastAngular());
+  	if(motion_detector){
+  		motion_detector->update(cloud.header.stamp*1e-6, view, velocity_output->lastLinear(), velocity_output->lastAngular());
+  		obstacle_moving_flag = (alpha_pkg::closeSectors(depth_scan, min_z) & motion_detector->movingSectors()) != 0;
+  		if(obstacle_moving_flag){
+  			moving_frames.increment();
+  		}
+  	}
+  	columns_valid = columns_wanted;
+  	if(columns_wanted){
+  		scan_pending = true;
+  		scan_stamp = cloud.header.stamp;
+  	}
 	  
 	// Raise obstacle_found_flag if the size of the buffer is greater than
 	// threshold 10
-	if(PCL_closest_points.size() > 10){
+	if(depth_scan.num_close_points > alpha_pkg::kObstaclePointThreshold){
 		obstacle_found_flag = true;
 	}
   	else{
@@ -161,17 +548,54 @@ void PointCloud_Callback (const PointCloud::ConstPtr& cloud){
 }
 
 /************************************************************
- * Function Name: Bumper_Callback
+ * Function Name: PointCloud_Callback
 
  * Description: This is the callback function of the topic
- 				"/mobile_base/events/bumper". The function raises 
+ 				"/camera/depth/points". It accounts the frame and
+ 				hands it to processPointCloud, through the fault
+ 				injector when one is enabled.
+*************************************************************/
+
+void PointCloud_Callback (const PointCloud::ConstPtr& cloud){
+	ALPHA_PKG_NO_ALLOC_SCOPE("PointCloud_Callback");
+	static uint32_t last_seq = 0;
+	static bool has_last_seq = false;
+	countDropped(cloud->header.seq, last_seq, has_last_seq, depth_dropped);
+	depth_frames.increment();
+	last_depth_time = ros::Time::now();
+	if(cloud->header.stamp != 0){
+		// PCL stamps are in microseconds
+		depth_age.observe(last_depth_time.toSec() - cloud->header.stamp*1e-6);
+	}
+
+	if(fault_injector->enabled()){
+		holdFaulted(alpha_pkg::FAULT_DEPTH, last_depth_time.toSec(), cloud, next_cloud_handle,
+					faulted_clouds, faulted_cloud_slots);
+		return;
+	}
+	processPointCloud(*cloud);
+}
+
+/************************************************************
+ * Function Name: processBumper
+
+ * Description: Handles one bumper event. The function raises
  				the obstacle_found_flag and bumper_flag if bumper 
  				press is detected.
 *************************************************************/
 
-void Bumper_Callback (const kobuki_msgs::BumperEvent::ConstPtr& bumper_msg){
+void processBumper (uint8_t bumper_state){
+	alpha_pkg::ScopedStageTimer stage_timer(*loop_monitor, alpha_pkg::LoopMonitor::STAGE_BUMPER);
+	metrics::ScopedLatency latency(bumper_latency);
+
 	// Detect bumper press and raise flag
-	if(bumper_msg->state == 1){
+	if(bumper_state == 1){
+		if(!bumper_flag){
+			bumper_hits.increment();
+		}
+		if(!flight_recorder->trigger("bumper", ros::Time::now().toSec())){
+			ROS_WARN("flight recorder: previous dump still being written, bumper dump skipped");
+		}
     	bumper_flag=true;
     	obstacle_found_flag = true;
     }
@@ -181,66 +605,161 @@ void Bumper_Callback (const kobuki_msgs::BumperEvent::ConstPtr& bumper_msg){
 }
 
 /************************************************************
- * Function Name: rotate
+ * Function Name: Bumper_Callback
 
- * Description: Generic function which makes the robot rotate
- 				about its z axis at constant angular velocity
+ * Description: This is the callback function of the topic
+ 				"/mobile_base/events/bumper". It hands the event
+ 				to processBumper, through the fault injector when
+ 				one is enabled.
 *************************************************************/
 
-void rotate(ros::Publisher velocityPublisher){
-	geometry_msgs::Twist T;
-  	T.linear.x = 0.0; T.linear.y = 0.0; T.linear.z = 0.0;
-  	T.angular.x = 0.0; T.angular.y = 0.0; T.angular.z = angular_speed;
-  	velocityPublisher.publish(T);
+void Bumper_Callback (const kobuki_msgs::BumperEvent::ConstPtr& bumper_msg){
+	if(fault_injector->enabled()){
+		fault_injector->offer(alpha_pkg::FAULT_BUMPER, ros::Time::now().toSec(), 0, bumper_msg->state);
+		return;
+	}
+	processBumper(bumper_msg->state);
 }
 
 /************************************************************
- * Function Name: seek
+ * Function Name: deliverFaultedMessages
 
- * Description: Function to make the robot approach the target.
- 				Control based on generic P control. 
+ * Description: Processes the messages the fault injector has
+ 				released by `now` and lets go of a message after
+ 				its last release. A handle whose ring slot was
+ 				reused meanwhile is skipped; holdFaulted()
+ 				counted it as evicted.
 *************************************************************/
 
-void seek(ros::Publisher velocityPublisher){
-  	float angular_control = -goal_x*angular_speed*0.7;
-
-  	// Limit angular control to within angular_speed_thresh
-  	if(std::abs(angular_control) > angular_speed_thresh){
-    	angular_control = angular_control*angular_speed_thresh / std::abs(angular_control);
-  	}
+template <typename ConstPtr, typename Process>
+void deliverFaulted(uint32_t handle, ConstPtr* messages, FaultedSlot* slots, Process process){
+	uint32_t index = handle % kFaultRing;
+	if(slots[index].handle != handle || !messages[index]){
+		return;
+	}
+	process(*messages[index]);
+	if(--slots[index].releases <= 0){
+		messages[index].reset();
+	}
+}
 
-  	// Publish twist message
-  	geometry_msgs::Twist T;
-  	T.linear.x = linear_speed*0.7; T.linear.y = 0.0; T.linear.z = 0.0;
-  	T.angular.x = 0.0; T.angular.y = 0.0; T.angular.z = angular_control;
-  	velocityPublisher.publish(T);
+void deliverFaultedMessages(double now){
+	alpha_pkg::FaultDelivery delivery;
+	while(fault_injector->poll(now, delivery)){
+		if(delivery.stream == alpha_pkg::FAULT_DEPTH){
+			deliverFaulted(delivery.handle, faulted_clouds, faulted_cloud_slots, processPointCloud);
+		}
+		else if(delivery.stream == alpha_pkg::FAULT_BLOBS){
+			deliverFaulted(delivery.handle, faulted_blobs, faulted_blobs_slots, processBlobs);
+		}
+		else{
+			processBumper(delivery.bumper_state);
+		}
+	}
 }
 
 /************************************************************
- * Function Name: advance
+ * Function Name: initDebugMarkers
 
- * Description: Generic function which makes the robot 
- 				move forward with constant linear velocity.
+ * Description: Sets up the markers of "debug_markers" once:
+ 				0 the nearest depth of each sector as a segment
+ 				across the sector, red below min_z, orange when
+ 				moving; 1 the min_z line; 2 the goal; 3 the
+ 				state text
 *************************************************************/
 
-void advance(ros::Publisher velocityPublisher){
-  geometry_msgs::Twist T;
-  T.linear.x = linear_speed; T.linear.y = 0.0; T.linear.z = 0.0;
-  T.angular.x = 0.0; T.angular.y = 0.0; T.angular.z = 0.0;
-  velocityPublisher.publish(T);
+void initDebugMarkers(visualization_msgs::MarkerArray& markers, const std::string& frame){
+	markers.markers.resize(4);
+	for(int id = 0; id < 4; id++){
+		visualization_msgs::Marker& marker = markers.markers[id];
+		marker.header.frame_id = frame;
+		marker.ns = "alpha_debug";
+		marker.id = id;
+		marker.action = visualization_msgs::Marker::ADD;
+		marker.pose.orientation.w = 1.0;
+		marker.scale.x = marker.scale.y = marker.scale.z = 0.02;
+		marker.color.r = marker.color.g = marker.color.b = marker.color.a = 1.0;
+	}
+	markers.markers[0].type = visualization_msgs::Marker::LINE_LIST;
+	markers.markers[0].points.reserve(2*alpha_pkg::kNumSectors);
+	markers.markers[0].colors.reserve(2*alpha_pkg::kNumSectors);
+	markers.markers[1].type = visualization_msgs::Marker::LINE_STRIP;
+	markers.markers[1].points.resize(2);
+	markers.markers[1].color.g = markers.markers[1].color.b = 0.2;
+	markers.markers[2].type = visualization_msgs::Marker::SPHERE;
+	markers.markers[2].scale.x = markers.markers[2].scale.y = markers.markers[2].scale.z = 0.15;
+	markers.markers[2].color.g = 0.0;
+	markers.markers[3].type = visualization_msgs::Marker::TEXT_VIEW_FACING;
+	markers.markers[3].scale.z = 0.1;
+	markers.markers[3].pose.position.x = 0.5;
+	markers.markers[3].pose.position.z = 0.4;
 }
 
 /************************************************************
- * Function Name: retreat
+ * Function Name: fillDebugMarkers
 
- * Description: Generic function which makes the robot 
- 				move backward with constant linear velocity.
+ * Description: Places the markers in the camera frame (x
+ 				forward, y left) from the last perception
+ 				results. Column c at depth d lies at
+ 				y = d*(cx - c)/fx. The goal is put at the
+ 				nearest depth of its sector, 1 m if the sector
+ 				is empty.
 *************************************************************/
-void retreat(ros::Publisher velocityPublisher){
-  	geometry_msgs::Twist T;
-  	T.linear.x = -linear_speed; T.linear.y = 0.0; T.linear.z = 0.0;
-  	T.angular.x = 0.0; T.angular.y = 0.0; T.angular.z = 0.0;
-  	velocityPublisher.publish(T);
+
+void fillDebugMarkers(visualization_msgs::MarkerArray& markers, const ros::Time& stamp, double fx, double cx, float min_z){
+	for(size_t id = 0; id < markers.markers.size(); id++){
+		markers.markers[id].header.stamp = stamp;
+	}
+
+	visualization_msgs::Marker& sectors = markers.markers[0];
+	sectors.points.clear();
+	sectors.colors.clear();
+	for(int s = 0; s < alpha_pkg::kNumSectors; s++){
+		float depth = depth_scan.sector_min_depth[s];
+		if(!(depth < std::numeric_limits<float>::infinity())){
+			continue;
+		}
+		std_msgs::ColorRGBA color;
+		bool moving = motion_detector && motion_detector->moving(s);
+		color.r = depth < min_z || moving ? 1.0 : 0.2;
+		color.g = moving ? 0.6 : depth < min_z ? 0.2 : 1.0;
+		color.b = 0.2;
+		color.a = 1.0;
+		for(int edge = 0; edge < 2; edge++){
+			geometry_msgs::Point point;
+			point.x = depth;
+			point.y = depth*(cx - (s + edge)*alpha_pkg::kSectorColumns)/fx;
+			point.z = 0;
+			sectors.points.push_back(point);
+			sectors.colors.push_back(color);
+		}
+	}
+	// An empty LINE_LIST is invalid, hide it instead
+	sectors.action = sectors.points.empty() ? visualization_msgs::Marker::DELETE : visualization_msgs::Marker::ADD;
+
+	visualization_msgs::Marker& threshold = markers.markers[1];
+	for(int edge = 0; edge < 2; edge++){
+		threshold.points[edge].x = min_z;
+		threshold.points[edge].y = min_z*(cx - edge*alpha_pkg::kImageWidth)/fx;
+		threshold.points[edge].z = 0;
+	}
+
+	visualization_msgs::Marker& goal = markers.markers[2];
+	goal.action = debug_goal.found ? visualization_msgs::Marker::ADD : visualization_msgs::Marker::DELETE;
+	if(debug_goal.found){
+		float column = debug_goal.x + alpha_pkg::kImageWidth/2;
+		int sector = std::max(0, std::min(alpha_pkg::kNumSectors - 1, static_cast<int>(column)/alpha_pkg::kSectorColumns));
+		float depth = depth_scan.sector_min_depth[sector];
+		depth = depth < std::numeric_limits<float>::infinity() ? depth : 1.0f;
+		goal.pose.position.x = depth;
+		goal.pose.position.y = depth*(cx - column)/fx;
+		goal.pose.position.z = 0;
+	}
+
+	char text[96];
+	snprintf(text, sizeof(text), "state %u  close %lu  goal %u px", state,
+			 (unsigned long)depth_scan.num_close_points, debug_goal.found ? debug_goal.area : 0);
+	markers.markers[3].text = text;
 }
 
 int main (int argc, char** argv)
@@ -250,105 +769,416 @@ int main (int argc, char** argv)
 
   ros::NodeHandle nh;
   ros::Publisher velocityPublisher = nh.advertise<geometry_msgs::Twist>("cmd_vel_mux/input/teleop", 1000);
+  alpha_pkg::VelocityOutput velocityOutput(velocityPublisher, 1e-3, ros::Duration(0.25));
+  velocity_output = &velocityOutput;
+  alpha_pkg::ContactEstimator contactEstimator(alpha_pkg::defaultContactConfig());
+  contact_estimator = &contactEstimator;
+  alpha_pkg::MotionDetector motionDetector(alpha_pkg::defaultMotionConfig());
   ros::Subscriber PCSubscriber = nh.subscribe<PointCloud>("/camera/depth/points", 1, PointCloud_Callback);
   ros::Subscriber BumperSubscriber = nh.subscribe<kobuki_msgs::BumperEvent>("/mobile_base/events/bumper", 1, Bumper_Callback);
-  ros::Subscriber blobsSubscriber = nh.subscribe("/blobs", 50, blobsCallBack);
+
+  // Optional real-time mode for the control thread, which also runs
+  // the callbacks (spinOnce) and the velocity output stage. Applied
+  // right before the loop: threads inherit the policy and the CPU
+  // mask of their creator, and the helper threads (metrics server,
+  // flight recorder writer, file watchers) must not run at the
+  // control loop's priority on its core.
+  ros::NodeHandle private_nh("~");
+  alpha_pkg::RealtimeConfig realtime_config;
+  int prefault_stack_kb;
+  private_nh.param("realtime", realtime_config.enabled, false);
+  private_nh.param("realtime_priority", realtime_config.priority, 80);
+  private_nh.param("control_cpu", realtime_config.cpu, -1);
+  private_nh.param("prefault_stack_kb", prefault_stack_kb, 512);
+  realtime_config.stack_prefault_bytes = prefault_stack_kb*1024;
 
   ros::Rate loop_rate(10);
 
+  // Deadline monitor, summarized on /diagnostics
+  double loop_summary_period;
+  private_nh.param("loop_summary_period", loop_summary_period, 10.0);
+  ros::Publisher diagnosticsPublisher = nh.advertise<diagnostic_msgs::DiagnosticArray>("/diagnostics", 10);
+  alpha_pkg::LoopMonitor loopMonitor(10, diagnosticsPublisher);
+  loop_monitor = &loopMonitor;
+  ros::WallTime last_loop_summary = ros::WallTime::now();
+
+  // Prometheus endpoint on localhost, 0 disables it
+  int metrics_port;
+  private_nh.param("metrics_port", metrics_port, 9105);
+  metrics::MetricsServer metricsServer;
+  if(metrics_port > 0 && metricsServer.start(metrics_port)){
+  	ROS_INFO("metrics: serving http://127.0.0.1:%d/metrics", metrics_port);
+  }
+  uint16_t dwell_state = state;
+
+  // Flight recorder, one record per control cycle
+  double flight_recorder_seconds, watchdog_timeout;
+  std::string flight_recorder_dir;
+  private_nh.param("flight_recorder_seconds", flight_recorder_seconds, 30.0);
+  private_nh.param("flight_recorder_dir", flight_recorder_dir, std::string("/tmp"));
+  private_nh.param("watchdog_timeout", watchdog_timeout, 1.0);
+  alpha_pkg::FlightRecorder flightRecorder(flight_recorder_seconds*10, flight_recorder_dir);
+  flight_recorder = &flightRecorder;
+  ROS_INFO("flight recorder: %lu records (%lu KB) into %s", (unsigned long)flightRecorder.capacity(),
+  		   (unsigned long)flightRecorder.memoryBytes()/1024, flight_recorder_dir.c_str());
+  for(int s = 0; s < alpha_pkg::kNumSectors; s++){
+  	depth_scan.sector_min_depth[s] = std::numeric_limits<float>::infinity();
+  	depth_scan.sector_near_depth[s] = std::numeric_limits<float>::infinity();
+  }
+
+  // Two-level obstacle check: clearly free or blocked frames are
+  // decided on every ~coarse_depth_stride-th row and column
+  bool coarse_depth_check;
+  private_nh.param("coarse_depth_check", coarse_depth_check, false);
+  if(coarse_depth_check){
+  	coarse_check = alpha_pkg::defaultCoarseCheck();
+  	private_nh.param("coarse_depth_stride", coarse_check.stride, coarse_check.stride);
+  }
+
+  // Moving obstacle detection for the controller's wait_time
+  bool motion_detection;
+  private_nh.param("motion_detection", motion_detection, false);
+  motion_detector = motion_detection ? &motionDetector : NULL;
+
+  // Fault injection for robustness tests, off unless configured
+  std::string fault_config_path;
+  private_nh.param("fault_config", fault_config_path, std::string(""));
+  alpha_pkg::FaultConfig fault_config = alpha_pkg::defaultFaultConfig();
+  if(!fault_config_path.empty()){
+  	std::string error;
+  	if(!alpha_pkg::loadFaultConfig(fault_config_path, fault_config, error)){
+  		ROS_FATAL("fault injection: %s", error.c_str());
+  		return 1;
+  	}
+  }
+  alpha_pkg::FaultInjector faultInjector(fault_config, kFaultRing);
+  fault_injector = &faultInjector;
+  alpha_pkg::FaultStats reported_faults = faultInjector.stats();
+  if(faultInjector.enabled()){
+  	ROS_WARN("fault injection enabled from %s (seed %llu)", fault_config_path.c_str(),
+  			 (unsigned long long)fault_config.seed);
+  }
+  // Tunable settings: defaults, then the parameter server, then
+  // ~params_file, which is watched and re-read over the parameter
+  // server values on every save. A file that fails to load keeps
+  // the running snapshot.
+  alpha_pkg::FollowerParams base_params = alpha_pkg::defaultFollowerParams();
+  for(size_t k = 0; k < alpha_pkg::kNumFollowerParameters; k++){
+  	double value;
+  	std::string error;
+  	if(private_nh.getParam(alpha_pkg::kFollowerParameterNames[k], value) &&
+  	   !alpha_pkg::setFollowerParameter(base_params, alpha_pkg::kFollowerParameterNames[k], value, error)){
+  		ROS_FATAL("parameters: %s", error.c_str());
+  		return 1;
+  	}
+  }
+  std::string params_file;
+  private_nh.param("params_file", params_file, std::string(""));
+  alpha_pkg::FollowerParams initial_params = base_params;
+  if(!params_file.empty()){
+  	std::string error;
+  	if(!alpha_pkg::loadFollowerParams(params_file, initial_params, error)){
+  		ROS_FATAL("parameters: %s", error.c_str());
+  		return 1;
+  	}
+  }
+  alpha_pkg::SnapshotStore<alpha_pkg::FollowerParams> paramsStore(initial_params);
+  follower_params = &paramsStore;
+  alpha_pkg::FileWatcher paramsWatcher;
+  if(!params_file.empty()){
+  	std::string error;
+  	bool watching = paramsWatcher.start(params_file, [&](){
+  		alpha_pkg::FollowerParams reloaded = base_params;
+  		std::string reload_error;
+  		if(alpha_pkg::loadFollowerParams(params_file, reloaded, reload_error)){
+  			uint64_t version = paramsStore.publish(reloaded);
+  			params_reloaded.increment();
+  			ROS_INFO("parameters: reloaded %s (version %llu)", params_file.c_str(), (unsigned long long)version);
+  		}
+  		else{
+  			params_rejected.increment();
+  			ROS_WARN("parameters: %s, keeping version %llu", reload_error.c_str(), (unsigned long long)paramsStore.version());
+  		}
+  	}, error);
+  	if(!watching){
+  		ROS_WARN("parameters: %s, live updates disabled", error.c_str());
+  	}
+  }
+
+  // Color classes: the built-in target color, or ~color_file, which
+  // is watched, rebuilt on the watcher thread and swapped in between
+  // frames on every save. With ~segment_rgb the node segments the RGB
+  // image with them instead of listening to cmvision.
+  std::string color_file, target_class;
+  bool segment_rgb, roi_tracking;
+  int min_blob_area;
+  alpha_pkg::TrackerConfig tracker_config = alpha_pkg::defaultTrackerConfig();
+  private_nh.param("color_file", color_file, std::string(""));
+  private_nh.param("target_class", target_class, std::string("PinkOut"));
+  private_nh.param("segment_rgb", segment_rgb, false);
+  private_nh.param("min_blob_area", min_blob_area, 10);
+  private_nh.param("roi_tracking", roi_tracking, false);
+  private_nh.param("roi_full_scan_period", tracker_config.full_scan_period, tracker_config.full_scan_period);
+  private_nh.param("pyramid_search", pyramid_search, false);
+  ColorSnapshot initial_colors;
+  memcpy(initial_colors.target_rgb, alpha_pkg::kTargetColors[alpha_pkg::TARGET_PINK_OUT], 3);
+  if(!color_file.empty()){
+  	std::string error;
+  	if(!loadColorSnapshot(color_file, target_class, initial_colors, error)){
+  		ROS_FATAL("colors: %s", error.c_str());
+  		return 1;
+  	}
+  }
+  else if(segment_rgb){
+  	ROS_FATAL("segment_rgb needs ~color_file");
+  	return 1;
+  }
+  alpha_pkg::SnapshotStore<ColorSnapshot> colorStore(initial_colors);
+  color_store = &colorStore;
+  alpha_pkg::FileWatcher colorWatcher;
+  if(!color_file.empty()){
+  	std::string error;
+  	bool watching = colorWatcher.start(color_file, [&](){
+  		ColorSnapshot reloaded;
+  		std::string reload_error;
+  		if(loadColorSnapshot(color_file, target_class, reloaded, reload_error)){
+  			uint64_t version = colorStore.publish(reloaded);
+  			colors_reloaded.increment();
+  			ROS_INFO("colors: reloaded %s (version %llu)", color_file.c_str(), (unsigned long long)version);
+  		}
+  		else{
+  			colors_rejected.increment();
+  			ROS_WARN("colors: %s, keeping version %llu", reload_error.c_str(), (unsigned long long)colorStore.version());
+  		}
+  	}, error);
+  	if(!watching){
+  		ROS_WARN("colors: %s, live updates disabled", error.c_str());
+  	}
+  }
+  std::unique_ptr<alpha_pkg::Segmenter> rgbSegmenter;
+  std::unique_ptr<alpha_pkg::TargetTracker> rgbTracker;
+  ros::Subscriber blobsSubscriber;
+  if(segment_rgb){
+  	rgbSegmenter.reset(new alpha_pkg::Segmenter(alpha_pkg::kImageWidth, alpha_pkg::kImageHeight, min_blob_area));
+  	segmenter = rgbSegmenter.get();
+  	if(roi_tracking){
+  		rgbTracker.reset(new alpha_pkg::TargetTracker(tracker_config, alpha_pkg::kImageWidth, alpha_pkg::kImageHeight));
+  		rgb_tracker = rgbTracker.get();
+  	}
+  	blobsSubscriber = nh.subscribe<sensor_msgs::Image>("/camera/rgb/image_raw", 1, Image_Callback);
+  }
+  else{
+  	blobsSubscriber = nh.subscribe("/blobs", 50, blobsCallBack);
+  }
+
+  // Band scan for consumers that only need the nearest range per
+  // column. The rays follow the depth camera's intrinsics; the topic
+  // is not "/scan" so it does not clash with depthimage_to_laserscan.
+  double scan_fx, scan_cx;
+  std::string scan_frame;
+  private_nh.param("scan_fx", scan_fx, 525.0);
+  private_nh.param("scan_cx", scan_cx, 319.5);
+  private_nh.param("scan_frame", scan_frame, std::string("camera_depth_frame"));
+  ros::Publisher scanPublisher = nh.advertise<sensor_msgs::LaserScan>("band_scan", 1);
+  alpha_pkg::ScanProjection scan_projection;
+  alpha_pkg::makeScanProjection(scan_fx, scan_cx, scan_projection);
+  sensor_msgs::LaserScan band_scan;
+  band_scan.header.frame_id = scan_frame;
+  band_scan.angle_min = scan_projection.angle_min;
+  band_scan.angle_max = scan_projection.angle_max;
+  band_scan.angle_increment = scan_projection.angle_increment;
+  band_scan.time_increment = 0;
+  band_scan.scan_time = 1.0/30;
+  band_scan.range_min = 0.45;
+  band_scan.range_max = 8.0;
+  band_scan.ranges.resize(alpha_pkg::kImageWidth);
+
+  // Debug topics, built only while subscribed
+  ros::Publisher markersPublisher = nh.advertise<visualization_msgs::MarkerArray>("debug_markers", 1);
+  ros::Publisher imagePublisher = nh.advertise<sensor_msgs::Image>("debug_image", 1);
+  visualization_msgs::MarkerArray debug_markers;
+  initDebugMarkers(debug_markers, scan_frame);
+  sensor_msgs::Image debug_image;
+  debug_image.header.frame_id = scan_frame;
+  debug_image.width = alpha_pkg::kImageWidth;
+  debug_image.height = alpha_pkg::kImageHeight;
+  debug_image.encoding = "rgb8";
+  debug_image.is_bigendian = 0;
+  debug_image.step = 3*alpha_pkg::kImageWidth;
+  debug_goal.found = false;
+
+  last_depth_time = last_blobs_time = ros::Time::now();
+  bool watchdog_fired = false;
+  ros::WallTime state_entered = ros::WallTime::now();
+
   //States variable initialized to 0
   state = 0;
+  alpha_pkg::Controller controller(paramsStore.get().controller);
+  uint64_t applied_version = paramsStore.version();
+  params_version.set(applied_version);
+
+  // Every helper thread is running by now
+  alpha_pkg::configureRealtimeThread("control", realtime_config);
 
   while(ros::ok()){
 
     std::cout<<"state: "<< state << " obstacle found: " << obstacle_found_flag <<  std::endl;
 
-    switch(state){
-      	// Functionalities of state 0
-    	case 0:{
-	      	// If obstacle detected switch to state 2
-	        if(obstacle_found_flag){
-	        	state = 2;
-	          	break;
-	        }
-
-	        // If target detected switch to state 1
-	        if(goal_found_flag){
-	          	state=1;
-	          	break;
-	        }
-	        
-	        // Else rotate in state 0
-	        rotate(velocityPublisher);
-	        break;
-	      }
-
-	    // Functionalities of state 1
-      	case 1:{
-	      	// If obstacle detected switch to state 2	
-	        if(obstacle_found_flag){
-	        	state=2;	
-	          	break;
-	        }
-
-	        // If target lost switch to state 0
-	        if(!goal_found_flag){
-	        	state=0;
-	        	break;
-	        }
-
-	        // Else seek in state 1
-	        seek(velocityPublisher);
-	        break;
-	      }
-
-	    // Functionalities of state 2
-	    case 2:{
-	      	// If detected obstacle is target switch to state 3
-	        if(goal_blob_area > (image_width*image_height*0.1)){
-	        	state=3;
-	          	break;
-	        }
-	        
-	        // If obstacle detected is via bumper then execute retreat,
-	        // rotate, advance and revert to state 0
-	        if(bumper_flag){
-	        	for(int i=0;i<40000;i++){
-	            	retreat(velocityPublisher);
-	          	}
-	          	for(int i=0;i<40000;i++){
-	            	rotate(velocityPublisher);
-	         	}
-	          	for(int i=0;i<40000;i++){
-	            	advance(velocityPublisher);
-	          	}
-	          	state=0;
-	          	break;
-	        }
-
-	        // If obstacle detected is via depth then rotate and
-	        // advance and revert to state 0
-	        if(obstacle_found_flag){
-	        	rotate(velocityPublisher);
-	        }
-	        else{
-	         	for(int i=0;i<100000;i++){
-	            	advance(velocityPublisher);
-	          	}
-	          	state = 0;
-	        }
-	        break;
-	      }
-
-	    // Functionalities of state 3 
-	    case 3:{
-	    	// Stay in state 3 forever
-        	state=3;
-        	break;
-      	}
+    // Snapshots read during the previous cycle are no longer in
+    // use; pick up reloaded parameters
+    paramsStore.quiescent();
+    colorStore.quiescent();
+    if(paramsStore.version() != applied_version){
+    	applied_version = paramsStore.version();
+    	controller.setConfig(paramsStore.get().controller);
+    	params_version.set(applied_version);
     }
 
-    ros::spinOnce();
-    loop_rate.sleep();
+    ros::WallTime control_start = ros::WallTime::now();
+    alpha_pkg::ControllerInputs inputs;
+    inputs.goal_found = goal_found_flag;
+    inputs.obstacle_found = obstacle_found_flag;
+    inputs.obstacle_moving = obstacle_moving_flag;
+    inputs.bumper = bumper_flag;
+    inputs.goal_area = goal_blob_area;
+    inputs.goal_x = goal_x;
+    int contact_sector = contactEstimator.nearestContact(velocityOutput.lastLinear());
+    inputs.contact_depth = contact_sector < 0 ? std::numeric_limits<float>::infinity() : contactEstimator.depth(contact_sector);
+    inputs.contact_closing_speed = contact_sector < 0 ? 0.0f : contactEstimator.closingSpeed(contact_sector);
+    alpha_pkg::Command command;
+    if(controller.step(ros::Time::now().toSec(), inputs, command)){
+    	velocityOutput.command(command.linear, command.angular);
+    }
+    if(controller.speedLimited()){
+    	contact_limited.increment();
+    }
+    if(controller.waiting()){
+    	waiting_cycles.increment();
+    }
+    state = controller.state();
+    loopMonitor.addStageTime(alpha_pkg::LoopMonitor::STAGE_CONTROL, (ros::WallTime::now() - control_start).toSec());
+
+    // Account the time spent in the state just left
+    if(state != dwell_state){
+    	ros::WallTime now = ros::WallTime::now();
+    	state_dwell[dwell_state]->observe((now - state_entered).toSec());
+    	if(state == 3){
+    		goals_reached.increment();
+    	}
+    	dwell_state = state;
+    	state_entered = now;
+    }
+    current_state.set(state);
+
+    // Record this cycle's decision
+    alpha_pkg::FlightRecord record;
+    record.stamp = ros::Time::now().toSec();
+    record.state = state;
+    record.flags = (goal_found_flag ? alpha_pkg::FLIGHT_GOAL_FOUND : 0) |
+    			   (obstacle_found_flag ? alpha_pkg::FLIGHT_OBSTACLE_FOUND : 0) |
+    			   (bumper_flag ? alpha_pkg::FLIGHT_BUMPER : 0) |
+    			   (obstacle_moving_flag ? alpha_pkg::FLIGHT_OBSTACLE_MOVING : 0);
+    record.goal_blob_area = goal_blob_area < 65535 ? goal_blob_area : 65535;
+    record.close_points = depth_scan.num_close_points;
+    record.goal_x = goal_x;
+    record.cmd_linear = velocityOutput.lastLinear();
+    record.cmd_angular = velocityOutput.lastAngular();
+    for(int s = 0; s < alpha_pkg::kNumSectors; s++){
+    	record.sector_min_depth[s] = depth_scan.sector_min_depth[s];
+    }
+    flightRecorder.record(record);
+
+    // Watchdog: dump once when a sensor stream goes silent
+    ros::Time now = ros::Time::now();
+    bool stalled = (now - last_depth_time).toSec() > watchdog_timeout ||
+    			   (now - last_blobs_time).toSec() > watchdog_timeout;
+    if(stalled && !watchdog_fired){
+    	ROS_WARN("watchdog: no depth or blobs for %.1f s, dumping flight recorder", watchdog_timeout);
+    	watchdog_fired = flightRecorder.trigger("watchdog", now.toSec());
+    }
+    else if(!stalled){
+    	watchdog_fired = false;
+    }
+
+    {
+    	alpha_pkg::ScopedOuterStageTimer spin_timer(loopMonitor, alpha_pkg::LoopMonitor::STAGE_SPIN);
+    	ros::spinOnce();
+    }
+
+    // Messages the fault injector releases by now
+    if(faultInjector.enabled()){
+    	{
+    		alpha_pkg::ScopedOuterStageTimer faults_timer(loopMonitor, alpha_pkg::LoopMonitor::STAGE_FAULTS);
+    		deliverFaultedMessages(ros::Time::now().toSec());
+    	}
+    	const alpha_pkg::FaultStats& faults = faultInjector.stats();
+    	for(int s = 0; s < alpha_pkg::NUM_FAULT_STREAMS; s++){
+    		faults_dropped.increment(faults.dropped[s] - reported_faults.dropped[s]);
+    		faults_duplicated.increment(faults.duplicated[s] - reported_faults.duplicated[s]);
+    		faults_reordered.increment(faults.reordered[s] - reported_faults.reordered[s]);
+    	}
+    	faults_bounces.increment(faults.bounces - reported_faults.bounces);
+    	faults_overflows.increment(faults.overflows - reported_faults.overflows);
+    	reported_faults = faults;
+    }
+
+    // Publish the band scan of the last depth frame, and ask the
+    // next frames for one only while someone listens
+    bool scan_subscribed = scanPublisher.getNumSubscribers() > 0;
+    if(scan_pending && scan_subscribed){
+    	band_scan.header.stamp.fromNSec(scan_stamp*1000);
+    	alpha_pkg::columnDepthToRanges(column_min_depth, scan_projection, &band_scan.ranges[0]);
+    	scanPublisher.publish(band_scan);
+    }
+    scan_pending = false;
+
+    // Debug topics, from what the callbacks kept for them
+    bool markers_subscribed = markersPublisher.getNumSubscribers() > 0;
+    bool image_subscribed = imagePublisher.getNumSubscribers() > 0;
+    if(debug_wanted && markers_subscribed){
+    	fillDebugMarkers(debug_markers, now, scan_fx, scan_cx, paramsStore.get().min_z);
+    	markersPublisher.publish(debug_markers);
+    }
+    if(debug_wanted && image_subscribed){
+    	if(debug_image.data.empty()){
+    		debug_image.data.resize(debug_image.step*debug_image.height);
+    	}
+    	alpha_pkg::OverlayFrame overlay;
+    	overlay.scan = &depth_scan;
+    	overlay.column_min_depth = columns_valid ? column_min_depth : NULL;
+    	overlay.min_z = paramsStore.get().min_z;
+    	overlay.blobs = debug_blobs;
+    	overlay.num_blobs = num_debug_blobs;
+    	overlay.goal = debug_goal;
+    	overlay.state = state;
+    	alpha_pkg::drawOverlay(overlay, &debug_image.data[0], debug_image.step);
+    	debug_image.header.stamp = now;
+    	imagePublisher.publish(debug_image);
+    }
+    debug_wanted = markers_subscribed || image_subscribed;
+    columns_wanted = scan_subscribed || image_subscribed;
+
+    bool met_deadline = loop_rate.sleep();
+    loopMonitor.endCycle(met_deadline);
+    if(!met_deadline){
+    	control_overruns.increment();
+    }
+    if(!met_deadline && realtime_config.enabled){
+    	ROS_WARN_THROTTLE(1.0, "control loop missed its deadline: cycle took %.1f ms",
+    					  loop_rate.cycleTime().toSec()*1000.0);
+    }
+
+    // Publish the deadline summary
+    if(ros::WallTime::now() - last_loop_summary >= ros::WallDuration(loop_summary_period)){
+    	loopMonitor.publishSummary();
+    	last_loop_summary = ros::WallTime::now();
+    }
+
+    // Log the publish reduction every 10 s
+    static ros::WallTime last_stats_report = ros::WallTime::now();
+    if(ros::WallTime::now() - last_stats_report >= ros::WallDuration(10.0)){
+    	velocityOutput.reportStats();
+    	last_stats_report = ros::WallTime::now();
+    }
   }
 }
\ No newline at end of file
@@ -0,0 +1,211 @@
+/************************************************************
+ * Name: color_table.cpp
+
+ * Description: Implementation of the colors.txt parser and the
+ 				lookup tables declared in color_table.h
+ ************************************************************/
+
+#include <alpha_pkg/color_table.h>
+#include <fstream>
+#include <sstream>
+#include <stdio.h>
+#include <string.h>
+
+namespace alpha_pkg {
+
+namespace {
+
+std::string trim(const std::string& text){
+	size_t first = text.find_first_not_of(" \t\r\n");
+	if(first == std::string::npos){
+		return "";
+	}
+	size_t last = text.find_last_not_of(" \t\r\n");
+	return text.substr(first, last - first + 1);
+}
+
+bool inByteRange(int value){
+	return value >= 0 && value <= 255;
+}
+
+} // namespace
+
+ColorTable::ColorTable(){
+	rebuild();
+}
+
+void ColorTable::clear(){
+	classes_.clear();
+	rebuild();
+}
+
+bool ColorTable::addClass(const ColorClass& color){
+	if(classes_.size() == static_cast<size_t>(kMaxColorClasses)){
+		return false;
+	}
+	classes_.push_back(color);
+	rebuild();
+	return true;
+}
+
+void ColorTable::rebuild(){
+	memset(y_class_, 0, sizeof(y_class_));
+	memset(u_class_, 0, sizeof(u_class_));
+	memset(v_class_, 0, sizeof(v_class_));
+	for(size_t i = 0; i < classes_.size(); i++){
+		const ColorClass& color = classes_[i];
+		uint32_t bit = 1u << i;
+		for(int k = color.y_low; k <= color.y_high; k++) y_class_[k] |= bit;
+		for(int k = color.u_low; k <= color.u_high; k++) u_class_[k] |= bit;
+		for(int k = color.v_low; k <= color.v_high; k++) v_class_[k] |= bit;
+	}
+}
+
+int ColorTable::find(const uint8_t* rgb) const {
+	for(size_t i = 0; i < classes_.size(); i++){
+		if(memcmp(classes_[i].rgb, rgb, 3) == 0){
+			return static_cast<int>(i);
+		}
+	}
+	return -1;
+}
+
+int ColorTable::findName(const std::string& name) const {
+	for(size_t i = 0; i < classes_.size(); i++){
+		if(classes_[i].name == name){
+			return static_cast<int>(i);
+		}
+	}
+	return -1;
+}
+
+bool ColorTable::load(const std::string& path, std::string& error){
+	std::ifstream in(path.c_str());
+	if(!in){
+		error = "cannot open " + path;
+		return false;
+	}
+	std::stringstream text;
+	text << in.rdbuf();
+	if(!parse(text.str(), error)){
+		error = path + ": " + error;
+		return false;
+	}
+	return true;
+}
+
+/************************************************************
+ * Function Name: parse
+
+ * Description: Reads both sections. Blank lines are skipped,
+ 				anything else that does not parse is an error,
+ 				and so is a color without thresholds. The table
+ 				is left untouched on error.
+*************************************************************/
+
+bool ColorTable::parse(const std::string& text, std::string& error){
+	std::vector<ColorClass> classes;
+	size_t thresholds = 0;
+	enum { NONE, COLORS, THRESHOLDS } section = NONE;
+
+	std::istringstream in(text);
+	std::string line;
+	int line_number = 0;
+	while(std::getline(in, line)){
+		line_number++;
+		line = trim(line);
+		if(line.empty()){
+			continue;
+		}
+
+		char where[32];
+		snprintf(where, sizeof(where), "line %d: ", line_number);
+		if(line == "[Colors]"){
+			section = COLORS;
+			continue;
+		}
+		if(line == "[Thresholds]"){
+			section = THRESHOLDS;
+			continue;
+		}
+
+		if(section == COLORS){
+			int r, g, b, expected, consumed = 0;
+			float merge;
+			if(sscanf(line.c_str(), " ( %d , %d , %d ) %f %d %n", &r, &g, &b, &merge, &expected, &consumed) != 5 ||
+			   !inByteRange(r) || !inByteRange(g) || !inByteRange(b)){
+				error = std::string(where) + "bad color \"" + line + "\"";
+				return false;
+			}
+			if(classes.size() == static_cast<size_t>(kMaxColorClasses)){
+				error = std::string(where) + "too many colors";
+				return false;
+			}
+			ColorClass color;
+			color.name = trim(line.substr(consumed));
+			color.rgb[0] = r; color.rgb[1] = g; color.rgb[2] = b;
+			color.merge = merge;
+			color.expected_blobs = expected;
+			color.y_low = color.u_low = color.v_low = 255;
+			color.y_high = color.u_high = color.v_high = 0;
+			classes.push_back(color);
+		}
+		else if(section == THRESHOLDS){
+			int y0, y1, u0, u1, v0, v1;
+			if(sscanf(line.c_str(), " ( %d : %d , %d : %d , %d : %d )", &y0, &y1, &u0, &u1, &v0, &v1) != 6 ||
+			   !inByteRange(y0) || !inByteRange(y1) || !inByteRange(u0) ||
+			   !inByteRange(u1) || !inByteRange(v0) || !inByteRange(v1)){
+				error = std::string(where) + "bad threshold \"" + line + "\"";
+				return false;
+			}
+			if(thresholds == classes.size()){
+				error = std::string(where) + "threshold without a color";
+				return false;
+			}
+			ColorClass& color = classes[thresholds++];
+			color.y_low = y0; color.y_high = y1;
+			color.u_low = u0; color.u_high = u1;
+			color.v_low = v0; color.v_high = v1;
+		}
+		else{
+			error = std::string(where) + "text outside a section";
+			return false;
+		}
+	}
+
+	if(thresholds != classes.size()){
+		error = "color \"" + classes[thresholds].name + "\" has no threshold";
+		return false;
+	}
+	classes_.swap(classes);
+	rebuild();
+	return true;
+}
+
+bool ColorTable::save(const std::string& path, std::string& error) const {
+	FILE* file = fopen(path.c_str(), "w");
+	if(!file){
+		error = "cannot create " + path;
+		return false;
+	}
+	fprintf(file, "[Colors]\n");
+	for(size_t i = 0; i < classes_.size(); i++){
+		const ColorClass& color = classes_[i];
+		fprintf(file, "(%d, %d, %d) %f %d %s\n", color.rgb[0], color.rgb[1], color.rgb[2],
+				color.merge, color.expected_blobs, color.name.c_str());
+	}
+	fprintf(file, "\n\n[Thresholds]\n");
+	for(size_t i = 0; i < classes_.size(); i++){
+		const ColorClass& color = classes_[i];
+		fprintf(file, "( %d:%d, %d:%d, %d:%d )\n", color.y_low, color.y_high,
+				color.u_low, color.u_high, color.v_low, color.v_high);
+	}
+	bool ok = !ferror(file);
+	if(fclose(file) != 0 || !ok){
+		error = "cannot write " + path;
+		return false;
+	}
+	return true;
+}
+
+} // namespace alpha_pkg
@@ -0,0 +1,105 @@
+/************************************************************
+ * Name: contact_estimator.cpp
+
+ * Description: Implementation of the time to contact estimate
+ 				declared in contact_estimator.h
+ ************************************************************/
+
+#include <alpha_pkg/contact_estimator.h>
+#include <limits>
+#include <math.h>
+
+namespace alpha_pkg {
+
+namespace {
+
+const float kInf = std::numeric_limits<float>::infinity();
+
+} // namespace
+
+ContactConfig defaultContactConfig(){
+	ContactConfig config;
+	config.smoothing = 0.2f;
+	config.max_speed = 1.5f;
+	config.max_turn = 0.05f;
+	config.max_interval = 0.5f;
+	config.first_sector = kNumSectors/4;
+	config.last_sector = 3*kNumSectors/4 - 1;
+	return config;
+}
+
+ContactEstimator::ContactEstimator(const ContactConfig& config) : config_(config) {
+	reset();
+}
+
+void ContactEstimator::reset(){
+	has_previous_ = false;
+	stamp_ = 0;
+	for(int s = 0; s < kNumSectors; s++){
+		depth_[s] = kInf;
+		closing_[s] = 0;
+		tracked_[s] = false;
+	}
+}
+
+/************************************************************
+ * Function Name: update
+
+ * Description: Compares each sector with the previous frame
+ 				when the interval and the turn allow it. The
+ 				closing speed of a static obstacle is the
+ 				distance driven over the interval, so what
+ 				remains after taking off `linear` is the
+ 				obstacle's own. A sector without a depth in
+ 				either frame, or with a jump, starts over.
+*************************************************************/
+
+void ContactEstimator::update(double stamp, const float* near_depth, float linear, float angular){
+	double dt = stamp - stamp_;
+	bool compare = has_previous_ && dt > 0 && dt <= config_.max_interval &&
+				   fabs(angular*dt) <= config_.max_turn;
+
+	for(int s = 0; s < kNumSectors; s++){
+		float depth = near_depth[s];
+		bool valid = compare && depth < kInf && depth_[s] < kInf;
+		float closing = valid ? static_cast<float>((depth_[s] - depth)/dt) - linear : 0.0f;
+		if(!valid || fabsf(closing) > config_.max_speed){
+			closing_[s] = 0;
+			tracked_[s] = false;
+		}
+		else if(tracked_[s]){
+			closing_[s] += config_.smoothing*(closing - closing_[s]);
+		}
+		else{
+			closing_[s] = closing;
+			tracked_[s] = true;
+		}
+		depth_[s] = depth;
+	}
+	stamp_ = stamp;
+	has_previous_ = true;
+}
+
+// A sector without an estimate is taken as static
+float ContactEstimator::timeToContact(int sector, float linear) const {
+	float speed = linear + closing_[sector];
+	if(!(depth_[sector] < kInf) || speed <= 0){
+		return kInf;
+	}
+	return depth_[sector]/speed;
+}
+
+int ContactEstimator::nearestContact(float linear) const {
+	int nearest = -1;
+	float shortest = kInf;
+	for(int s = config_.first_sector; s <= config_.last_sector; s++){
+		float time = timeToContact(s, linear);
+		if(time < shortest){
+			shortest = time;
+			nearest = s;
+		}
+	}
+	return nearest;
+}
+
+} // namespace alpha_pkg
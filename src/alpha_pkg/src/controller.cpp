@@ -0,0 +1,287 @@
+/************************************************************
+ * Name: controller.cpp
+
+ * Description: Implementation of the follower state machine
+ 				declared in controller.h
+ ************************************************************/
+
+#include <alpha_pkg/controller.h>
+#include <alpha_pkg/key_value_file.h>
+#include <alpha_pkg/perception.h>
+#include <math.h>
+#include <stdlib.h>
+
+namespace alpha_pkg {
+
+ControllerConfig defaultControllerConfig(){
+	ControllerConfig config;
+	config.linear_speed = 0.15;
+	config.angular_speed = 0.7;
+	config.angular_speed_thresh = 0.3;
+	config.seek_gain = 0.7;
+	config.seek_speed_scale = 0.7;
+	config.goal_reached_area = kImageWidth*kImageHeight*0.1;
+	config.retreat_time = 0.5;
+	config.turn_time = 0.5;
+	config.advance_time = 0.5;
+	config.clear_advance_time = 1.0;
+	config.contact_time = 0.0;
+	config.wait_time = 0.0;
+	return config;
+}
+
+bool setControllerParameter(ControllerConfig& config, const std::string& key, float value){
+	struct Field { const char* key; float* value; };
+	Field fields[] = {
+		{"linear_speed", &config.linear_speed},
+		{"angular_speed", &config.angular_speed},
+		{"angular_speed_thresh", &config.angular_speed_thresh},
+		{"seek_gain", &config.seek_gain},
+		{"seek_speed_scale", &config.seek_speed_scale},
+		{"goal_reached_area", &config.goal_reached_area},
+		{"retreat_time", &config.retreat_time},
+		{"turn_time", &config.turn_time},
+		{"advance_time", &config.advance_time},
+		{"clear_advance_time", &config.clear_advance_time},
+		{"contact_time", &config.contact_time},
+		{"wait_time", &config.wait_time}};
+	const size_t num_fields = sizeof(fields)/sizeof(fields[0]);
+
+	for(size_t f = 0; f < num_fields; f++){
+		if(key == fields[f].key){
+			*fields[f].value = value;
+			return true;
+		}
+	}
+	return false;
+}
+
+bool loadControllerConfig(const std::string& path, ControllerConfig& config, std::string& error){
+	return readKeyValueFile(path, [&config](const std::string& key, const std::string& value, std::string& error){
+		double number;
+		if(!parseNumber(key, value, number, error)){
+			return false;
+		}
+		if(!setControllerParameter(config, key, number)){
+			error = "unknown key '" + key + "'";
+			return false;
+		}
+		return true;
+	}, error);
+}
+
+Controller::Controller(const ControllerConfig& config)
+	: config_(config), state_(0), num_phases_(0), phase_(0), phase_end_(0), speed_limited_(false),
+	  waiting_(false), wait_end_(-1) {}
+
+/************************************************************
+ * Function Name: rotate
+
+ * Description: Generic function which makes the robot rotate
+ 				about its z axis at constant angular velocity
+*************************************************************/
+
+void Controller::rotate(Command& command) const {
+	command.linear = 0.0;
+	command.angular = config_.angular_speed;
+}
+
+/************************************************************
+ * Function Name: seek
+
+ * Description: Function to make the robot approach the target.
+ 				Control based on generic P control. 
+*************************************************************/
+
+void Controller::seek(const ControllerInputs& inputs, Command& command) const {
+	float angular_control = -inputs.goal_x*config_.angular_speed*config_.seek_gain;
+
+	// Limit angular control to within angular_speed_thresh
+	if(fabsf(angular_control) > config_.angular_speed_thresh){
+		angular_control = angular_control*config_.angular_speed_thresh / fabsf(angular_control);
+	}
+
+	command.linear = config_.linear_speed*config_.seek_speed_scale;
+	command.angular = angular_control;
+}
+
+void Controller::addPhase(float linear, float angular, float duration){
+	phases_[num_phases_].command.linear = linear;
+	phases_[num_phases_].command.angular = angular;
+	phases_[num_phases_].duration = duration;
+	num_phases_++;
+}
+
+void Controller::startManeuver(double now){
+	phase_ = 0;
+	phase_end_ = now + phases_[0].duration;
+}
+
+/************************************************************
+ * Function Name: step
+
+ * Description: One cycle of the state machine, then the cap on
+ 				forward speed: at speed v the obstacle ahead is
+ 				reached in contact_depth/(v + closing speed), so
+ 				v is kept at or under contact_depth/contact_time
+ 				less the closing speed, down to a stop for an
+ 				obstacle coming in fast. Reversing and turning
+ 				are never capped.
+*************************************************************/
+
+bool Controller::step(double now, const ControllerInputs& inputs, Command& command){
+	bool send = decide(now, inputs, command);
+	speed_limited_ = false;
+	if(send && config_.contact_time > 0 && command.linear > 0){
+		float limit = inputs.contact_depth/config_.contact_time - inputs.contact_closing_speed;
+		if(command.linear > limit){
+			command.linear = limit > 0 ? limit : 0.0f;
+			speed_limited_ = true;
+		}
+	}
+	return send;
+}
+
+/************************************************************
+ * Function Name: waitFor
+
+ * Description: True while the robot should stay stopped for a
+ 				moving obstacle: from the first cycle it is seen
+ 				until wait_time later. The wait is armed again
+ 				once the obstacle is gone.
+*************************************************************/
+
+bool Controller::waitFor(double now, const ControllerInputs& inputs){
+	if(config_.wait_time <= 0 || !inputs.obstacle_moving || inputs.bumper){
+		return false;
+	}
+	if(wait_end_ < 0){
+		wait_end_ = now + config_.wait_time;
+	}
+	return now < wait_end_;
+}
+
+/************************************************************
+ * Function Name: decide
+
+ * Description: The state machine. While a maneuver is running
+ 				its phases are played out and the inputs are
+ 				ignored; when it ends the robot is back in
+ 				state 0.
+*************************************************************/
+
+bool Controller::decide(double now, const ControllerInputs& inputs, Command& command){
+	if(maneuvering()){
+		while(phase_ < num_phases_ && now >= phase_end_){
+			phase_++;
+			if(phase_ < num_phases_){
+				phase_end_ += phases_[phase_].duration;
+			}
+		}
+		if(phase_ < num_phases_){
+			command = phases_[phase_].command;
+			return true;
+		}
+		state_ = 0;
+	}
+
+	waiting_ = false;
+	if(!inputs.obstacle_found){
+		wait_end_ = -1;
+	}
+	switch(state_){
+		// Functionalities of state 0
+		case 0:{
+			// If obstacle detected switch to state 2, unless it is
+			// moving: then stop and let it pass first
+			if(inputs.obstacle_found){
+				if(waitFor(now, inputs)){
+					waiting_ = true;
+					command.linear = 0.0;
+					command.angular = 0.0;
+					return true;
+				}
+				state_ = 2;
+				return false;
+			}
+
+			// If target detected switch to state 1
+			if(inputs.goal_found){
+				state_ = 1;
+				return false;
+			}
+
+			// Else rotate in state 0
+			rotate(command);
+			return true;
+		}
+
+		// Functionalities of state 1
+		case 1:{
+			// If obstacle detected switch to state 2, unless it is
+			// moving: then stop and let it pass first
+			if(inputs.obstacle_found){
+				if(waitFor(now, inputs)){
+					waiting_ = true;
+					command.linear = 0.0;
+					command.angular = 0.0;
+					return true;
+				}
+				state_ = 2;
+				return false;
+			}
+
+			// If target lost switch to state 0
+			if(!inputs.goal_found){
+				state_ = 0;
+				return false;
+			}
+
+			// Else seek in state 1
+			seek(inputs, command);
+			return true;
+		}
+
+		// Functionalities of state 2
+		case 2:{
+			// If detected obstacle is target switch to state 3
+			if(inputs.goal_area > config_.goal_reached_area){
+				state_ = 3;
+				return false;
+			}
+
+			// If obstacle detected is via bumper then retreat, rotate
+			// and advance, then revert to state 0
+			if(inputs.bumper){
+				num_phases_ = 0;
+				addPhase(-config_.linear_speed, 0.0, config_.retreat_time);
+				addPhase(0.0, config_.angular_speed, config_.turn_time);
+				addPhase(config_.linear_speed, 0.0, config_.advance_time);
+				startManeuver(now);
+				command = phases_[0].command;
+				return true;
+			}
+
+			// If obstacle detected is via depth then rotate, else
+			// advance and revert to state 0
+			if(inputs.obstacle_found){
+				rotate(command);
+				return true;
+			}
+			num_phases_ = 0;
+			addPhase(config_.linear_speed, 0.0, config_.clear_advance_time);
+			startManeuver(now);
+			command = phases_[0].command;
+			return true;
+		}
+
+		// Functionalities of state 3
+		default:{
+			// Stay in state 3 forever
+			state_ = 3;
+			return false;
+		}
+	}
+}
+
+} // namespace alpha_pkg
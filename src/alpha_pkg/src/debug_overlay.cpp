@@ -0,0 +1,187 @@
+/************************************************************
+ * Name: debug_overlay.cpp
+
+ * Description: Implementation of the debug image declared in
+ 				debug_overlay.h
+ ************************************************************/
+
+#include <alpha_pkg/debug_overlay.h>
+#include <math.h>
+#include <string.h>
+
+namespace alpha_pkg {
+
+namespace {
+
+const uint8_t kWhite[3] = {255, 255, 255};
+const uint8_t kYellow[3] = {255, 230, 0};
+const uint8_t kCyan[3] = {0, 220, 255};
+const uint8_t kMagenta[3] = {255, 0, 255};
+const uint8_t kAlarm[3] = {255, 40, 40};
+const uint8_t kEmpty[3] = {45, 45, 45};
+
+// Depth shown at the top of the band by the column profile
+const float kProfileRange = 4.0f;
+
+// 3x5 digits, one row of 3 bits per nibble, top row first
+const uint32_t kDigits[10] = {
+	0x75557, 0x26227, 0x71747, 0x71717, 0x55711,
+	0x74717, 0x74757, 0x71111, 0x75757, 0x75717
+};
+const int kGlyphScale = 4;
+
+inline void setPixel(uint8_t* rgb, size_t step, int x, int y, const uint8_t* color){
+	if(x >= 0 && x < kImageWidth && y >= 0 && y < kImageHeight){
+		uint8_t* pixel = rgb + y*step + 3*x;
+		pixel[0] = color[0];
+		pixel[1] = color[1];
+		pixel[2] = color[2];
+	}
+}
+
+void fillRect(uint8_t* rgb, size_t step, int x0, int y0, int x1, int y1, const uint8_t* color){
+	x0 = x0 < 0 ? 0 : x0;
+	y0 = y0 < 0 ? 0 : y0;
+	x1 = x1 > kImageWidth ? kImageWidth : x1;
+	y1 = y1 > kImageHeight ? kImageHeight : y1;
+	for(int y = y0; y < y1; y++){
+		for(int x = x0; x < x1; x++){
+			uint8_t* pixel = rgb + y*step + 3*x;
+			pixel[0] = color[0];
+			pixel[1] = color[1];
+			pixel[2] = color[2];
+		}
+	}
+}
+
+void drawBox(uint8_t* rgb, size_t step, int x0, int y0, int x1, int y1, const uint8_t* color){
+	fillRect(rgb, step, x0, y0, x1, y0 + 1, color);
+	fillRect(rgb, step, x0, y1 - 1, x1, y1, color);
+	fillRect(rgb, step, x0, y0, x0 + 1, y1, color);
+	fillRect(rgb, step, x1 - 1, y0, x1, y1, color);
+}
+
+// Prints `value` from (x, y) and returns the x after it
+int drawNumber(uint8_t* rgb, size_t step, int x, int y, unsigned long value, const uint8_t* color){
+	char digits[24];
+	int count = 0;
+	do{
+		digits[count++] = value % 10;
+		value /= 10;
+	} while(value > 0);
+
+	while(count > 0){
+		uint32_t glyph = kDigits[static_cast<int>(digits[--count])];
+		for(int row = 0; row < 5; row++){
+			for(int col = 0; col < 3; col++){
+				if(glyph & (1u << (4*(4 - row) + 2 - col))){
+					fillRect(rgb, step, x + col*kGlyphScale, y + row*kGlyphScale,
+							 x + (col + 1)*kGlyphScale, y + (row + 1)*kGlyphScale, color);
+				}
+			}
+		}
+		x += 4*kGlyphScale;
+	}
+	return x;
+}
+
+// Dim red to dim green over [min_z, kProfileRange]
+void depthColor(float depth, float min_z, uint8_t* color){
+	if(!(depth < INFINITY)){
+		memcpy(color, kEmpty, 3);
+		return;
+	}
+	if(depth < min_z){
+		memcpy(color, kAlarm, 3);
+		return;
+	}
+	float t = (depth - min_z)/(kProfileRange - min_z);
+	t = t > 1 ? 1 : t;
+	color[0] = static_cast<uint8_t>(120*(1 - t));
+	color[1] = static_cast<uint8_t>(120*t);
+	color[2] = 20;
+}
+
+} // namespace
+
+/************************************************************
+ * Function Name: drawOverlay
+
+ * Description: Clears the image and draws the layers back to
+ 				front: sector shading, band outline, close
+ 				columns, depth profile, blobs, goal and the
+ 				text of the top left corner
+*************************************************************/
+
+void drawOverlay(const OverlayFrame& frame, uint8_t* rgb, size_t step){
+	for(int y = 0; y < kImageHeight; y++){
+		memset(rgb + y*step, 0, 3*kImageWidth);
+	}
+	const int band_top = kBandFirstRow;
+	const int band_bottom = kBandFirstRow + kBandRows;
+
+	// Sectors, shaded by their nearest depth
+	for(int s = 0; s < kNumSectors; s++){
+		uint8_t color[3];
+		depthColor(frame.scan->sector_min_depth[s], frame.min_z, color);
+		fillRect(rgb, step, s*kSectorColumns, band_top, (s + 1)*kSectorColumns, band_bottom, color);
+		fillRect(rgb, step, s*kSectorColumns, band_top, s*kSectorColumns + 1, band_bottom, kWhite);
+	}
+	drawBox(rgb, step, 0, band_top, kImageWidth, band_bottom, kWhite);
+
+	// Columns holding points closer than min_z
+	bool close[kImageWidth];
+	memset(close, 0, sizeof(close));
+	for(size_t p = 0; p < frame.scan->num_close_columns; p++){
+		close[frame.scan->close_columns[p]] = true;
+	}
+	for(int x = 0; x < kImageWidth; x++){
+		if(close[x]){
+			fillRect(rgb, step, x, band_top, x + 1, band_top + 12, kYellow);
+			fillRect(rgb, step, x, band_bottom - 12, x + 1, band_bottom, kYellow);
+		}
+	}
+
+	// Nearest depth per column, near at the bottom of the band,
+	// and the min_z threshold as a dashed line
+	if(frame.column_min_depth){
+		for(int x = 0; x < kImageWidth; x++){
+			float depth = frame.column_min_depth[x];
+			if(depth < kProfileRange){
+				int y = band_bottom - 1 - static_cast<int>(depth/kProfileRange*(kBandRows - 1));
+				setPixel(rgb, step, x, y, kCyan);
+				setPixel(rgb, step, x, y + 1, kCyan);
+			}
+		}
+		int threshold_y = band_bottom - 1 - static_cast<int>(frame.min_z/kProfileRange*(kBandRows - 1));
+		for(int x = 0; x < kImageWidth; x += 8){
+			fillRect(rgb, step, x, threshold_y, x + 4, threshold_y + 1, kAlarm);
+		}
+	}
+
+	// Blobs, boxed with the side of a square of their area
+	for(size_t b = 0; b < frame.num_blobs; b++){
+		const BlobObservation& blob = frame.blobs[b];
+		uint8_t color[3] = {blob.red, blob.green, blob.blue};
+		int half = static_cast<int>(sqrtf(static_cast<float>(blob.area))/2) + 1;
+		int x = static_cast<int>(blob.x), y = static_cast<int>(blob.y);
+		drawBox(rgb, step, x - half, y - half, x + half + 1, y + half + 1, color);
+	}
+
+	// Goal centroid
+	if(frame.goal.found){
+		int x = static_cast<int>(frame.goal.x) + kImageWidth/2;
+		int y = static_cast<int>(frame.goal.y);
+		fillRect(rgb, step, x, 0, x + 1, kImageHeight, kMagenta);
+		fillRect(rgb, step, x - 15, y - 1, x + 16, y + 2, kMagenta);
+		fillRect(rgb, step, x - 1, y - 15, x + 2, y + 16, kMagenta);
+	}
+
+	// State, then the number of close points
+	int x = drawNumber(rgb, step, 8, 8, frame.state, kWhite);
+	uint8_t color[3];
+	memcpy(color, frame.scan->num_close_points > kObstaclePointThreshold ? kAlarm : kYellow, 3);
+	drawNumber(rgb, step, x + 4*kGlyphScale, 8, frame.scan->num_close_points, color);
+}
+
+} // namespace alpha_pkg
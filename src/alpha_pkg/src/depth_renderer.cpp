@@ -0,0 +1,445 @@
+/************************************************************
+ * Name: depth_renderer.cpp
+
+ * Description: Implementation of the 2.5D ray caster declared
+ 				in depth_renderer.h. The per-column and per-row
+ 				loops are kept branch-free over plain float
+ 				arrays so that they vectorize; the file is built
+ 				with -O3 -fno-math-errno -fno-trapping-math.
+ ************************************************************/
+
+#include <alpha_pkg/depth_renderer.h>
+#include <limits>
+#include <math.h>
+
+namespace alpha_pkg {
+
+namespace {
+
+const int kNoiseTable = 1 << 16;
+const float kInf = std::numeric_limits<float>::infinity();
+
+inline uint64_t splitmix64(uint64_t& state){
+	uint64_t z = (state += 0x9e3779b97f4a7c15ull);
+	z = (z ^ (z >> 30))*0xbf58476d1ce4e5b9ull;
+	z = (z ^ (z >> 27))*0x94d049bb133111ebull;
+	return z ^ (z >> 31);
+}
+
+inline float unitFloat(uint64_t& state){
+	return (splitmix64(state) >> 40)*(1.0f/16777216.0f);
+}
+
+} // namespace
+
+CameraModel defaultCameraModel(){
+	CameraModel camera;
+	camera.fx = 525.0f;
+	camera.fy = 525.0f;
+	camera.cx = 319.5f;
+	camera.cy = 239.5f;
+	camera.height = 0.3f;
+	camera.min_range = 0.45f;
+	camera.max_range = 8.0f;
+	return camera;
+}
+
+DepthRenderer::DepthRenderer(const CameraModel& camera, const DepthNoise& noise)
+	: camera_(camera), noise_(noise), rng_state_(noise.seed),
+	  noise_table_(kNoiseTable){
+	for(int c = 0; c < kImageWidth; c++){
+		column_slope_[c] = (c - camera_.cx)/camera_.fx;
+	}
+	min_angle_ = atanf(column_slope_[0]);
+	max_angle_ = atanf(column_slope_[kImageWidth - 1]);
+
+	// Box-Muller into a table scaled by sigma_coeff, with NaN for
+	// dropped pixels; rows read it at random offsets
+	uint64_t state = noise.seed ^ 0x6e6f697365ull;
+	const float nan = std::numeric_limits<float>::quiet_NaN();
+	for(int i = 0; i < kNoiseTable; i++){
+		float u1 = unitFloat(state) + 1.0f/16777216.0f;
+		float u2 = unitFloat(state);
+		float gaussian = sqrtf(-2.0f*logf(u1))*cosf(6.2831853f*u2);
+		noise_table_[i] = unitFloat(state) < noise.dropout ? nan : noise.sigma_coeff*gaussian;
+	}
+}
+
+void DepthRenderer::setScene(const Scenario& scenario){
+	size_t n = scenario.boxes.size();
+	box_min_x_.resize(n); box_min_y_.resize(n);
+	box_max_x_.resize(n); box_max_y_.resize(n);
+	box_height_.resize(n);
+	for(size_t i = 0; i < n; i++){
+		const Box& box = scenario.boxes[i];
+		box_min_x_[i] = box.min_x; box_min_y_[i] = box.min_y;
+		box_max_x_[i] = box.max_x; box_max_y_[i] = box.max_y;
+		box_height_[i] = box.height;
+	}
+
+	// The target is cylinder 0
+	n = scenario.cylinders.size() + 1;
+	cyl_x_.resize(n); cyl_y_.resize(n);
+	cyl_radius_.resize(n); cyl_height_.resize(n);
+	for(size_t i = 0; i < n; i++){
+		const Cylinder& cylinder = i == 0 ? scenario.target : scenario.cylinders[i - 1];
+		cyl_x_[i] = cylinder.x; cyl_y_[i] = cylinder.y;
+		cyl_radius_[i] = cylinder.radius;
+		cyl_height_[i] = cylinder.height;
+	}
+
+	size_t obstacles = box_height_.size() + cyl_height_.size();
+	spans_.reserve(obstacles);
+	span_front_z_.resize(obstacles*kImageWidth);
+	span_front_first_.resize(obstacles*kImageWidth);
+	span_front_last_.resize(obstacles*kImageWidth);
+	span_first_.resize(obstacles*kImageWidth);
+}
+
+void DepthRenderer::moveCylinder(int index, float x, float y){
+	cyl_x_[index + 1] = x;
+	cyl_y_[index + 1] = y;
+}
+
+/************************************************************
+ * Function Name: columnRange
+
+ * Description: Columns [first, last) that may see a circle
+ 				centred at (x, y) relative to the camera. False
+ 				if the circle is out of the field of view.
+*************************************************************/
+
+bool DepthRenderer::columnRange(float x, float y, float radius, float fwd_x, float fwd_y,
+								int& first, int& last) const {
+	float ahead = x*fwd_x + y*fwd_y;
+	float right = x*fwd_y - y*fwd_x;
+	float distance = sqrtf(x*x + y*y);
+	if(distance <= radius){
+		first = 0;
+		last = kImageWidth;
+		return true;
+	}
+
+	float center = atan2f(right, ahead), half = asinf(radius/distance);
+	float lo = center - half, hi = center + half;
+	if(hi < min_angle_ || lo > max_angle_){
+		return false;
+	}
+	lo = lo > min_angle_ ? lo : min_angle_;
+	hi = hi < max_angle_ ? hi : max_angle_;
+	first = static_cast<int>(floorf(camera_.cx + camera_.fx*tanf(lo)));
+	last = static_cast<int>(ceilf(camera_.cx + camera_.fx*tanf(hi))) + 1;
+	first = first > 0 ? first : 0;
+	last = last < kImageWidth ? last : kImageWidth;
+	return first < last;
+}
+
+/************************************************************
+ * Function Name: setPose
+
+ * Description: Intersects the ray of every column with every
+ 				obstacle (slab test for boxes, quadratic for
+ 				cylinders) and stores their footprints. Rays
+ 				are parametrized by camera z, so a hit parameter
+ 				is directly the depth of that column. Only the
+ 				columns that can see an obstacle's bounding
+ 				circle are intersected; obstacles out of view or
+ 				enclosing the camera are skipped.
+*************************************************************/
+
+void DepthRenderer::setPose(float x, float y, float heading){
+	float fwd_x = -sinf(heading), fwd_y = cosf(heading);
+	float right_x = fwd_y, right_y = -fwd_x;
+
+	float dir_x[kImageWidth], dir_y[kImageWidth];
+	float inv_x[kImageWidth], inv_y[kImageWidth], dir_sq[kImageWidth];
+	for(int c = 0; c < kImageWidth; c++){
+		dir_x[c] = fwd_x + column_slope_[c]*right_x;
+		dir_y[c] = fwd_y + column_slope_[c]*right_y;
+		inv_x[c] = 1.0f/dir_x[c];
+		inv_y[c] = 1.0f/dir_y[c];
+		dir_sq[c] = dir_x[c]*dir_x[c] + dir_y[c]*dir_y[c];
+	}
+
+	spans_.clear();
+
+	float z_in[kImageWidth], z_out[kImageWidth];
+	int first, last;
+	for(size_t i = 0; i < box_height_.size(); i++){
+		float x0 = box_min_x_[i] - x, x1 = box_max_x_[i] - x;
+		float y0 = box_min_y_[i] - y, y1 = box_max_y_[i] - y;
+		if(x0 < 0 && x1 > 0 && y0 < 0 && y1 > 0){
+			continue;		// camera inside
+		}
+		float half_w = 0.5f*(x1 - x0), half_d = 0.5f*(y1 - y0);
+		if(!columnRange(x0 + half_w, y0 + half_d, sqrtf(half_w*half_w + half_d*half_d),
+						fwd_x, fwd_y, first, last)){
+			continue;
+		}
+		for(int c = first; c < last; c++){
+			float tx0 = x0*inv_x[c], tx1 = x1*inv_x[c];
+			float ty0 = y0*inv_y[c], ty1 = y1*inv_y[c];
+			float lo_x = tx0 < tx1 ? tx0 : tx1, hi_x = tx0 < tx1 ? tx1 : tx0;
+			float lo_y = ty0 < ty1 ? ty0 : ty1, hi_y = ty0 < ty1 ? ty1 : ty0;
+			float lo = lo_x > lo_y ? lo_x : lo_y;
+			float hi = hi_x < hi_y ? hi_x : hi_y;
+			bool hit = (hi >= lo) & (lo > 0.0f);
+			z_in[c] = hit ? lo : kInf;
+			z_out[c] = hi;
+		}
+		addObstacle(z_in, z_out, first, last, box_height_[i], i);
+	}
+
+	for(size_t i = 0; i < cyl_x_.size(); i++){
+		float ox = x - cyl_x_[i], oy = y - cyl_y_[i];
+		float cc = ox*ox + oy*oy - cyl_radius_[i]*cyl_radius_[i];
+		if(cc <= 0){
+			continue;		// camera inside
+		}
+		if(!columnRange(-ox, -oy, cyl_radius_[i], fwd_x, fwd_y, first, last)){
+			continue;
+		}
+		for(int c = first; c < last; c++){
+			float b = dir_x[c]*ox + dir_y[c]*oy;
+			float disc = b*b - dir_sq[c]*cc;
+			float s = sqrtf(disc > 0.0f ? disc : 0.0f);
+			float lo = (-b - s)/dir_sq[c];
+			bool hit = (disc > 0.0f) & (lo > 0.0f);
+			z_in[c] = hit ? lo : kInf;
+			z_out[c] = (-b + s)/dir_sq[c];
+		}
+		addObstacle(z_in, z_out, first, last, cyl_height_[i], box_height_.size() + i);
+	}
+}
+
+/************************************************************
+ * Function Name: addObstacle
+
+ * Description: Stores the footprint of one obstacle. A point
+ 				at depth z on row v is at height
+ 				h - z*(v - cy)/fy, so the front face at z_in
+ 				covers rows cy + fy*(h - H)/z_in to
+ 				cy + fy*h/z_in, and when the camera is above the
+ 				obstacle its top is seen from row
+ 				cy + fy*(h - H)/z_out down to the front face.
+ 				Columns missed
+ 				inside the span (grazing rays) get empty rows.
+*************************************************************/
+
+void DepthRenderer::addObstacle(const float* z_in, const float* z_out, int first, int last, float height, int obstacle){
+	while(first < last && z_in[first] == kInf){
+		first++;
+	}
+	while(last > first && z_in[last - 1] == kInf){
+		last--;
+	}
+	if(first == last){
+		return;
+	}
+
+	Span span;
+	span.first_col = first;
+	span.last_col = last;
+	span.drop = camera_.height - height;
+	span.obstacle = obstacle;
+	span.offset = spans_.size()*kImageWidth;
+
+	float* __restrict front_z = &span_front_z_[span.offset];
+	float* __restrict front_first = &span_front_first_[span.offset];
+	float* __restrict front_last = &span_front_last_[span.offset];
+	float* __restrict span_first = &span_first_[span.offset];
+	bool top_visible = span.drop > 0;
+	float front_num = camera_.fy*span.drop, last_num = camera_.fy*camera_.height;
+	span.first_row = kInf;
+	span.last_row = -kInf;
+	span.solid_first = -kInf;
+	span.solid_last = kInf;
+	for(int c = first; c < last; c++){
+		int i = c - first;
+		float z = z_in[c];
+		bool hit = z != kInf;
+		front_z[i] = z;
+		front_first[i] = hit ? camera_.cy + front_num/z : kInf;
+		front_last[i] = hit ? camera_.cy + last_num/z : -kInf;
+		float top_first = hit & top_visible ? camera_.cy + front_num/z_out[c] : kInf;
+		span_first[i] = top_first < front_first[i] ? top_first : front_first[i];
+		span.first_row = span_first[i] < span.first_row ? span_first[i] : span.first_row;
+		span.last_row = front_last[i] > span.last_row ? front_last[i] : span.last_row;
+		span.solid_first = front_first[i] > span.solid_first ? front_first[i] : span.solid_first;
+		span.solid_last = front_last[i] < span.solid_last ? front_last[i] : span.solid_last;
+	}
+	spans_.push_back(span);
+}
+
+/************************************************************
+ * Function Name: renderRow
+
+ * Description: Noise-free depth of one image row: the floor
+ 				(or nothing above the horizon), then the nearest
+ 				of the obstacles covering each column. With
+ 				`surfaces`, also what each pixel sees; that
+ 				variant is kept apart so the depth loops stay
+ 				lean.
+*************************************************************/
+
+void DepthRenderer::renderRow(int row, float* __restrict out, int32_t* __restrict surfaces){
+	float v = static_cast<float>(row);
+	float below = (v - camera_.cy)/camera_.fy;
+	float floor_z = below > 0 ? camera_.height/below : kInf;
+	float inv_below = below > 0 ? 1.0f/below : kInf;
+
+	for(int c = 0; c < kImageWidth; c++){
+		out[c] = floor_z;
+	}
+	if(surfaces){
+		int32_t background = below > 0 ? kSurfaceFloor : kSurfaceNone;
+		for(int c = 0; c < kImageWidth; c++){
+			surfaces[c] = background;
+		}
+	}
+	for(size_t k = 0; k < spans_.size(); k++){
+		const Span& span = spans_[k];
+		if(v < span.first_row || v > span.last_row){
+			continue;
+		}
+		const float* __restrict front_z = &span_front_z_[span.offset];
+		float* __restrict span_out = out + span.first_col;
+		int columns = span.last_col - span.first_col;
+		if(surfaces){
+			renderSpanSurfaces(span, v, inv_below, span_out, surfaces + span.first_col);
+			continue;
+		}
+		if(v >= span.solid_first && v <= span.solid_last){
+			for(int i = 0; i < columns; i++){
+				span_out[i] = front_z[i] < span_out[i] ? front_z[i] : span_out[i];
+			}
+			continue;
+		}
+
+		// Rows from span_first to front_first see the top plane
+		const float* __restrict front_first = &span_front_first_[span.offset];
+		const float* __restrict front_last = &span_front_last_[span.offset];
+		const float* __restrict span_first = &span_first_[span.offset];
+		float top = span.drop*inv_below;
+		for(int i = 0; i < columns; i++){
+			float first = span_first[i], last = front_last[i];
+			float front = front_z[i], top_end = front_first[i];
+			float z = v < top_end ? top : front;
+			float z_on = v >= first ? z : kInf;
+			float z_in = v <= last ? z_on : kInf;
+			span_out[i] = z_in < span_out[i] ? z_in : span_out[i];
+		}
+	}
+
+}
+
+void DepthRenderer::renderSpanSurfaces(const Span& span, float v, float inv_below,
+									   float* __restrict out, int32_t* __restrict surfaces){
+	const float* __restrict front_z = &span_front_z_[span.offset];
+	const float* __restrict front_first = &span_front_first_[span.offset];
+	const float* __restrict front_last = &span_front_last_[span.offset];
+	const float* __restrict span_first = &span_first_[span.offset];
+	float top = span.drop*inv_below;
+	int32_t surface = kSurfaceObstacle + span.obstacle;
+	int columns = span.last_col - span.first_col;
+	for(int i = 0; i < columns; i++){
+		float first = span_first[i], last = front_last[i];
+		float front = front_z[i], top_end = front_first[i];
+		float z = v < top_end ? top : front;
+		float z_on = v >= first ? z : kInf;
+		float z_in = v <= last ? z_on : kInf;
+		float nearest = out[i];
+		int32_t seen = surfaces[i];
+		out[i] = z_in < nearest ? z_in : nearest;
+		surfaces[i] = z_in < nearest ? surface : seen;
+	}
+}
+
+/************************************************************
+ * Function Name: finishRow
+
+ * Description: Range limits, depth noise and dropout in one
+ 				pass. A noise table entry g gives z*(1 + g*z),
+ 				NaN entries drop the pixel; the table is read
+ 				from a random offset per row.
+*************************************************************/
+
+void DepthRenderer::finishRow(float* __restrict out){
+	const float nan = std::numeric_limits<float>::quiet_NaN();
+	float min_range = camera_.min_range, max_range = camera_.max_range;
+	if(noise_.sigma_coeff <= 0 && noise_.dropout <= 0){
+		for(int c = 0; c < kImageWidth; c++){
+			float z = out[c];
+			out[c] = (z >= min_range) & (z <= max_range) ? z : nan;
+		}
+		return;
+	}
+
+	const float* __restrict noise = &noise_table_[splitmix64(rng_state_) % (kNoiseTable - kImageWidth)];
+	for(int c = 0; c < kImageWidth; c++){
+		float z = out[c], g = noise[c];
+		float noisy = z*(1.0f + g*z);
+		out[c] = (z >= min_range) & (z <= max_range) ? noisy : nan;
+	}
+}
+
+void DepthRenderer::renderDepth(float* z, int first_row, int rows){
+	for(int k = 0; k < rows; k++){
+		float* out = z + static_cast<size_t>(k)*kImageWidth;
+		renderRow(first_row + k, out, NULL);
+		finishRow(out);
+	}
+}
+
+void DepthRenderer::renderPoints(float* points, size_t stride, int first_row, int rows){
+	float z[kImageWidth];
+	for(int k = 0; k < rows; k++){
+		int row = first_row + k;
+		renderRow(row, z, NULL);
+		finishRow(z);
+		float below = (row - camera_.cy)/camera_.fy;
+		float* out = points + static_cast<size_t>(k)*kImageWidth*stride;
+		if(stride == 4){
+			// pcl::PointXYZ; a constant stride lets this vectorize
+			for(int c = 0; c < kImageWidth; c++){
+				out[4*c] = z[c]*column_slope_[c];
+				out[4*c + 1] = z[c]*below;
+				out[4*c + 2] = z[c];
+			}
+			continue;
+		}
+		for(int c = 0; c < kImageWidth; c++){
+			out[c*stride] = z[c]*column_slope_[c];
+			out[c*stride + 1] = z[c]*below;
+			out[c*stride + 2] = z[c];
+		}
+	}
+}
+
+void DepthRenderer::renderDepthImage(uint16_t* mm, int first_row, int rows){
+	float z[kImageWidth];
+	for(int k = 0; k < rows; k++){
+		renderRow(first_row + k, z, NULL);
+		finishRow(z);
+		uint16_t* out = mm + static_cast<size_t>(k)*kImageWidth;
+		for(int c = 0; c < kImageWidth; c++){
+			float m = z[c]*1000.0f + 0.5f;
+			// NaN fails the comparison and maps to 0
+			out[c] = m >= 1.0f ? static_cast<uint16_t>(m < 65535.0f ? m : 65535.0f) : 0;
+		}
+	}
+}
+
+void DepthRenderer::renderSurfaces(uint8_t* surfaces, int first_row, int rows){
+	float z[kImageWidth];
+	int32_t row_surfaces[kImageWidth];
+	for(int k = 0; k < rows; k++){
+		renderRow(first_row + k, z, row_surfaces);
+		uint8_t* out = surfaces + static_cast<size_t>(k)*kImageWidth;
+		for(int c = 0; c < kImageWidth; c++){
+			out[c] = row_surfaces[c] < 255 ? row_surfaces[c] : 255;
+		}
+	}
+}
+
+} // namespace alpha_pkg
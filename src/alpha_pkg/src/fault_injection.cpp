@@ -0,0 +1,290 @@
+/************************************************************
+ * Name: fault_injection.cpp
+
+ * Description: Implementation of the fault injection layer
+ 				declared in fault_injection.h
+ ************************************************************/
+
+#include <alpha_pkg/fault_injection.h>
+#include <alpha_pkg/key_value_file.h>
+#include <algorithm>
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+namespace alpha_pkg {
+
+namespace {
+
+const char* const kStreamNames[NUM_FAULT_STREAMS] = {"depth", "blobs", "bumper"};
+const char* const kDelayModelNames[] = {"fixed", "uniform", "normal", "exponential"};
+const int kNumDelayModels = sizeof(kDelayModelNames)/sizeof(kDelayModelNames[0]);
+
+bool parseFloat(const std::string& text, float& value){
+	char* end;
+	value = strtof(text.c_str(), &end);
+	return end != text.c_str() && *end == '\0';
+}
+
+bool parseProbability(const std::string& key, const std::string& text, float& value, std::string& error){
+	if(!parseFloat(text, value) || value < 0 || value > 1){
+		error = key + " must be a probability in [0, 1], not '" + text + "'";
+		return false;
+	}
+	return true;
+}
+
+bool parseSeconds(const std::string& key, const std::string& text, float& value, std::string& error){
+	if(!parseFloat(text, value) || value < 0){
+		error = key + " must be a non-negative time in seconds, not '" + text + "'";
+		return false;
+	}
+	return true;
+}
+
+} // namespace
+
+FaultConfig defaultFaultConfig(){
+	FaultConfig config;
+	for(int s = 0; s < NUM_FAULT_STREAMS; s++){
+		StreamFaults& faults = config.streams[s];
+		faults.delay_model = DELAY_FIXED;
+		faults.delay = 0;
+		faults.jitter = 0;
+		faults.drop = 0;
+		faults.duplicate = 0;
+		faults.reorder = 0;
+	}
+	config.bounce = 0;
+	config.bounce_count = 2;
+	config.bounce_interval = 0.02f;
+	config.seed = 1;
+	return config;
+}
+
+bool faultsEnabled(const FaultConfig& config){
+	for(int s = 0; s < NUM_FAULT_STREAMS; s++){
+		const StreamFaults& faults = config.streams[s];
+		if(faults.delay > 0 || faults.jitter > 0 || faults.drop > 0 ||
+		   faults.duplicate > 0 || faults.reorder > 0){
+			return true;
+		}
+	}
+	return config.bounce > 0 && config.bounce_count > 0;
+}
+
+const char* faultStreamName(int stream){
+	return stream >= 0 && stream < NUM_FAULT_STREAMS ? kStreamNames[stream] : "unknown";
+}
+
+bool setFaultParameter(FaultConfig& config, const std::string& key, const std::string& value, std::string& error){
+	if(key == "bounce"){
+		return parseProbability(key, value, config.bounce, error);
+	}
+	if(key == "bounce_interval"){
+		return parseSeconds(key, value, config.bounce_interval, error);
+	}
+	if(key == "bounce_count"){
+		char* end;
+		long count = strtol(value.c_str(), &end, 10);
+		if(end == value.c_str() || *end != '\0' || count < 0 || count > 100){
+			error = "bounce_count must be an integer in [0, 100], not '" + value + "'";
+			return false;
+		}
+		config.bounce_count = count;
+		return true;
+	}
+	if(key == "seed"){
+		char* end;
+		config.seed = strtoull(value.c_str(), &end, 0);
+		if(end == value.c_str() || *end != '\0'){
+			error = "seed must be an integer, not '" + value + "'";
+			return false;
+		}
+		return true;
+	}
+
+	// <stream>_<field>
+	size_t split = key.find('_');
+	int s = 0;
+	while(s < NUM_FAULT_STREAMS && key.compare(0, split, kStreamNames[s]) != 0){
+		s++;
+	}
+	if(split == std::string::npos || s == NUM_FAULT_STREAMS){
+		error = "unknown key '" + key + "'";
+		return false;
+	}
+	StreamFaults& faults = config.streams[s];
+	std::string field = key.substr(split + 1);
+	if(field == "delay"){
+		return parseSeconds(key, value, faults.delay, error);
+	}
+	if(field == "jitter"){
+		return parseSeconds(key, value, faults.jitter, error);
+	}
+	if(field == "drop"){
+		return parseProbability(key, value, faults.drop, error);
+	}
+	if(field == "duplicate"){
+		return parseProbability(key, value, faults.duplicate, error);
+	}
+	if(field == "reorder"){
+		return parseProbability(key, value, faults.reorder, error);
+	}
+	if(field == "delay_model"){
+		for(int m = 0; m < kNumDelayModels; m++){
+			if(value == kDelayModelNames[m]){
+				faults.delay_model = m;
+				return true;
+			}
+		}
+		error = key + " must be fixed, uniform, normal or exponential, not '" + value + "'";
+		return false;
+	}
+	error = "unknown key '" + key + "'";
+	return false;
+}
+
+bool loadFaultConfig(const std::string& path, FaultConfig& config, std::string& error){
+	return readKeyValueFile(path, [&config](const std::string& key, const std::string& value, std::string& error){
+		return setFaultParameter(config, key, value, error);
+	}, error);
+}
+
+FaultInjector::FaultInjector(const FaultConfig& config, size_t capacity)
+	: config_(config), enabled_(faultsEnabled(config)), capacity_(capacity)
+{
+	queue_.reserve(capacity_);
+	reset();
+}
+
+void FaultInjector::reset(){
+	rng_state_ = config_.seed;
+	order_ = 0;
+	queue_.clear();
+	for(int s = 0; s < NUM_FAULT_STREAMS; s++){
+		last_release_[s] = -1e300;
+		has_held_[s] = false;
+	}
+	memset(&stats_, 0, sizeof(stats_));
+}
+
+// splitmix64, so a seed replays the same faults everywhere
+uint64_t FaultInjector::next(){
+	uint64_t z = (rng_state_ += 0x9e3779b97f4a7c15ull);
+	z = (z ^ (z >> 30))*0xbf58476d1ce4e5b9ull;
+	z = (z ^ (z >> 27))*0x94d049bb133111ebull;
+	return z ^ (z >> 31);
+}
+
+// Uniform in [0, 1) from the top 24 bits
+float FaultInjector::uniform(){
+	return (next() >> 40)*(1.0f/16777216.0f);
+}
+
+double FaultInjector::sampleDelay(const StreamFaults& faults){
+	double delay = faults.delay;
+	switch(faults.delay_model){
+		case DELAY_UNIFORM:
+			delay += faults.jitter*(2.0*uniform() - 1.0);
+			break;
+		case DELAY_NORMAL: {
+			// Box-Muller
+			double u1 = 1.0 - uniform(), u2 = uniform();
+			delay += faults.jitter*sqrt(-2.0*log(u1))*cos(2.0*M_PI*u2);
+			break;
+		}
+		case DELAY_EXPONENTIAL:
+			delay = -faults.delay*log(1.0 - uniform());
+			break;
+		default:
+			break;
+	}
+	return delay > 0 ? delay : 0;
+}
+
+bool FaultInjector::schedule(const FaultDelivery& delivery){
+	if(queue_.size() >= capacity_){
+		stats_.overflows++;
+		return false;
+	}
+	Pending pending;
+	pending.delivery = delivery;
+	pending.order = order_++;
+	queue_.push_back(pending);
+	std::push_heap(queue_.begin(), queue_.end(), Later());
+	return true;
+}
+
+/************************************************************
+ * Function Name: offer
+
+ * Description: Decides the fate of one message. Its release
+ 				time is the arrival plus a sampled delay, but
+ 				never before the previous release of the stream.
+ 				A reordered message is held and released right
+ 				after the next message of its stream; a
+ 				chattering bumper edge is followed by flips back
+ 				and forth that end in the true state.
+*************************************************************/
+
+int FaultInjector::offer(int stream, double stamp, uint32_t handle, uint8_t bumper_state){
+	const StreamFaults& faults = config_.streams[stream];
+	stats_.offered[stream]++;
+	if(faults.drop > 0 && uniform() < faults.drop){
+		stats_.dropped[stream]++;
+		return 0;
+	}
+
+	FaultDelivery delivery;
+	delivery.stream = stream;
+	delivery.handle = handle;
+	delivery.stamp = stamp;
+	delivery.bumper_state = bumper_state;
+	delivery.release = std::max(stamp + sampleDelay(faults), last_release_[stream]);
+
+	if(!has_held_[stream] && faults.reorder > 0 && uniform() < faults.reorder){
+		held_[stream] = delivery;
+		has_held_[stream] = true;
+		stats_.reordered[stream]++;
+		return 1;
+	}
+	last_release_[stream] = delivery.release;
+
+	int copies = 1 + (faults.duplicate > 0 && uniform() < faults.duplicate);
+	int scheduled = 0;
+	stats_.duplicated[stream] += copies - 1;
+	for(int c = 0; c < copies; c++){
+		scheduled += schedule(delivery);
+	}
+	if(has_held_[stream]){
+		held_[stream].release = delivery.release;
+		schedule(held_[stream]);
+		has_held_[stream] = false;
+	}
+
+	if(stream == FAULT_BUMPER && config_.bounce > 0 && uniform() < config_.bounce){
+		stats_.bounces++;
+		FaultDelivery flip = delivery;
+		for(int i = 0; i < 2*config_.bounce_count; i++){
+			flip.release += config_.bounce_interval;
+			flip.bumper_state = (i % 2 == 0) ? !bumper_state : bumper_state;
+			schedule(flip);
+		}
+		last_release_[stream] = flip.release;
+	}
+	return scheduled;
+}
+
+bool FaultInjector::poll(double now, FaultDelivery& delivery){
+	if(queue_.empty() || queue_.front().delivery.release > now){
+		return false;
+	}
+	delivery = queue_.front().delivery;
+	std::pop_heap(queue_.begin(), queue_.end(), Later());
+	queue_.pop_back();
+	stats_.delivered[delivery.stream]++;
+	return true;
+}
+
+} // namespace alpha_pkg
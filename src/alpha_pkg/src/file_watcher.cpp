@@ -0,0 +1,109 @@
+/************************************************************
+ * Name: file_watcher.cpp
+
+ * Description: Implementation of the inotify file watcher
+ 				declared in file_watcher.h
+ ************************************************************/
+
+#include <alpha_pkg/file_watcher.h>
+#include <errno.h>
+#include <poll.h>
+#include <string.h>
+#include <sys/inotify.h>
+#include <unistd.h>
+
+namespace alpha_pkg {
+
+namespace {
+
+// Quiet time after the last event before calling back, so a save
+// written in several steps is read once it is complete
+const int kSettleMs = 100;
+
+} // namespace
+
+FileWatcher::FileWatcher() : inotify_fd_(-1), running_(false) {}
+
+FileWatcher::~FileWatcher(){
+	stop();
+}
+
+/************************************************************
+ * Function Name: start
+
+ * Description: Watches the directory of `path` for the file
+ 				being closed after writing, moved in or created,
+ 				and starts the watching thread
+*************************************************************/
+
+bool FileWatcher::start(const std::string& path, const Callback& on_change, std::string& error){
+	size_t slash = path.rfind('/');
+	std::string directory = slash == std::string::npos ? "." : path.substr(0, slash + 1);
+	name_ = slash == std::string::npos ? path : path.substr(slash + 1);
+	on_change_ = on_change;
+
+	inotify_fd_ = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+	if(inotify_fd_ < 0){
+		error = std::string("inotify_init1 failed: ") + strerror(errno);
+		return false;
+	}
+	if(inotify_add_watch(inotify_fd_, directory.c_str(), IN_CLOSE_WRITE | IN_MOVED_TO | IN_CREATE) < 0){
+		error = "cannot watch " + directory + ": " + strerror(errno);
+		close(inotify_fd_);
+		inotify_fd_ = -1;
+		return false;
+	}
+
+	running_ = true;
+	thread_ = std::thread(&FileWatcher::watch, this);
+	return true;
+}
+
+void FileWatcher::stop(){
+	if(!running_){
+		return;
+	}
+	running_ = false;
+	thread_.join();
+	close(inotify_fd_);
+	inotify_fd_ = -1;
+}
+
+/************************************************************
+ * Function Name: watch
+
+ * Description: Event loop; polls with a timeout so stop() is
+ 				noticed promptly. A matching event arms the
+ 				callback, which runs once no event has arrived
+ 				for kSettleMs.
+*************************************************************/
+
+void FileWatcher::watch(){
+	bool changed = false;
+	while(running_){
+		pollfd pfd;
+		pfd.fd = inotify_fd_;
+		pfd.events = POLLIN;
+		if(poll(&pfd, 1, changed ? kSettleMs : 200) <= 0){
+			if(changed){
+				changed = false;
+				on_change_();
+			}
+			continue;
+		}
+
+		char buffer[4096] __attribute__((aligned(__alignof__(inotify_event))));
+		ssize_t length;
+		while((length = read(inotify_fd_, buffer, sizeof(buffer))) > 0){
+			for(char* p = buffer; p < buffer + length; ){
+				const inotify_event* event = reinterpret_cast<const inotify_event*>(p);
+				if(event->len > 0 && name_ == event->name){
+					changed = true;
+				}
+				p += sizeof(inotify_event) + event->len;
+			}
+		}
+	}
+}
+
+} // namespace alpha_pkg
@@ -0,0 +1,125 @@
+/************************************************************
+ * Name: flight_recorder.cpp
+
+ * Description: Implementation of the flight recorder declared
+ 				in flight_recorder.h
+ ************************************************************/
+
+#include <alpha_pkg/flight_recorder.h>
+#include <errno.h>
+#include <stdio.h>
+#include <string.h>
+
+namespace alpha_pkg {
+
+FlightRecorder::FlightRecorder(size_t capacity, const std::string& directory)
+	: ring_(capacity > 0 ? capacity : 1), head_(0), count_(0),
+	  snapshot_(ring_.size()), snapshot_count_(0),
+	  directory_(directory), pending_(false), stop_(false)
+{
+	memset(&snapshot_header_, 0, sizeof(snapshot_header_));
+	writer_ = std::thread(&FlightRecorder::writerLoop, this);
+}
+
+FlightRecorder::~FlightRecorder(){
+	{
+		std::lock_guard<std::mutex> lock(mutex_);
+		stop_ = true;
+	}
+	wake_.notify_one();
+	writer_.join();
+}
+
+// The reserved field fills what would be padding, so every byte
+// written to a dump is defined
+static_assert(sizeof(FlightRecord) == 8 + 8 + 4*(3 + kNumSectors) + 4, "FlightRecord has padding");
+
+void FlightRecorder::record(const FlightRecord& record){
+	ring_[head_] = record;
+	ring_[head_].reserved = 0;
+	head_ = (head_ + 1) % ring_.size();
+	if(count_ < ring_.size()){
+		count_++;
+	}
+}
+
+/************************************************************
+ * Function Name: trigger
+
+ * Description: Copies the ring, oldest record first, into the
+ 				snapshot buffer and wakes the writer thread
+*************************************************************/
+
+bool FlightRecorder::trigger(const char* reason, double stamp){
+	std::unique_lock<std::mutex> lock(mutex_, std::try_to_lock);
+	if(!lock.owns_lock() || pending_){
+		return false;
+	}
+
+	size_t oldest = (head_ + ring_.size() - count_) % ring_.size();
+	for(size_t i = 0; i < count_; i++){
+		snapshot_[i] = ring_[(oldest + i) % ring_.size()];
+	}
+	snapshot_count_ = count_;
+
+	memset(&snapshot_header_, 0, sizeof(snapshot_header_));
+	memcpy(snapshot_header_.magic, "AFLT", 4);
+	snapshot_header_.version = 1;
+	snapshot_header_.record_size = sizeof(FlightRecord);
+	snapshot_header_.count = snapshot_count_;
+	snapshot_header_.num_sectors = kNumSectors;
+	snapshot_header_.trigger_stamp = stamp;
+	strncpy(snapshot_header_.reason, reason, sizeof(snapshot_header_.reason) - 1);
+
+	pending_ = true;
+	lock.unlock();
+	wake_.notify_one();
+	return true;
+}
+
+void FlightRecorder::writerLoop(){
+	std::unique_lock<std::mutex> lock(mutex_);
+	while(true){
+		wake_.wait(lock, [this]{ return pending_ || stop_; });
+		if(pending_){
+			// The snapshot is not touched by trigger() while pending_ is set
+			lock.unlock();
+			writeSnapshot();
+			lock.lock();
+			pending_ = false;
+		}
+		if(stop_){
+			return;
+		}
+	}
+}
+
+/************************************************************
+ * Function Name: writeSnapshot
+
+ * Description: Writes the header and the snapshot records to
+ 				<directory>/flight_<stamp>_<reason>.bin
+*************************************************************/
+
+void FlightRecorder::writeSnapshot(){
+	char path[512];
+	snprintf(path, sizeof(path), "%s/flight_%.3f_%s.bin", directory_.c_str(),
+			 snapshot_header_.trigger_stamp, snapshot_header_.reason);
+
+	FILE* file = fopen(path, "wb");
+	if(!file){
+		fprintf(stderr, "flight_recorder: cannot open %s: %s\n", path, strerror(errno));
+		return;
+	}
+	bool ok = fwrite(&snapshot_header_, sizeof(snapshot_header_), 1, file) == 1 &&
+			  fwrite(&snapshot_[0], sizeof(FlightRecord), snapshot_count_, file) == snapshot_count_;
+	ok = (fclose(file) == 0) && ok;
+	if(ok){
+		fprintf(stderr, "flight_recorder: wrote %u records to %s\n", snapshot_header_.count, path);
+	}
+	else{
+		fprintf(stderr, "flight_recorder: failed writing %s\n", path);
+	}
+}
+
+} // namespace alpha_pkg
@@ -0,0 +1,59 @@
+/************************************************************
+ * Name: follower_params.cpp
+
+ * Description: Implementation of the follower settings
+ 				declared in follower_params.h
+ ************************************************************/
+
+#include <alpha_pkg/follower_params.h>
+#include <alpha_pkg/key_value_file.h>
+#include <alpha_pkg/perception.h>
+#include <stdio.h>
+
+namespace alpha_pkg {
+
+const char* const kFollowerParameterNames[] = {
+	"linear_speed", "angular_speed", "angular_speed_thresh", "seek_gain",
+	"seek_speed_scale", "goal_reached_area", "retreat_time", "turn_time",
+	"advance_time", "clear_advance_time", "contact_time", "wait_time", "min_z", "goal_area_threshold"
+};
+const size_t kNumFollowerParameters = sizeof(kFollowerParameterNames)/sizeof(kFollowerParameterNames[0]);
+
+FollowerParams defaultFollowerParams(){
+	FollowerParams params;
+	params.controller = defaultControllerConfig();
+	params.min_z = 0.7;
+	params.goal_area_threshold = kGoalAreaThreshold;
+	return params;
+}
+
+bool setFollowerParameter(FollowerParams& params, const std::string& key, double value, std::string& error){
+	char buffer[32];
+	snprintf(buffer, sizeof(buffer), "%g", value);
+	if(value < 0 || (key == "min_z" && value == 0)){
+		error = key + " out of range: " + buffer;
+		return false;
+	}
+	if(key == "min_z"){
+		params.min_z = value;
+		return true;
+	}
+	if(key == "goal_area_threshold"){
+		params.goal_area_threshold = static_cast<uint32_t>(value);
+		return true;
+	}
+	if(!setControllerParameter(params.controller, key, value)){
+		error = "unknown key '" + key + "'";
+		return false;
+	}
+	return true;
+}
+
+bool loadFollowerParams(const std::string& path, FollowerParams& params, std::string& error){
+	return readKeyValueFile(path, [&params](const std::string& key, const std::string& value, std::string& error){
+		double number;
+		return parseNumber(key, value, number, error) && setFollowerParameter(params, key, number, error);
+	}, error);
+}
+
+} // namespace alpha_pkg
@@ -0,0 +1,91 @@
+/************************************************************
+ * Name: frame_arena.cpp
+
+ * Description: Implementation of the frame-scoped bump
+ 				allocator declared in frame_arena.h
+ ************************************************************/
+
+#include <alpha_pkg/frame_arena.h>
+#include <stdint.h>
+#include <new>
+
+namespace alpha_pkg {
+
+const size_t FrameArena::kDefaultAlignment;
+
+FrameArena::FrameArena(size_t capacity)
+	: base_(static_cast<char*>(::operator new(capacity))),
+	  capacity_(capacity), offset_(0), used_(0), high_water_(0)
+{
+	// Reserve the overflow list up front so that an oversized
+	// frame does not also allocate for the bookkeeping
+	overflow_.reserve(16);
+}
+
+FrameArena::~FrameArena(){
+	reset();
+	::operator delete(base_);
+}
+
+/************************************************************
+ * Function Name: reset
+
+ * Description: Releases all allocations of the frame. If the
+ 				frame spilled into overflow blocks, the main
+ 				block is regrown so the next frame of the same
+ 				size fits in one block, and the overflow list
+ 				is regrown with it so a frame with twice as
+ 				many spills does not grow the list mid-frame.
+*************************************************************/
+
+void FrameArena::reset(){
+	if(!overflow_.empty()){
+		for(size_t i = 0; i < overflow_.size(); i++){
+			::operator delete(overflow_[i]);
+		}
+		size_t spills = overflow_.size();
+		overflow_.clear();
+		overflow_.reserve(2*spills);
+
+		size_t grown = high_water_ + high_water_/2;
+		::operator delete(base_);
+		base_ = static_cast<char*>(::operator new(grown));
+		capacity_ = grown;
+	}
+	offset_ = 0;
+	used_ = 0;
+}
+
+/************************************************************
+ * Function Name: allocate
+
+ * Description: Bumps the offset to the next aligned address.
+ 				Falls back to a dedicated overflow block when
+ 				the main block is exhausted; the block is
+ 				over-allocated by `alignment` and aligned inside,
+ 				since ::operator new only guarantees 16 bytes.
+*************************************************************/
+
+void* FrameArena::allocate(size_t bytes, size_t alignment){
+	uintptr_t current = reinterpret_cast<uintptr_t>(base_) + offset_;
+	size_t padding = (alignment - current%alignment) % alignment;
+
+	used_ += bytes + padding;
+	if(used_ > high_water_){
+		high_water_ = used_;
+	}
+
+	if(offset_ + padding + bytes <= capacity_){
+		void* p = base_ + offset_ + padding;
+		offset_ += padding + bytes;
+		return p;
+	}
+
+	// Out of space: the raw block is kept for reset() to free
+	char* block = static_cast<char*>(::operator new(bytes + alignment));
+	overflow_.push_back(block);
+	uintptr_t start = reinterpret_cast<uintptr_t>(block);
+	return block + (alignment - start%alignment) % alignment;
+}
+
+} // namespace alpha_pkg
@@ -0,0 +1,88 @@
+/************************************************************
+ * Name: image_io.cpp
+
+ * Description: Implementation of the PPM reader and writer
+ 				declared in image_io.h
+ ************************************************************/
+
+#include <alpha_pkg/image_io.h>
+#include <ctype.h>
+#include <stdio.h>
+
+namespace alpha_pkg {
+
+namespace {
+
+// Next header number, skipping whitespace and # comments
+bool readHeaderNumber(FILE* file, int& value){
+	int c = fgetc(file);
+	while(c != EOF && (isspace(c) || c == '#')){
+		if(c == '#'){
+			while(c != EOF && c != '\n'){
+				c = fgetc(file);
+			}
+		}
+		c = fgetc(file);
+	}
+	if(c == EOF || !isdigit(c)){
+		return false;
+	}
+	value = 0;
+	while(c != EOF && isdigit(c) && value < 100000){
+		value = 10*value + (c - '0');
+		c = fgetc(file);
+	}
+	// The single whitespace after the last number ends the header
+	return c != EOF && isspace(c);
+}
+
+} // namespace
+
+bool readPpm(const std::string& path, std::vector<uint8_t>& rgb, int& width, int& height, std::string& error){
+	FILE* file = fopen(path.c_str(), "rb");
+	if(!file){
+		error = "cannot open " + path;
+		return false;
+	}
+	char magic[2];
+	int maxval;
+	if(fread(magic, 1, 2, file) != 2 || magic[0] != 'P' || magic[1] != '6' ||
+	   !readHeaderNumber(file, width) || !readHeaderNumber(file, height) ||
+	   !readHeaderNumber(file, maxval) || width <= 0 || height <= 0){
+		error = path + " is not a binary PPM (P6)";
+		fclose(file);
+		return false;
+	}
+	if(maxval != 255){
+		error = path + ": only 8-bit PPM is supported";
+		fclose(file);
+		return false;
+	}
+	rgb.resize(static_cast<size_t>(3)*width*height);
+	bool ok = fread(&rgb[0], 1, rgb.size(), file) == rgb.size();
+	fclose(file);
+	if(!ok){
+		error = path + " is truncated";
+	}
+	return ok;
+}
+
+bool writePpm(const std::string& path, const uint8_t* rgb, int width, int height, size_t step, std::string& error){
+	FILE* file = fopen(path.c_str(), "wb");
+	if(!file){
+		error = "cannot create " + path;
+		return false;
+	}
+	fprintf(file, "P6\n%d %d\n255\n", width, height);
+	for(int row = 0; row < height; row++){
+		fwrite(rgb + row*step, 1, static_cast<size_t>(3)*width, file);
+	}
+	bool ok = !ferror(file);
+	if(fclose(file) != 0 || !ok){
+		error = "cannot write " + path;
+		return false;
+	}
+	return true;
+}
+
+} // namespace alpha_pkg
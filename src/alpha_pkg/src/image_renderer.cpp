@@ -0,0 +1,98 @@
+/************************************************************
+ * Name: image_renderer.cpp
+
+ * Description: Implementation of the synthetic RGB renderer
+ 				declared in image_renderer.h
+ ************************************************************/
+
+#include <alpha_pkg/image_renderer.h>
+#include <math.h>
+#include <string.h>
+
+namespace alpha_pkg {
+
+namespace {
+
+const int kNoiseTable = 1 << 16;
+const uint8_t kBackdrop[3] = {200, 200, 205};
+const uint8_t kFloor[3] = {115, 105, 95};
+
+inline uint64_t splitmix64(uint64_t& state){
+	uint64_t z = (state += 0x9e3779b97f4a7c15ull);
+	z = (z ^ (z >> 30))*0xbf58476d1ce4e5b9ull;
+	z = (z ^ (z >> 27))*0x94d049bb133111ebull;
+	return z ^ (z >> 31);
+}
+
+inline float unitFloat(uint64_t& state){
+	return (splitmix64(state) >> 40)*(1.0f/16777216.0f);
+}
+
+inline uint8_t clampByte(int value){
+	return value < 0 ? 0 : (value > 255 ? 255 : value);
+}
+
+void setLit(uint8_t* out, const uint8_t* rgb, float gain){
+	for(int c = 0; c < 3; c++){
+		out[c] = clampByte(static_cast<int>(rgb[c]*gain + 0.5f));
+	}
+}
+
+} // namespace
+
+ImageRenderer::ImageRenderer(const CameraModel& camera, uint64_t seed)
+	: geometry_(camera, DepthNoise()), rng_state_(seed),
+	  surfaces_(kImageWidth*kImageHeight), noise_(kNoiseTable){
+	memset(palette_, 0, sizeof(palette_));
+}
+
+/************************************************************
+ * Function Name: setScene
+
+ * Description: Lights the palette and draws the noise table of
+ 				the scenario's lighting profile. Surfaces are
+ 				numbered as in DepthRenderer::renderSurfaces().
+*************************************************************/
+
+void ImageRenderer::setScene(const Scenario& scenario){
+	geometry_.setScene(scenario);
+
+	const LightingInfo& light = lightingInfo(scenario.lighting);
+	memset(palette_, 0, sizeof(palette_));
+	setLit(palette_[DepthRenderer::kSurfaceNone], kBackdrop, light.gain);
+	setLit(palette_[DepthRenderer::kSurfaceFloor], kFloor, light.gain);
+	size_t surface = DepthRenderer::kSurfaceObstacle;
+	for(size_t i = 0; i < scenario.boxes.size() && surface < 256; i++, surface++){
+		setLit(palette_[surface], scenario.boxes[i].rgb, light.gain);
+	}
+	if(surface < 256){
+		setLit(palette_[surface++], scenario.target.rgb, light.gain);
+	}
+	for(size_t i = 0; i < scenario.cylinders.size() && surface < 256; i++, surface++){
+		setLit(palette_[surface], scenario.cylinders[i].rgb, light.gain);
+	}
+
+	uint64_t state = scenario.seed ^ 0x726762ull;
+	for(int i = 0; i < kNoiseTable; i++){
+		float u1 = unitFloat(state) + 1.0f/16777216.0f;
+		float u2 = unitFloat(state);
+		noise_[i] = static_cast<int16_t>(lrintf(light.noise*sqrtf(-2.0f*logf(u1))*cosf(6.2831853f*u2)));
+	}
+}
+
+void ImageRenderer::render(uint8_t* rgb, size_t step){
+	geometry_.renderSurfaces(&surfaces_[0], 0, kImageHeight);
+	for(int row = 0; row < kImageHeight; row++){
+		const uint8_t* surfaces = &surfaces_[static_cast<size_t>(row)*kImageWidth];
+		const int16_t* noise = &noise_[splitmix64(rng_state_) % (kNoiseTable - 3*kImageWidth)];
+		uint8_t* out = rgb + row*step;
+		for(int c = 0; c < kImageWidth; c++){
+			const uint8_t* color = palette_[surfaces[c]];
+			out[3*c] = clampByte(color[0] + noise[3*c]);
+			out[3*c + 1] = clampByte(color[1] + noise[3*c + 1]);
+			out[3*c + 2] = clampByte(color[2] + noise[3*c + 2]);
+		}
+	}
+}
+
+} // namespace alpha_pkg
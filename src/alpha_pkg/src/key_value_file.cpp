@@ -0,0 +1,74 @@
+/************************************************************
+ * Name: key_value_file.cpp
+
+ * Description: Implementation of the "key: value" file reader
+ 				declared in key_value_file.h
+ ************************************************************/
+
+#include <alpha_pkg/key_value_file.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+namespace alpha_pkg {
+
+/************************************************************
+ * Function Name: readKeyValueFile
+
+ * Description: Parses "key: value" lines, skipping blanks and
+ 				# comments
+*************************************************************/
+
+bool readKeyValueFile(const std::string& path, const KeyValueSetter& set, std::string& error){
+	FILE* file = fopen(path.c_str(), "r");
+	if(!file){
+		error = "cannot open " + path;
+		return false;
+	}
+
+	char line[256];
+	int line_number = 0;
+	bool ok = true;
+	while(ok && fgets(line, sizeof(line), file)){
+		line_number++;
+		char where[32];
+		snprintf(where, sizeof(where), ":%d", line_number);
+		if(!strchr(line, '\n') && !feof(file)){
+			error = "line too long";
+			ok = false;
+		}
+		else{
+			char* comment = strchr(line, '#');
+			if(comment){
+				*comment = '\0';
+			}
+			char key[64], value[64], rest[2];
+			int fields = sscanf(line, " %63[A-Za-z0-9_] : %63s %1s", key, value, rest);
+			if(fields == 2){
+				ok = set(key, value, error);
+			}
+			else if(fields != EOF){
+				// Anything but blanks
+				error = "cannot parse";
+				ok = false;
+			}
+		}
+		if(!ok){
+			error += " in " + path + where;
+		}
+	}
+	fclose(file);
+	return ok;
+}
+
+bool parseNumber(const std::string& key, const std::string& value, double& number, std::string& error){
+	char* end;
+	number = strtod(value.c_str(), &end);
+	if(end == value.c_str() || *end != '\0'){
+		error = key + " must be a number, not '" + value + "'";
+		return false;
+	}
+	return true;
+}
+
+} // namespace alpha_pkg
@@ -0,0 +1,176 @@
+/************************************************************
+ * Name: loop_monitor.cpp
+
+ * Description: Implementation of the control-loop deadline
+ 				monitor declared in loop_monitor.h
+ ************************************************************/
+
+#include <alpha_pkg/loop_monitor.h>
+#include <stdio.h>
+#include <string.h>
+
+namespace alpha_pkg {
+
+namespace {
+
+diagnostic_msgs::KeyValue keyValue(const std::string& key, double value){
+	char buffer[32];
+	snprintf(buffer, sizeof(buffer), "%.3f", value);
+	diagnostic_msgs::KeyValue kv;
+	kv.key = key;
+	kv.value = buffer;
+	return kv;
+}
+
+diagnostic_msgs::KeyValue keyValue(const std::string& key, uint64_t value){
+	char buffer[32];
+	snprintf(buffer, sizeof(buffer), "%llu", (unsigned long long)value);
+	diagnostic_msgs::KeyValue kv;
+	kv.key = key;
+	kv.value = buffer;
+	return kv;
+}
+
+} // namespace
+
+const char* LoopMonitor::stageName(Stage stage){
+	switch(stage){
+		case STAGE_DEPTH: return "depth";
+		case STAGE_BLOBS: return "blobs";
+		case STAGE_BUMPER: return "bumper";
+		case STAGE_SPIN: return "spin";
+		case STAGE_FAULTS: return "faults";
+		case STAGE_CONTROL: return "control";
+		default: return "unknown";
+	}
+}
+
+LoopMonitor::LoopMonitor(double rate_hz, const ros::Publisher& diagnostics_publisher)
+	: expected_period_(1.0/rate_hz), diagnostics_publisher_(diagnostics_publisher),
+	  started_(false), window_start_(ros::WallTime::now()),
+	  total_cycles_(0), total_overruns_(0)
+{
+	memset(stage_time_, 0, sizeof(stage_time_));
+	clearWindow();
+}
+
+void LoopMonitor::clearWindow(){
+	memset(&window_, 0, sizeof(window_));
+}
+
+void LoopMonitor::addStageTime(Stage stage, double seconds){
+	stage_time_[stage] += seconds;
+}
+
+double LoopMonitor::callbackTime() const {
+	return stage_time_[STAGE_DEPTH] + stage_time_[STAGE_BLOBS] + stage_time_[STAGE_BUMPER];
+}
+
+/************************************************************
+ * Function Name: endCycle
+
+ * Description: Measures the period since the previous call
+ 				and, on an overrun, charges it to the stage
+ 				that took the longest in this cycle.
+*************************************************************/
+
+void LoopMonitor::endCycle(bool met_deadline){
+	ros::WallTime now = ros::WallTime::now();
+
+	if(started_){
+		double period = (now - cycle_start_).toSec();
+		window_.cycles++;
+		window_.period_sum += period;
+		if(period > window_.period_max){
+			window_.period_max = period;
+		}
+
+		int slowest = 0;
+		for(int i = 0; i < NUM_STAGES; i++){
+			window_.stage_sum[i] += stage_time_[i];
+			if(stage_time_[i] > window_.stage_max[i]){
+				window_.stage_max[i] = stage_time_[i];
+			}
+			if(stage_time_[i] > stage_time_[slowest]){
+				slowest = i;
+			}
+		}
+
+		if(!met_deadline){
+			double overrun = period - expected_period_;
+			if(overrun < 0.0){
+				overrun = 0.0;
+			}
+			window_.overruns++;
+			window_.overrun_sum += overrun;
+			if(overrun > window_.overrun_max){
+				window_.overrun_max = overrun;
+			}
+			window_.stage_overruns[slowest]++;
+			total_overruns_++;
+		}
+		total_cycles_++;
+	}
+
+	started_ = true;
+	cycle_start_ = now;
+	memset(stage_time_, 0, sizeof(stage_time_));
+}
+
+/************************************************************
+ * Function Name: publishSummary
+
+ * Description: Publishes the window statistics as one
+ 				DiagnosticStatus (times in ms) and logs a one
+ 				line summary.
+*************************************************************/
+
+void LoopMonitor::publishSummary(){
+	ros::WallTime now = ros::WallTime::now();
+	double cycles = window_.cycles > 0 ? window_.cycles : 1;
+	double overruns = window_.overruns > 0 ? window_.overruns : 1;
+
+	diagnostic_msgs::DiagnosticArray array;
+	array.header.stamp = ros::Time::now();
+
+	diagnostic_msgs::DiagnosticStatus status;
+	status.name = ros::this_node::getName() + ": control loop";
+	status.hardware_id = "alpha_pkg";
+	if(window_.overruns == 0){
+		status.level = diagnostic_msgs::DiagnosticStatus::OK;
+		status.message = "on time";
+	}
+	else{
+		status.level = diagnostic_msgs::DiagnosticStatus::WARN;
+		status.message = "deadline misses";
+	}
+
+	status.values.push_back(keyValue("window_s", (now - window_start_).toSec()));
+	status.values.push_back(keyValue("cycles", window_.cycles));
+	status.values.push_back(keyValue("expected_period_ms", expected_period_*1000.0));
+	status.values.push_back(keyValue("mean_period_ms", window_.period_sum/cycles*1000.0));
+	status.values.push_back(keyValue("max_period_ms", window_.period_max*1000.0));
+	status.values.push_back(keyValue("overruns", window_.overruns));
+	status.values.push_back(keyValue("overrun_ratio", window_.overruns/cycles));
+	status.values.push_back(keyValue("mean_overrun_ms", window_.overrun_sum/overruns*1000.0));
+	status.values.push_back(keyValue("max_overrun_ms", window_.overrun_max*1000.0));
+	status.values.push_back(keyValue("total_cycles", total_cycles_));
+	status.values.push_back(keyValue("total_overruns", total_overruns_));
+	for(int i = 0; i < NUM_STAGES; i++){
+		std::string name = stageName(static_cast<Stage>(i));
+		status.values.push_back(keyValue(name + "_mean_ms", window_.stage_sum[i]/cycles*1000.0));
+		status.values.push_back(keyValue(name + "_max_ms", window_.stage_max[i]*1000.0));
+		status.values.push_back(keyValue(name + "_overruns", window_.stage_overruns[i]));
+	}
+	array.status.push_back(status);
+	diagnostics_publisher_.publish(array);
+
+	ROS_INFO("control loop: %lu cycles, mean period %.1f ms, max %.1f ms, %lu overruns (mean %.1f ms, max %.1f ms)",
+			 (unsigned long)window_.cycles, window_.period_sum/cycles*1000.0, window_.period_max*1000.0,
+			 (unsigned long)window_.overruns, window_.overrun_sum/overruns*1000.0, window_.overrun_max*1000.0);
+
+	clearWindow();
+	window_start_ = now;
+}
+
+} // namespace alpha_pkg
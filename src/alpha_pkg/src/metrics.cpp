@@ -0,0 +1,306 @@
+/************************************************************
+ * Name: metrics.cpp
+
+ * Description: Implementation of the Prometheus-style metrics
+ 				and the localhost HTTP endpoint declared in
+ 				metrics.h
+ ************************************************************/
+
+#include <alpha_pkg/metrics.h>
+#include <arpa/inet.h>
+#include <errno.h>
+#include <netinet/in.h>
+#include <poll.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+namespace alpha_pkg {
+namespace metrics {
+
+namespace {
+
+const int kMaxMetrics = 128;
+
+// Filled during static initialization, read-only once the server runs
+Metric* registry[kMaxMetrics];
+int num_registered = 0;
+
+double fromBits(uint64_t bits){
+	double value;
+	memcpy(&value, &bits, sizeof(value));
+	return value;
+}
+
+uint64_t toBits(double value){
+	uint64_t bits;
+	memcpy(&bits, &value, sizeof(bits));
+	return bits;
+}
+
+void appendSample(std::string& out, const char* name, const char* suffix,
+				  const char* labels, const char* extra_label, double value){
+	char buffer[64];
+	out += name;
+	out += suffix;
+	if(labels[0] || extra_label[0]){
+		out += '{';
+		out += labels;
+		if(labels[0] && extra_label[0]){
+			out += ',';
+		}
+		out += extra_label;
+		out += '}';
+	}
+	snprintf(buffer, sizeof(buffer), " %.17g\n", value);
+	out += buffer;
+}
+
+} // namespace
+
+const double kLatencyBounds[] = {0.0001, 0.00025, 0.0005, 0.001, 0.0025, 0.005,
+								 0.01, 0.025, 0.05, 0.1, 0.25, 0.5, 1.0};
+const int kNumLatencyBounds = sizeof(kLatencyBounds)/sizeof(kLatencyBounds[0]);
+
+Metric::Metric(const char* name, const char* labels, const char* help)
+	: name_(name), labels_(labels), help_(help)
+{
+	if(num_registered < kMaxMetrics){
+		registry[num_registered++] = this;
+	}
+	else{
+		fprintf(stderr, "metrics: registry full, %s{%s} is not exported\n", name, labels);
+	}
+}
+
+void Counter::render(std::string& out) const {
+	appendSample(out, name_, "", labels_, "", value());
+}
+
+void Gauge::set(double value){
+	bits_.store(toBits(value), std::memory_order_relaxed);
+}
+
+double Gauge::value() const {
+	return fromBits(bits_.load(std::memory_order_relaxed));
+}
+
+void Gauge::render(std::string& out) const {
+	appendSample(out, name_, "", labels_, "", value());
+}
+
+Histogram::Histogram(const char* name, const char* labels, const char* help,
+					 const double* bounds, int num_bounds)
+	: Metric(name, labels, help),
+	  num_bounds_(num_bounds < kMaxBuckets ? num_bounds : kMaxBuckets),
+	  sum_bits_(toBits(0.0))
+{
+	for(int i = 0; i < num_bounds_; i++){
+		bounds_[i] = bounds[i];
+	}
+	for(int i = 0; i <= kMaxBuckets; i++){
+		counts_[i].store(0, std::memory_order_relaxed);
+	}
+}
+
+/************************************************************
+ * Function Name: observe
+
+ * Description: Counts the value in its (non-cumulative)
+ 				bucket and adds it to the sum
+*************************************************************/
+
+void Histogram::observe(double value){
+	int bucket = 0;
+	while(bucket < num_bounds_ && value > bounds_[bucket]){
+		bucket++;
+	}
+	counts_[bucket].fetch_add(1, std::memory_order_relaxed);
+
+	uint64_t expected = sum_bits_.load(std::memory_order_relaxed);
+	while(!sum_bits_.compare_exchange_weak(expected, toBits(fromBits(expected) + value),
+										   std::memory_order_relaxed)){
+	}
+}
+
+void Histogram::render(std::string& out) const {
+	char le[48];
+	uint64_t cumulative = 0;
+	for(int i = 0; i < num_bounds_; i++){
+		cumulative += counts_[i].load(std::memory_order_relaxed);
+		snprintf(le, sizeof(le), "le=\"%g\"", bounds_[i]);
+		appendSample(out, name_, "_bucket", labels_, le, cumulative);
+	}
+	cumulative += counts_[num_bounds_].load(std::memory_order_relaxed);
+	appendSample(out, name_, "_bucket", labels_, "le=\"+Inf\"", cumulative);
+	appendSample(out, name_, "_sum", labels_, "", fromBits(sum_bits_.load(std::memory_order_relaxed)));
+	appendSample(out, name_, "_count", labels_, "", cumulative);
+}
+
+/************************************************************
+ * Function Name: renderAll
+
+ * Description: Writes HELP/TYPE once per metric family (the
+ 				first time a name appears) followed by the
+ 				samples of every registered metric, then the
+ 				process CPU time
+*************************************************************/
+
+void renderAll(std::string& out){
+	for(int i = 0; i < num_registered; i++){
+		const Metric* metric = registry[i];
+
+		bool first_of_family = true;
+		for(int j = 0; j < i; j++){
+			if(strcmp(registry[j]->name(), metric->name()) == 0){
+				first_of_family = false;
+				break;
+			}
+		}
+		if(first_of_family){
+			out += "# HELP "; out += metric->name(); out += ' '; out += metric->help(); out += '\n';
+			out += "# TYPE "; out += metric->name(); out += ' '; out += metric->type(); out += '\n';
+		}
+		metric->render(out);
+	}
+
+	// Standard process metric, read at scrape time
+	timespec cpu;
+	clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &cpu);
+	out += "# HELP process_cpu_seconds_total Total user and system CPU time spent in seconds.\n";
+	out += "# TYPE process_cpu_seconds_total counter\n";
+	appendSample(out, "process_cpu_seconds_total", "", "", "", cpu.tv_sec + cpu.tv_nsec*1e-9);
+}
+
+MetricsServer::MetricsServer() : listen_fd_(-1), running_(false) {}
+
+MetricsServer::~MetricsServer(){
+	stop();
+}
+
+/************************************************************
+ * Function Name: start
+
+ * Description: Binds 127.0.0.1:<port> and starts the serving
+ 				thread
+*************************************************************/
+
+bool MetricsServer::start(int port){
+	listen_fd_ = socket(AF_INET, SOCK_STREAM, 0);
+	if(listen_fd_ < 0){
+		fprintf(stderr, "metrics: socket failed: %s\n", strerror(errno));
+		return false;
+	}
+
+	int reuse = 1;
+	setsockopt(listen_fd_, SOL_SOCKET, SO_REUSEADDR, &reuse, sizeof(reuse));
+
+	sockaddr_in addr;
+	memset(&addr, 0, sizeof(addr));
+	addr.sin_family = AF_INET;
+	addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+	addr.sin_port = htons(port);
+	if(bind(listen_fd_, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) < 0 ||
+	   listen(listen_fd_, 4) < 0){
+		fprintf(stderr, "metrics: cannot listen on 127.0.0.1:%d: %s\n", port, strerror(errno));
+		close(listen_fd_);
+		listen_fd_ = -1;
+		return false;
+	}
+
+	running_ = true;
+	thread_ = std::thread(&MetricsServer::serve, this);
+	return true;
+}
+
+void MetricsServer::stop(){
+	if(!running_){
+		return;
+	}
+	running_ = false;
+	thread_.join();
+	close(listen_fd_);
+	listen_fd_ = -1;
+}
+
+/************************************************************
+ * Function Name: serve
+
+ * Description: Accept loop; polls with a timeout so stop()
+ 				is noticed promptly
+*************************************************************/
+
+void MetricsServer::serve(){
+	while(running_){
+		pollfd pfd;
+		pfd.fd = listen_fd_;
+		pfd.events = POLLIN;
+		if(poll(&pfd, 1, 200) <= 0){
+			continue;
+		}
+
+		int client_fd = accept(listen_fd_, NULL, NULL);
+		if(client_fd < 0){
+			continue;
+		}
+		handleClient(client_fd);
+		close(client_fd);
+	}
+}
+
+/************************************************************
+ * Function Name: handleClient
+
+ * Description: Reads the request line and answers GET /metrics
+ 				with the rendered metrics, anything else with
+ 				404
+*************************************************************/
+
+void MetricsServer::handleClient(int client_fd){
+	timeval timeout;
+	timeout.tv_sec = 1;
+	timeout.tv_usec = 0;
+	setsockopt(client_fd, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+
+	char request[1024];
+	ssize_t received = recv(client_fd, request, sizeof(request) - 1, 0);
+	if(received <= 0){
+		return;
+	}
+	request[received] = '\0';
+
+	std::string body;
+	const char* status;
+	if(strncmp(request, "GET /metrics", 12) == 0 || strncmp(request, "GET / ", 6) == 0){
+		status = "200 OK";
+		body.reserve(16384);
+		renderAll(body);
+	}
+	else{
+		status = "404 Not Found";
+		body = "not found\n";
+	}
+
+	char header[160];
+	int header_length = snprintf(header, sizeof(header),
+								 "HTTP/1.0 %s\r\n"
+								 "Content-Type: text/plain; version=0.0.4\r\n"
+								 "Content-Length: %zu\r\n"
+								 "Connection: close\r\n\r\n",
+								 status, body.size());
+
+	std::string response(header, header_length);
+	response += body;
+	size_t sent = 0;
+	while(sent < response.size()){
+		ssize_t n = send(client_fd, response.data() + sent, response.size() - sent, MSG_NOSIGNAL);
+		if(n <= 0){
+			break;
+		}
+		sent += n;
+	}
+}
+
+} // namespace metrics
+} // namespace alpha_pkg
@@ -0,0 +1,221 @@
+/************************************************************
+ * Name: motion_detector.cpp
+
+ * Description: Implementation of the moving obstacle detector
+ 				declared in motion_detector.h
+ ************************************************************/
+
+#include <alpha_pkg/motion_detector.h>
+#include <limits>
+#include <math.h>
+#include <string.h>
+
+namespace alpha_pkg {
+
+namespace {
+
+const float kInf = std::numeric_limits<float>::infinity();
+
+// Obstacle points a tile needs for a depth, a quarter of it, and
+// for a depth in the reference, so that a tile just over the
+// quarter is not new where it was just under
+const int kMinTilePoints = kTileSize*kTileSize/4;
+const int kMinReferencePoints = kMinTilePoints/4;
+
+} // namespace
+
+MotionConfig defaultMotionConfig(){
+	MotionConfig config;
+	config.fx = 525.0f;
+	config.fy = 525.0f;
+	config.cx = 319.5f;
+	config.cy = 239.5f;
+	config.camera_height = 0.3f;
+	config.floor_margin = 0.1f;
+	config.baseline = 0.2f;
+	config.max_interval = 0.5f;
+	config.max_depth = 3.0f;
+	config.min_change = 0.1f;
+	config.depth_change = 0.02f;
+	config.min_tiles = 3;
+	return config;
+}
+
+uint8_t closeSectors(const DepthScan& scan, float min_z){
+	uint8_t sectors = 0;
+	for(int s = 0; s < kNumSectors; s++){
+		if(scan.sector_min_depth[s] < min_z){
+			sectors |= 1 << s;
+		}
+	}
+	return sectors;
+}
+
+MotionDetector::MotionDetector(const MotionConfig& config) : config_(config) {
+	for(int k = 0; k < kBandRows; k++){
+		float below = (kBandFirstRow + k - config_.cy)/config_.fy;
+		floor_cut_[k] = below > 0 ? (1 - config_.floor_margin)*config_.camera_height/below : kInf;
+	}
+	reset();
+}
+
+void MotionDetector::reset(){
+	has_reference_ = false;
+	reference_stamp_ = stamp_ = 0;
+	driven_ = turned_ = 0;
+	for(int s = 0; s < kNumSectors; s++){
+		moving_tiles_[s] = 0;
+	}
+	moving_sectors_ = 0;
+}
+
+/************************************************************
+ * Function Name: update
+
+ * Description: Accumulates the ego-motion since the reference
+ 				and, on the frame nearest to `baseline` after
+ 				it, reduces the band, compares and makes this
+ 				frame the reference. A gap in the frames starts
+ 				over and clears the flags.
+*************************************************************/
+
+void MotionDetector::update(double stamp, const DepthView& view, float linear, float angular){
+	double dt = stamp - stamp_;
+	stamp_ = stamp;
+	if(has_reference_ && (dt <= 0 || dt > config_.max_interval)){
+		reset();
+		stamp_ = stamp;
+	}
+	if(!has_reference_){
+		reduce(view, tiles_, reference_);
+		reference_stamp_ = stamp;
+		has_reference_ = true;
+		return;
+	}
+
+	driven_ += linear*dt;
+	turned_ += angular*dt;
+	if(stamp - reference_stamp_ < config_.baseline - 0.5*dt){
+		return;
+	}
+	reduce(view, tiles_, next_reference_);
+	compare();
+	memcpy(reference_, next_reference_, sizeof(reference_));
+	reference_stamp_ = stamp;
+	driven_ = turned_ = 0;
+}
+
+/************************************************************
+ * Function Name: reduce
+
+ * Description: Nearest depth of the obstacle points of each
+ 				tile, one pass over the band. Points at or
+ 				behind floor_cut_ of their row, NaN and +inf are
+ 				left out; a tile with fewer than a quarter of
+ 				its points left holds no obstacle (+inf), in
+ 				`reference` fewer than a sixteenth.
+*************************************************************/
+
+void MotionDetector::reduce(const DepthView& view, float* tiles, float* reference) const {
+	float nearest[kTileColumns];
+	int count[kTileColumns];
+	for(int r = 0; r < kTileRows; r++){
+		for(int c = 0; c < kTileColumns; c++){
+			nearest[c] = kInf;
+			count[c] = 0;
+		}
+		for(int k = r*kTileSize; k < (r + 1)*kTileSize; k++){
+			const float* row = view.row(kBandFirstRow + k);
+			float cut = floor_cut_[k];
+			for(int c = 0; c < kTileColumns; c++){
+				float tile_nearest = nearest[c];
+				int tile_count = 0;
+				for(int i = c*kTileSize; i < (c + 1)*kTileSize; i++){
+					float z = row[i*view.stride];
+					bool obstacle = z > 0.0f && z < cut;
+					tile_nearest = obstacle && z < tile_nearest ? z : tile_nearest;
+					tile_count += obstacle;
+				}
+				nearest[c] = tile_nearest;
+				count[c] += tile_count;
+			}
+		}
+		for(int c = 0; c < kTileColumns; c++){
+			tiles[r*kTileColumns + c] = count[c] >= kMinTilePoints ? nearest[c] : kInf;
+			reference[r*kTileColumns + c] = count[c] >= kMinReferencePoints ? nearest[c] : kInf;
+		}
+	}
+}
+
+/************************************************************
+ * Function Name: compare
+
+ * Description: Looks each tile holding an obstacle up in the
+ 				reference where a static point at its depth was
+ 				before the drive and the turn, and at the depth
+ 				it had there, and counts per sector the tiles
+ 				out of the depth range of that reference tile
+ 				and its 8 neighbors by more than the threshold.
+ 				Lookups without a full row of neighbors, at the
+ 				sides, are skipped. Tiles left empty are not
+ 				counted: a static obstacle also leaves tiles at
+ 				the image border as it grows when driving up to
+ 				it, and a moving one fills others.
+*************************************************************/
+
+void MotionDetector::compare(){
+	for(int s = 0; s < kNumSectors; s++){
+		moving_tiles_[s] = 0;
+	}
+
+	for(int r = 0; r < kTileRows; r++){
+		float y = (kBandFirstRow + (r + 0.5f)*kTileSize - config_.cy)/config_.fy;
+		for(int c = 0; c < kTileColumns; c++){
+			float depth = tiles_[r*kTileColumns + c];
+			if(!(depth < kInf)){
+				continue;
+			}
+			float scale = depth + driven_ > 0 ? depth/(depth + driven_) : 1.0f;
+			float x = ((c + 0.5f)*kTileSize - config_.cx)/config_.fx;
+
+			// Undo the drive around the image center, then the turn,
+			// which also changes the depth along the optical axis
+			float angle = atanf(x*scale);
+			float turned = angle - turned_;
+			float ratio = cosf(turned)/cosf(angle);
+			float x_reference = config_.fx*tanf(turned);
+			float y_reference = config_.fy*y*scale/ratio;
+			float expected = (depth + driven_)*ratio;
+			int rc = static_cast<int>(floorf((config_.cx + x_reference)/kTileSize));
+			int rr = static_cast<int>(floorf((config_.cy + y_reference - kBandFirstRow)/kTileSize));
+			if(rc < 1 || rc >= kTileColumns - 1 || rr < 0 || rr >= kTileRows){
+				continue;
+			}
+
+			float low = kInf, high = 0;
+			for(int i = rr > 0 ? rr - 1 : 0; i <= rr + 1 && i < kTileRows; i++){
+				for(int j = rc - 1; j <= rc + 1; j++){
+					float reference = reference_[i*kTileColumns + j];
+					low = reference < low ? reference : low;
+					high = reference > high ? reference : high;
+				}
+			}
+			bool closer = depth < config_.max_depth &&
+						  expected < low - config_.min_change - config_.depth_change*expected;
+			bool farther = high < config_.max_depth &&
+						   expected > high + config_.min_change + config_.depth_change*high;
+			if(closer || farther){
+				moving_tiles_[c*kTileSize/kSectorColumns]++;
+			}
+		}
+	}
+
+	moving_sectors_ = 0;
+	for(int s = 0; s < kNumSectors; s++){
+		if(moving_tiles_[s] >= config_.min_tiles){
+			moving_sectors_ |= 1 << s;
+		}
+	}
+}
+
+} // namespace alpha_pkg
@@ -0,0 +1,263 @@
+/************************************************************
+ * Name: perception.cpp
+
+ * Description: Implementation of the perception kernels
+ 				declared in perception.h
+ ************************************************************/
+
+#include <alpha_pkg/perception.h>
+#include <limits>
+#include <math.h>
+#include <string.h>
+
+namespace alpha_pkg {
+
+namespace {
+
+const float kHistogramRange = kDepthBins/kDepthBinsPerMetre;
+
+// Counts a valid depth into its bin; +inf and far points go to the
+// last bin
+inline void countDepth(uint16_t* histogram, float z){
+	histogram[z < kHistogramRange ? static_cast<int>(z*kDepthBinsPerMetre) : kDepthBins - 1]++;
+}
+
+/************************************************************
+ * Function Name: histogramDepth
+
+ * Description: Selects the depth under which `fraction` of the
+ 				counted points lie by walking the cumulative
+ 				counts, interpolating within the bin where they
+ 				reach it. O(kDepthBins), no sorting.
+*************************************************************/
+
+float histogramDepth(const uint16_t* histogram, float fraction){
+	size_t total = 0;
+	for(int b = 0; b < kDepthBins; b++){
+		total += histogram[b];
+	}
+	if(total == 0){
+		return std::numeric_limits<float>::infinity();
+	}
+
+	float target = fraction*total;
+	size_t below = 0;
+	for(int b = 0; b < kDepthBins; b++){
+		if(histogram[b] > 0 && below + histogram[b] >= target){
+			return (b + (target - below)/histogram[b])/kDepthBinsPerMetre;
+		}
+		below += histogram[b];
+	}
+	return kHistogramRange;
+}
+
+void nearDepths(const uint16_t* histograms, DepthScan& scan){
+	for(int s = 0; s < kNumSectors; s++){
+		scan.sector_near_depth[s] = histogramDepth(histograms + s*kDepthBins, kNearDepthFraction);
+	}
+}
+
+/************************************************************
+ * Function Name: scanRows
+
+ * Description: Iterates through the points of band rows first
+ 				to end, buffers the columns of points whose z is
+ 				lesser than min_z, keeps the nearest depth seen
+ 				in each sector and, with kColumns, in each
+ 				column, and with kHistograms counts the valid
+ 				depths into the histogram of their sector. NaN
+ 				depths fail every comparison and are skipped.
+*************************************************************/
+
+template <bool kColumns, bool kHistograms>
+void scanRows(const DepthView& view, float min_z, int first, int end, DepthScan& scan, size_t& num_close,
+			  uint16_t* histograms, float* column_min_depth){
+	for(int k = first; k < end; k++){
+		const float* row = view.row(kBandFirstRow + k);
+		for(int s = 0; s < kNumSectors; s++){
+			float nearest = scan.sector_min_depth[s];
+			uint16_t* histogram = histograms + s*kDepthBins;
+			for(int i = s*kSectorColumns; i < (s + 1)*kSectorColumns; i++){
+				float z = row[i*view.stride];
+				if(z < min_z){
+					scan.close_columns[num_close++] = i;
+				}
+				if(z > 0.0f){
+					if(kHistograms){
+						countDepth(histogram, z);
+					}
+					if(z < nearest){
+						nearest = z;
+					}
+				}
+				if(kColumns && z > 0.0f && z < column_min_depth[i]){
+					column_min_depth[i] = z;
+				}
+			}
+			scan.sector_min_depth[s] = nearest;
+		}
+	}
+}
+
+// The rows above the horizon with histograms, then the others
+template <bool kColumns>
+void scanBand(const DepthView& view, float min_z, DepthScan& scan, uint16_t* histograms, float* column_min_depth){
+	size_t num_close = 0;
+	scanRows<kColumns, true>(view, min_z, 0, kHorizonRow - kBandFirstRow, scan, num_close, histograms, column_min_depth);
+	scanRows<kColumns, false>(view, min_z, kHorizonRow - kBandFirstRow, kBandRows, scan, num_close, histograms, column_min_depth);
+	scan.num_close_columns = num_close;
+	scan.num_close_points = num_close;
+}
+
+} // namespace
+
+void scanDepthBand(const DepthView& view, float min_z, FrameArena& arena, DepthScan& scan,
+				   float* column_min_depth){
+	scan.close_columns = arena.allocate<uint16_t>(kBandRows*kImageWidth);
+	scan.num_close_points = 0;
+	scan.points_read = kBandRows*kImageWidth;
+	scan.coarse = false;
+	for(int s = 0; s < kNumSectors; s++){
+		scan.sector_min_depth[s] = std::numeric_limits<float>::infinity();
+	}
+
+	// A sector holds at most 60*80 points, within uint16_t
+	uint16_t histograms[kNumSectors*kDepthBins];
+	memset(histograms, 0, sizeof(histograms));
+	if(column_min_depth){
+		for(int i = 0; i < kImageWidth; i++){
+			column_min_depth[i] = std::numeric_limits<float>::infinity();
+		}
+		scanBand<true>(view, min_z, scan, histograms, column_min_depth);
+	}
+	else{
+		scanBand<false>(view, min_z, scan, histograms, NULL);
+	}
+	nearDepths(histograms, scan);
+}
+
+CoarseCheck defaultCoarseCheck(){
+	CoarseCheck check;
+	check.stride = 4;
+	check.max_ambiguous = 3;
+	return check;
+}
+
+/************************************************************
+ * Function Name: checkDepthBand
+
+ * Description: Scans the sample like scanBand() into a scan
+ 				of its own, then keeps it, scaled up (the near
+ 				depths are percentiles of the sample), or falls
+ 				back to the full scan. The sample is read again
+ 				by the full scan; it is 1/stride^2 of the band.
+*************************************************************/
+
+void checkDepthBand(const DepthView& view, float min_z, const CoarseCheck& check, FrameArena& arena,
+					DepthScan& scan, float* column_min_depth){
+	if(column_min_depth || check.stride <= 1){
+		scanDepthBand(view, min_z, arena, scan, column_min_depth);
+		return;
+	}
+
+	const int stride = check.stride;
+	size_t samples = 0;
+	uint16_t* close_columns = arena.allocate<uint16_t>(kBandRows*kImageWidth/(stride*stride) + kBandRows);
+	size_t num_close = 0;
+	float nearest[kNumSectors];
+	for(int s = 0; s < kNumSectors; s++){
+		nearest[s] = std::numeric_limits<float>::infinity();
+	}
+	uint16_t histograms[kNumSectors*kDepthBins];
+	memset(histograms, 0, sizeof(histograms));
+	for(int k = stride/2, r = 0; k < kBandRows; k += stride, r++){
+		const float* row = view.row(kBandFirstRow + k);
+		for(int i = r % stride; i < kImageWidth; i += stride){
+			float z = row[i*view.stride];
+			if(z < min_z){
+				close_columns[num_close++] = i;
+			}
+			int s = i/kSectorColumns;
+			if(z > 0.0f){
+				if(kBandFirstRow + k < kHorizonRow){
+					countDepth(histograms + s*kDepthBins, z);
+				}
+				if(z < nearest[s]){
+					nearest[s] = z;
+				}
+			}
+			samples++;
+		}
+	}
+
+	if(num_close > 0 && num_close <= check.max_ambiguous){
+		scanDepthBand(view, min_z, arena, scan);
+		scan.points_read += samples;
+		return;
+	}
+	scan.close_columns = close_columns;
+	scan.num_close_columns = num_close;
+	scan.num_close_points = num_close*stride*stride;
+	for(int s = 0; s < kNumSectors; s++){
+		scan.sector_min_depth[s] = nearest[s];
+	}
+	nearDepths(histograms, scan);
+	scan.points_read = samples;
+	scan.coarse = true;
+}
+
+void makeScanProjection(float fx, float cx, ScanProjection& projection){
+	projection.angle_min = atan2f(cx - (kImageWidth - 1), fx);
+	projection.angle_max = atan2f(cx, fx);
+	projection.angle_increment = (projection.angle_max - projection.angle_min)/(kImageWidth - 1);
+	for(int j = 0; j < kImageWidth; j++){
+		projection.first_column[j] = kImageWidth;
+		projection.last_column[j] = 0;
+	}
+
+	// Columns to their nearest ray
+	for(int i = 0; i < kImageWidth; i++){
+		float angle = atan2f(cx - i, fx);
+		long ray = lroundf((angle - projection.angle_min)/projection.angle_increment);
+		ray = ray < 0 ? 0 : (ray >= kImageWidth ? kImageWidth - 1 : ray);
+		if(i < projection.first_column[ray]){
+			projection.first_column[ray] = i;
+		}
+		if(i > projection.last_column[ray]){
+			projection.last_column[ray] = i;
+		}
+		projection.range_scale[i] = 1.0f/cosf(angle);
+	}
+
+	// Rays no column fell on take the nearest column
+	for(int j = 0; j < kImageWidth; j++){
+		if(projection.first_column[j] == kImageWidth){
+			float angle = projection.angle_min + j*projection.angle_increment;
+			long column = lroundf(cx - fx*tanf(angle));
+			column = column < 0 ? 0 : (column >= kImageWidth ? kImageWidth - 1 : column);
+			projection.first_column[j] = column;
+			projection.last_column[j] = column;
+		}
+	}
+}
+
+/************************************************************
+ * Function Name: columnDepthToRanges
+
+ * Description: Nearest range over the columns of each ray
+*************************************************************/
+
+void columnDepthToRanges(const float* column_min_depth, const ScanProjection& projection, float* ranges){
+	for(int j = 0; j < kImageWidth; j++){
+		float nearest = std::numeric_limits<float>::infinity();
+		for(int i = projection.first_column[j]; i <= projection.last_column[j]; i++){
+			float range = column_min_depth[i]*projection.range_scale[i];
+			if(range < nearest){
+				nearest = range;
+			}
+		}
+		ranges[j] = nearest;
+	}
+}
+
+} // namespace alpha_pkg
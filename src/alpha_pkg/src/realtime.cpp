@@ -0,0 +1,177 @@
+/************************************************************
+ * Name: realtime.cpp
+
+ * Description: Implementation of the real-time execution
+ 				helpers declared in realtime.h
+ ************************************************************/
+
+#include <alpha_pkg/realtime.h>
+#include <ros/ros.h>
+#include <alloca.h>
+#include <errno.h>
+#include <pthread.h>
+#include <sched.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/resource.h>
+#include <unistd.h>
+
+namespace alpha_pkg {
+
+/************************************************************
+ * Function Name: setRealtimePriority
+
+ * Description: Switches the calling thread to SCHED_FIFO.
+ 				On failure, reports RLIMIT_RTPRIO since that is
+ 				what a non-root user normally lacks.
+*************************************************************/
+
+bool setRealtimePriority(const char* thread_name, int priority){
+	int max_priority = sched_get_priority_max(SCHED_FIFO);
+	int min_priority = sched_get_priority_min(SCHED_FIFO);
+	if(priority < min_priority || priority > max_priority){
+		ROS_ERROR("realtime: %s priority %d is outside SCHED_FIFO range [%d, %d]",
+				  thread_name, priority, min_priority, max_priority);
+		return false;
+	}
+
+	sched_param param;
+	memset(&param, 0, sizeof(param));
+	param.sched_priority = priority;
+	int err = pthread_setschedparam(pthread_self(), SCHED_FIFO, &param);
+	if(err == 0){
+		ROS_INFO("realtime: %s running SCHED_FIFO at priority %d", thread_name, priority);
+		return true;
+	}
+
+	if(err == EPERM){
+		rlimit limit;
+		getrlimit(RLIMIT_RTPRIO, &limit);
+		ROS_ERROR("realtime: %s cannot use SCHED_FIFO priority %d: missing CAP_SYS_NICE and "
+				  "RLIMIT_RTPRIO is %lu. Add '<user> - rtprio %d' to /etc/security/limits.conf "
+				  "or grant the binary cap_sys_nice.",
+				  thread_name, priority, (unsigned long)limit.rlim_cur, priority);
+	}
+	else{
+		ROS_ERROR("realtime: %s pthread_setschedparam failed: %s", thread_name, strerror(err));
+	}
+	return false;
+}
+
+/************************************************************
+ * Function Name: pinToCpu
+
+ * Description: Restricts the calling thread to a single core.
+ 				Fails if the core is not in the cpuset the
+ 				process is allowed to use.
+*************************************************************/
+
+bool pinToCpu(const char* thread_name, int cpu){
+	long num_cpus = sysconf(_SC_NPROCESSORS_CONF);
+	if(cpu < 0 || cpu >= num_cpus || cpu >= CPU_SETSIZE){
+		ROS_ERROR("realtime: %s cannot pin to cpu %d, system has %ld cpus", thread_name, cpu, num_cpus);
+		return false;
+	}
+
+	cpu_set_t set;
+	CPU_ZERO(&set);
+	CPU_SET(cpu, &set);
+	int err = pthread_setaffinity_np(pthread_self(), sizeof(set), &set);
+	if(err == 0){
+		ROS_INFO("realtime: %s pinned to cpu %d", thread_name, cpu);
+		return true;
+	}
+
+	if(err == EINVAL){
+		ROS_ERROR("realtime: %s cannot pin to cpu %d: not in the cpuset allowed for this process "
+				  "(check taskset/cgroup cpuset)", thread_name, cpu);
+	}
+	else if(err == EPERM){
+		ROS_ERROR("realtime: %s cannot pin to cpu %d: permission denied (missing CAP_SYS_NICE)",
+				  thread_name, cpu);
+	}
+	else{
+		ROS_ERROR("realtime: %s pthread_setaffinity_np failed: %s", thread_name, strerror(err));
+	}
+	return false;
+}
+
+/************************************************************
+ * Function Name: lockProcessMemory
+
+ * Description: Locks all current and future pages so the
+ 				control loop never waits on a page fault.
+ 				Reports RLIMIT_MEMLOCK on failure.
+*************************************************************/
+
+bool lockProcessMemory(){
+	if(mlockall(MCL_CURRENT | MCL_FUTURE) == 0){
+		ROS_INFO("realtime: process memory locked");
+		return true;
+	}
+
+	int err = errno;
+	if(err == EPERM || err == ENOMEM){
+		rlimit limit;
+		getrlimit(RLIMIT_MEMLOCK, &limit);
+		ROS_ERROR("realtime: mlockall failed (%s): missing CAP_IPC_LOCK and RLIMIT_MEMLOCK is %lu bytes. "
+				  "Add '<user> - memlock unlimited' to /etc/security/limits.conf.",
+				  strerror(err), (unsigned long)limit.rlim_cur);
+	}
+	else{
+		ROS_ERROR("realtime: mlockall failed: %s", strerror(err));
+	}
+	return false;
+}
+
+/************************************************************
+ * Function Name: prefaultStack
+
+ * Description: Writes to `bytes` of stack so the pages are
+ 				mapped (and locked) before the loop starts.
+*************************************************************/
+
+void prefaultStack(size_t bytes){
+	const size_t page = sysconf(_SC_PAGESIZE);
+	volatile char* stack = static_cast<volatile char*>(alloca(bytes));
+	for(size_t i = 0; i < bytes; i += page){
+		stack[i] = 0;
+	}
+}
+
+/************************************************************
+ * Function Name: configureRealtimeThread
+
+ * Description: Applies memory locking (once per process),
+ 				stack prefaulting, CPU pinning and SCHED_FIFO
+ 				to the calling thread.
+*************************************************************/
+
+bool configureRealtimeThread(const char* thread_name, const RealtimeConfig& config){
+	if(!config.enabled){
+		return true;
+	}
+
+	bool ok = true;
+
+	static bool memory_locked = false;
+	if(!memory_locked){
+		memory_locked = lockProcessMemory();
+		ok = ok && memory_locked;
+	}
+
+	prefaultStack(config.stack_prefault_bytes);
+
+	if(config.cpu >= 0){
+		ok = pinToCpu(thread_name, config.cpu) && ok;
+	}
+
+	ok = setRealtimePriority(thread_name, config.priority) && ok;
+
+	if(!ok){
+		ROS_WARN("realtime: %s continues without the missing real-time guarantees", thread_name);
+	}
+	return ok;
+}
+
+} // namespace alpha_pkg
@@ -0,0 +1,380 @@
+/************************************************************
+ * Name: recording.cpp
+
+ * Description: Implementation of the recording format
+ 				declared in recording.h
+
+ 				Depth plane coding: each row is coded on its own
+ 				as LEB128 varint tokens over the differences
+ 				between neighbouring pixels (the first pixel is
+ 				diffed against 0):
+ 				  (n << 1) | 1   n pixels repeating the previous
+ 				                 value (a run of zero deltas)
+ 				  (z << 1)       one pixel, z is the zigzag coded
+ 				                 non-zero delta
+ 				Flat surfaces give deltas of a few mm (one byte)
+ 				and invalid regions give long runs of zeros.
+ ************************************************************/
+
+#include <alpha_pkg/recording.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <math.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace alpha_pkg {
+
+namespace {
+
+const uint64_t kChunkAlignment = 8;
+
+inline void putVarint(std::vector<uint8_t>& out, uint32_t value){
+	while(value >= 0x80){
+		out.push_back(static_cast<uint8_t>(value | 0x80));
+		value >>= 7;
+	}
+	out.push_back(static_cast<uint8_t>(value));
+}
+
+inline bool getVarint(const uint8_t*& p, const uint8_t* end, uint32_t& value){
+	value = 0;
+	for(int shift = 0; shift < 35; shift += 7){
+		if(p == end){
+			return false;
+		}
+		uint8_t byte = *p++;
+		value |= static_cast<uint32_t>(byte & 0x7f) << shift;
+		if(!(byte & 0x80)){
+			return true;
+		}
+	}
+	return false;
+}
+
+} // namespace
+
+/************************************************************
+ * Function Name: encodeDepthPlane
+
+ * Description: Appends the coded plane to `out` and returns
+ 				the number of bytes appended
+*************************************************************/
+
+size_t encodeDepthPlane(const uint16_t* plane, int width, int rows, std::vector<uint8_t>& out){
+	size_t start = out.size();
+	for(int r = 0; r < rows; r++){
+		const uint16_t* row = plane + static_cast<size_t>(r)*width;
+		int32_t previous = 0;
+		uint32_t run = 0;
+		for(int c = 0; c < width; c++){
+			int32_t delta = static_cast<int32_t>(row[c]) - previous;
+			if(delta == 0){
+				run++;
+				continue;
+			}
+			if(run > 0){
+				putVarint(out, (run << 1) | 1);
+				run = 0;
+			}
+			uint32_t zigzag = (static_cast<uint32_t>(delta) << 1) ^ static_cast<uint32_t>(delta >> 31);
+			putVarint(out, zigzag << 1);
+			previous = row[c];
+		}
+		if(run > 0){
+			putVarint(out, (run << 1) | 1);
+		}
+	}
+	return out.size() - start;
+}
+
+bool decodeDepthPlane(const uint8_t* data, size_t size, int width, int rows, uint16_t* plane){
+	const uint8_t* p = data;
+	const uint8_t* end = data + size;
+	for(int r = 0; r < rows; r++){
+		uint16_t* row = plane + static_cast<size_t>(r)*width;
+		int32_t previous = 0;
+		int c = 0;
+		while(c < width){
+			uint32_t token;
+			if(!getVarint(p, end, token)){
+				return false;
+			}
+			if(token & 1){
+				uint32_t run = token >> 1;
+				if(run > static_cast<uint32_t>(width - c)){
+					return false;
+				}
+				for(uint32_t i = 0; i < run; i++){
+					row[c++] = previous;
+				}
+			}
+			else{
+				uint32_t zigzag = token >> 1;
+				int32_t delta = static_cast<int32_t>(zigzag >> 1) ^ -static_cast<int32_t>(zigzag & 1);
+				previous += delta;
+				row[c++] = previous;
+			}
+		}
+	}
+	return p == end;
+}
+
+void depthToMillimetres(const DepthView& view, int first_row, int rows, uint16_t* plane){
+	for(int r = 0; r < rows; r++){
+		const float* z = view.row(first_row + r);
+		uint16_t* out = plane + static_cast<size_t>(r)*view.width;
+		for(int c = 0; c < view.width; c++){
+			float mm = z[c*view.stride]*1000.0f + 0.5f;
+			// NaN fails both comparisons and becomes 0
+			out[c] = (mm >= 1.0f && mm < 65535.0f) ? static_cast<uint16_t>(mm) : 0;
+		}
+	}
+}
+
+void millimetresToDepth(const uint16_t* plane, size_t count, float* z){
+	const float nan = NAN;
+	for(size_t i = 0; i < count; i++){
+		z[i] = plane[i] ? plane[i]*0.001f : nan;
+	}
+}
+
+RecordingWriter::RecordingWriter()
+	: file_(NULL), offset_(0), raw_depth_bytes_(0), encoded_depth_bytes_(0) {}
+
+RecordingWriter::~RecordingWriter(){
+	if(file_){
+		close();
+	}
+}
+
+bool RecordingWriter::open(const std::string& path){
+	file_ = fopen(path.c_str(), "wb");
+	if(!file_){
+		return false;
+	}
+
+	// Placeholder header, rewritten with the index position on close()
+	RecordingHeader header;
+	memset(&header, 0, sizeof(header));
+	offset_ = 0;
+	index_.clear();
+	plane_.resize(kImageWidth*kBandRows);
+	encoded_.reserve(kImageWidth*kBandRows*2);
+	if(fwrite(&header, sizeof(header), 1, file_) != 1){
+		return false;
+	}
+	offset_ = sizeof(header);
+	return true;
+}
+
+bool RecordingWriter::writeChunk(double stamp, ChunkType type, const void* data, uint32_t size){
+	static const uint8_t padding[kChunkAlignment] = {0};
+
+	ChunkHeader chunk;
+	chunk.stamp = stamp;
+	chunk.type = type;
+	chunk.size = size;
+	if(fwrite(&chunk, sizeof(chunk), 1, file_) != 1 ||
+	   (size > 0 && fwrite(data, size, 1, file_) != 1)){
+		return false;
+	}
+
+	IndexEntry entry;
+	entry.stamp = stamp;
+	entry.offset = offset_ + sizeof(chunk);
+	entry.size = size;
+	entry.type = type;
+	index_.push_back(entry);
+
+	// Keep every payload 8-byte aligned so it can be used in place
+	offset_ += sizeof(chunk) + size;
+	size_t pad = (kChunkAlignment - offset_%kChunkAlignment) % kChunkAlignment;
+	if(pad > 0 && fwrite(padding, pad, 1, file_) != 1){
+		return false;
+	}
+	offset_ += pad;
+	return true;
+}
+
+bool RecordingWriter::writeDepth(double stamp, const DepthView& view){
+	depthToMillimetres(view, kBandFirstRow, kBandRows, &plane_[0]);
+	encoded_.clear();
+	encodeDepthPlane(&plane_[0], kImageWidth, kBandRows, encoded_);
+	raw_depth_bytes_ += plane_.size()*sizeof(uint16_t);
+	encoded_depth_bytes_ += encoded_.size();
+	return writeChunk(stamp, CHUNK_DEPTH, &encoded_[0], encoded_.size());
+}
+
+bool RecordingWriter::writeBlobs(double stamp, const BlobObservation* blobs, uint32_t count){
+	return writeChunk(stamp, CHUNK_BLOBS, blobs, count*sizeof(BlobObservation));
+}
+
+bool RecordingWriter::writeBumper(double stamp, uint8_t bumper, uint8_t state){
+	BumperRecord record;
+	memset(&record, 0, sizeof(record));
+	record.bumper = bumper;
+	record.state = state;
+	return writeChunk(stamp, CHUNK_BUMPER, &record, sizeof(record));
+}
+
+/************************************************************
+ * Function Name: close
+
+ * Description: Appends the index and rewrites the header so
+ 				it points at it
+*************************************************************/
+
+bool RecordingWriter::close(){
+	RecordingHeader header;
+	memset(&header, 0, sizeof(header));
+	memcpy(header.magic, "AREC", 4);
+	header.version = 1;
+	header.width = kImageWidth;
+	header.first_row = kBandFirstRow;
+	header.rows = kBandRows;
+	header.index_offset = offset_;
+	header.index_count = index_.size();
+
+	bool ok = index_.empty() || fwrite(&index_[0], sizeof(IndexEntry), index_.size(), file_) == index_.size();
+	ok = ok && fseek(file_, 0, SEEK_SET) == 0 && fwrite(&header, sizeof(header), 1, file_) == 1;
+	ok = (fclose(file_) == 0) && ok;
+	file_ = NULL;
+	return ok;
+}
+
+RecordingReader::RecordingReader()
+	: fd_(-1), base_(NULL), length_(0), header_(NULL), index_(NULL), index_count_(0) {}
+
+RecordingReader::~RecordingReader(){
+	close();
+}
+
+/************************************************************
+ * Function Name: open
+
+ * Description: Maps the file read-only and validates the
+ 				header and index bounds. The depth plane must be
+ 				the band this build scans (kImageWidth columns,
+ 				kBandRows rows from kBandFirstRow): replay views
+ 				the decoded plane as those rows of the image.
+*************************************************************/
+
+bool RecordingReader::open(const std::string& path, std::string& error){
+	close();
+	fd_ = ::open(path.c_str(), O_RDONLY);
+	if(fd_ < 0){
+		error = strerror(errno);
+		return false;
+	}
+
+	struct stat st;
+	if(fstat(fd_, &st) != 0 || static_cast<size_t>(st.st_size) < sizeof(RecordingHeader)){
+		error = "too short for a recording header";
+		close();
+		return false;
+	}
+	length_ = st.st_size;
+
+	void* map = mmap(NULL, length_, PROT_READ, MAP_PRIVATE, fd_, 0);
+	if(map == MAP_FAILED){
+		error = strerror(errno);
+		close();
+		return false;
+	}
+	base_ = static_cast<const uint8_t*>(map);
+	header_ = reinterpret_cast<const RecordingHeader*>(base_);
+
+	if(memcmp(header_->magic, "AREC", 4) != 0 || header_->version != 1){
+		error = "not a version 1 recording";
+		close();
+		return false;
+	}
+	if(header_->width != kImageWidth || header_->rows != kBandRows || header_->first_row != kBandFirstRow){
+		char message[128];
+		snprintf(message, sizeof(message), "depth plane is %ux%u from row %u, expected %dx%d from row %d",
+				 header_->width, header_->rows, header_->first_row, kImageWidth, kBandRows, kBandFirstRow);
+		error = message;
+		close();
+		return false;
+	}
+	if(header_->index_offset > length_ ||
+	   header_->index_count > (length_ - header_->index_offset)/sizeof(IndexEntry)){
+		error = "index out of the file";
+		close();
+		return false;
+	}
+	index_ = reinterpret_cast<const IndexEntry*>(base_ + header_->index_offset);
+	index_count_ = header_->index_count;
+
+	for(size_t i = 0; i < index_count_; i++){
+		if(index_[i].offset > header_->index_offset ||
+		   index_[i].size > header_->index_offset - index_[i].offset){
+			error = "index entry out of the data";
+			close();
+			return false;
+		}
+	}
+
+	// Replay reads forward through the file
+	madvise(map, length_, MADV_SEQUENTIAL);
+	return true;
+}
+
+void RecordingReader::close(){
+	if(base_){
+		munmap(const_cast<uint8_t*>(base_), length_);
+	}
+	if(fd_ >= 0){
+		::close(fd_);
+	}
+	fd_ = -1;
+	base_ = NULL;
+	length_ = 0;
+	header_ = NULL;
+	index_ = NULL;
+	index_count_ = 0;
+}
+
+size_t RecordingReader::lowerBound(double stamp) const {
+	size_t first = 0, count = index_count_;
+	while(count > 0){
+		size_t step = count/2;
+		if(index_[first + step].stamp < stamp){
+			first += step + 1;
+			count -= step + 1;
+		}
+		else{
+			count = step;
+		}
+	}
+	return first;
+}
+
+bool RecordingReader::readDepth(const IndexEntry& entry, uint16_t* plane) const {
+	if(entry.type != CHUNK_DEPTH){
+		return false;
+	}
+	return decodeDepthPlane(payload(entry), entry.size, header_->width, header_->rows, plane);
+}
+
+const BlobObservation* RecordingReader::blobs(const IndexEntry& entry, uint32_t& count) const {
+	if(entry.type != CHUNK_BLOBS){
+		count = 0;
+		return NULL;
+	}
+	count = entry.size/sizeof(BlobObservation);
+	return reinterpret_cast<const BlobObservation*>(payload(entry));
+}
+
+const BumperRecord* RecordingReader::bumper(const IndexEntry& entry) const {
+	if(entry.type != CHUNK_BUMPER || entry.size < sizeof(BumperRecord)){
+		return NULL;
+	}
+	return reinterpret_cast<const BumperRecord*>(payload(entry));
+}
+
+} // namespace alpha_pkg
@@ -0,0 +1,174 @@
+/************************************************************
+ * Name: replay.cpp
+
+ * Description: Implementation of the recording replay helpers
+ 				declared in replay.h
+ ************************************************************/
+
+#include <alpha_pkg/replay.h>
+#include <limits>
+
+namespace alpha_pkg {
+
+ReplayPerception::ReplayPerception(float min_z, int target_color, uint32_t goal_area_threshold)
+	: min_z_(min_z), color_(kTargetColors[target_color]),
+	  goal_area_threshold_(goal_area_threshold), arena_(1 << 20),
+	  plane_(kImageWidth*kBandRows), depth_(plane_.size())
+{
+	check_.stride = 1;
+	check_.max_ambiguous = 0;
+	scan_.close_columns = NULL;
+	scan_.num_close_columns = 0;
+	scan_.num_close_points = 0;
+	scan_.points_read = 0;
+	scan_.coarse = false;
+	for(int s = 0; s < kNumSectors; s++){
+		scan_.sector_min_depth[s] = 0;
+		scan_.sector_near_depth[s] = 0;
+	}
+	inputs_.goal_found = false;
+	inputs_.obstacle_found = false;
+	inputs_.bumper = false;
+	inputs_.goal_area = 0;
+	inputs_.goal_x = 0;
+	inputs_.contact_depth = std::numeric_limits<float>::infinity();
+	inputs_.contact_closing_speed = 0;
+	inputs_.obstacle_moving = false;
+}
+
+bool ReplayPerception::apply(const RecordingReader& reader, const IndexEntry& entry){
+	if(entry.type == CHUNK_DEPTH){
+		const RecordingHeader& header = reader.header();
+		if(!reader.readDepth(entry, &plane_[0])){
+			return false;
+		}
+		millimetresToDepth(&plane_[0], plane_.size(), &depth_[0]);
+
+		DepthView view;
+		view.z = &depth_[0];
+		view.stride = 1;
+		view.width = header.width;
+		view.height = header.rows;
+		view.first_row = header.first_row;
+		arena_.reset();
+		checkDepthBand(view, min_z_, check_, arena_, scan_);
+
+		if(scan_.num_close_points > kObstaclePointThreshold){
+			inputs_.obstacle_found = true;
+		}
+		else if(!inputs_.bumper){
+			inputs_.obstacle_found = false;
+		}
+	}
+	else if(entry.type == CHUNK_BLOBS){
+		uint32_t count;
+		const BlobObservation* blobs = reader.blobs(entry, count);
+		if(count > 0){
+			GoalEstimate goal;
+			fuseBlobs(blobs, count, color_, goal, goal_area_threshold_);
+			inputs_.goal_area = goal.area;
+			inputs_.goal_found = goal.found;
+			if(goal.found){
+				inputs_.goal_x = goal.x;
+			}
+		}
+	}
+	else if(entry.type == CHUNK_BUMPER){
+		const BumperRecord* record = reader.bumper(entry);
+		if(!record){
+			return false;
+		}
+		applyBumper(record->state);
+	}
+	return true;
+}
+
+void ReplayPerception::applyBumper(uint8_t state){
+	inputs_.bumper = state == 1;
+	if(inputs_.bumper){
+		inputs_.obstacle_found = true;
+	}
+}
+
+// Apply whatever the injector has released by `now`
+static void applyReleased(FaultInjector& injector, double now, const RecordingReader& reader,
+						  ReplayPerception& perception){
+	FaultDelivery delivery;
+	while(injector.poll(now, delivery)){
+		if(delivery.stream == FAULT_BUMPER){
+			perception.applyBumper(delivery.bumper_state);
+		}
+		else{
+			perception.apply(reader, reader.index()[delivery.handle]);
+		}
+	}
+}
+
+bool sampleControlInputs(const std::string& path, float min_z, int target_color,
+						 uint32_t goal_area_threshold, double rate_hz, std::vector<TimedInputs>& samples,
+						 std::string& error, const FaultConfig* faults){
+	RecordingReader reader;
+	if(!reader.open(path, error)){
+		return false;
+	}
+	samples.clear();
+	if(reader.size() == 0){
+		return true;
+	}
+
+	ReplayPerception perception(min_z, target_color, goal_area_threshold);
+	double period = 1.0/rate_hz;
+	double tick = reader.index()[0].stamp;
+	if(!faults || !faultsEnabled(*faults)){
+		for(size_t i = 0; i < reader.size(); i++){
+			const IndexEntry& entry = reader.index()[i];
+			while(tick < entry.stamp){
+				TimedInputs sample;
+				sample.stamp = tick;
+				sample.inputs = perception.inputs();
+				samples.push_back(sample);
+				tick += period;
+			}
+			perception.apply(reader, entry);
+		}
+		return true;
+	}
+
+	// Chunks are offered at their stamp; whatever the injector has
+	// released by a tick is applied before the tick is sampled
+	FaultInjector injector(*faults, 1 << 16);
+	for(size_t i = 0; i < reader.size(); i++){
+		const IndexEntry& entry = reader.index()[i];
+		while(tick < entry.stamp){
+			applyReleased(injector, tick, reader, perception);
+			TimedInputs sample;
+			sample.stamp = tick;
+			sample.inputs = perception.inputs();
+			samples.push_back(sample);
+			tick += period;
+		}
+		if(entry.type == CHUNK_BUMPER){
+			const BumperRecord* record = reader.bumper(entry);
+			if(record){
+				injector.offer(FAULT_BUMPER, entry.stamp, i, record->state);
+			}
+		}
+		else if(entry.type == CHUNK_DEPTH || entry.type == CHUNK_BLOBS){
+			injector.offer(entry.type == CHUNK_DEPTH ? FAULT_DEPTH : FAULT_BLOBS, entry.stamp, i);
+		}
+	}
+
+	// Delayed chunks of the end of the file still reach the loop,
+	// as they would live
+	while(injector.pending() > 0){
+		applyReleased(injector, tick, reader, perception);
+		TimedInputs sample;
+		sample.stamp = tick;
+		sample.inputs = perception.inputs();
+		samples.push_back(sample);
+		tick += period;
+	}
+	return true;
+}
+
+} // namespace alpha_pkg
@@ -0,0 +1,270 @@
+/************************************************************
+ * Name: scenario.cpp
+
+ * Description: Implementation of the procedural scenario
+ 				generator declared in scenario.h
+ ************************************************************/
+
+#include <alpha_pkg/scenario.h>
+#include <alpha_pkg/perception.h>
+#include <math.h>
+#include <string.h>
+
+namespace alpha_pkg {
+
+namespace {
+
+const float kPi = 3.14159265358979f;
+
+/************************************************************
+ * Class Name: SplitMix64
+
+ * Description: Small, fully specified generator so a seed
+ 				gives the same scenario on every platform
+*************************************************************/
+
+class SplitMix64 {
+public:
+	explicit SplitMix64(uint64_t seed) : state_(seed) {}
+
+	uint64_t next(){
+		uint64_t z = (state_ += 0x9e3779b97f4a7c15ull);
+		z = (z ^ (z >> 30))*0xbf58476d1ce4e5b9ull;
+		z = (z ^ (z >> 27))*0x94d049bb133111ebull;
+		return z ^ (z >> 31);
+	}
+
+	// Uniform in [lo, hi) from the top 24 bits
+	float uniform(float lo, float hi){
+		return lo + (hi - lo)*((next() >> 40)*(1.0f/16777216.0f));
+	}
+
+	// Uniform integer in [lo, hi]
+	int range(int lo, int hi){
+		return lo + static_cast<int>(next() % static_cast<uint64_t>(hi - lo + 1));
+	}
+
+private:
+	uint64_t state_;
+};
+
+const LightingInfo kLighting[NUM_LIGHTING_PROFILES] = {
+	{"indoor", TARGET_PINK, 1.0f, 4.0f},
+	{"indoor_dim", TARGET_PINK, 0.6f, 8.0f},
+	{"indoor_bright", TARGET_PINK, 1.25f, 3.0f},
+	{"outdoor_overcast", TARGET_PINK_OUT, 0.9f, 5.0f},
+	{"outdoor_sun", TARGET_PINK_OUT, 1.4f, 6.0f}};
+
+void setGray(uint8_t* rgb, SplitMix64& rng){
+	uint8_t v = rng.range(60, 200);
+	rgb[0] = v;
+	rgb[1] = v;
+	rgb[2] = static_cast<uint8_t>(v*0.9f);
+}
+
+bool circleHitsCircle(float x, float y, float r, float cx, float cy, float cr){
+	return (x - cx)*(x - cx) + (y - cy)*(y - cy) < (r + cr)*(r + cr);
+}
+
+// True if an obstacle of radius r at (x, y) keeps the start and the
+// target reachable
+bool keepsClear(const Scenario& scenario, float x, float y, float r, float clearance){
+	return !circleHitsCircle(x, y, r, scenario.start_x, scenario.start_y, clearance) &&
+		   !circleHitsCircle(x, y, r, scenario.target.x, scenario.target.y, scenario.target.radius + clearance);
+}
+
+void addWall(Scenario& scenario, float min_x, float min_y, float max_x, float max_y){
+	Box wall;
+	wall.min_x = min_x; wall.min_y = min_y; wall.max_x = max_x; wall.max_y = max_y;
+	wall.height = 1.5f;
+	wall.rgb[0] = 210; wall.rgb[1] = 205; wall.rgb[2] = 195;
+	scenario.boxes.push_back(wall);
+}
+
+inline uint64_t mix(uint64_t h, uint64_t v){
+	h ^= v + 0x9e3779b97f4a7c15ull + (h << 6) + (h >> 2);
+	return h;
+}
+
+inline uint64_t floatBits(float f){
+	uint32_t bits;
+	memcpy(&bits, &f, sizeof(bits));
+	return bits;
+}
+
+} // namespace
+
+const LightingInfo& lightingInfo(LightingProfile profile){
+	return kLighting[profile];
+}
+
+ScenarioParams defaultScenarioParams(){
+	ScenarioParams params;
+	params.min_room = 4.0f;
+	params.max_room = 12.0f;
+	params.max_clutter_density = 0.25f;
+	params.max_occluders = 3;
+	params.min_target_distance = 2.0f;
+	params.target_radius = 0.12f;
+	params.target_height = 0.6f;
+	params.clearance = 0.45f;
+	return params;
+}
+
+/************************************************************
+ * Function Name: generateScenario
+
+ * Description: Walls, then start and target, then occluders
+ 				near the start-target line, then clutter. An
+ 				obstacle whose bounding circle would block the
+ 				start or the target is redrawn, up to 16 tries,
+ 				then dropped.
+*************************************************************/
+
+Scenario generateScenario(uint64_t seed, const ScenarioParams& params){
+	SplitMix64 rng(seed);
+	Scenario scenario;
+	scenario.seed = seed;
+	scenario.width = rng.uniform(params.min_room, params.max_room);
+	scenario.depth = rng.uniform(params.min_room, params.max_room);
+	scenario.clutter_density = rng.uniform(0.0f, params.max_clutter_density);
+	scenario.lighting = static_cast<LightingProfile>(rng.range(0, NUM_LIGHTING_PROFILES - 1));
+
+	// Walls, 0.1 m thick, inside the room bounds
+	const float t = 0.1f;
+	addWall(scenario, 0, 0, scenario.width, t);
+	addWall(scenario, 0, scenario.depth - t, scenario.width, scenario.depth);
+	addWall(scenario, 0, 0, t, scenario.depth);
+	addWall(scenario, scenario.width - t, 0, scenario.width, scenario.depth);
+	scenario.num_walls = 4;
+
+	// Start and target, at least min_target_distance apart
+	float margin = params.clearance + t;
+	scenario.start_x = rng.uniform(margin, scenario.width - margin);
+	scenario.start_y = rng.uniform(margin, scenario.depth - margin);
+	scenario.start_heading = rng.uniform(-kPi, kPi);
+
+	scenario.target.radius = params.target_radius;
+	scenario.target.height = params.target_height;
+	const uint8_t* pink = kTargetColors[lightingInfo(scenario.lighting).target_class];
+	memcpy(scenario.target.rgb, pink, 3);
+	for(int attempt = 0; attempt < 64; attempt++){
+		scenario.target.x = rng.uniform(margin, scenario.width - margin);
+		scenario.target.y = rng.uniform(margin, scenario.depth - margin);
+		float dx = scenario.target.x - scenario.start_x, dy = scenario.target.y - scenario.start_y;
+		if(dx*dx + dy*dy >= params.min_target_distance*params.min_target_distance){
+			break;
+		}
+	}
+
+	// Occluders straddle the start-target line
+	int occluders = rng.range(0, params.max_occluders);
+	scenario.num_occluders = 0;
+	for(int i = 0; i < occluders; i++){
+		for(int attempt = 0; attempt < 16; attempt++){
+			float along = rng.uniform(0.3f, 0.7f);
+			float x = scenario.start_x + along*(scenario.target.x - scenario.start_x) + rng.uniform(-0.4f, 0.4f);
+			float y = scenario.start_y + along*(scenario.target.y - scenario.start_y) + rng.uniform(-0.4f, 0.4f);
+			float half_w = rng.uniform(0.15f, 0.5f), half_d = rng.uniform(0.05f, 0.3f);
+			float reach = sqrtf(half_w*half_w + half_d*half_d);
+			if(!keepsClear(scenario, x, y, reach, params.clearance)){
+				continue;
+			}
+			Box box;
+			box.min_x = x - half_w; box.max_x = x + half_w;
+			box.min_y = y - half_d; box.max_y = y + half_d;
+			box.height = rng.uniform(0.4f, 1.2f);
+			setGray(box.rgb, rng);
+			scenario.boxes.push_back(box);
+			scenario.num_occluders++;
+			break;
+		}
+	}
+
+	// Clutter, half boxes and half cylinders
+	int clutter = static_cast<int>(scenario.clutter_density*scenario.width*scenario.depth + 0.5f);
+	for(int i = 0; i < clutter; i++){
+		bool cylinder = rng.range(0, 1) == 1;
+		for(int attempt = 0; attempt < 16; attempt++){
+			float x = rng.uniform(t, scenario.width - t);
+			float y = rng.uniform(t, scenario.depth - t);
+			if(cylinder){
+				Cylinder c;
+				c.x = x; c.y = y;
+				c.radius = rng.uniform(0.05f, 0.3f);
+				c.height = rng.uniform(0.2f, 1.0f);
+				setGray(c.rgb, rng);
+				if(!keepsClear(scenario, x, y, c.radius, params.clearance)){
+					continue;
+				}
+				scenario.cylinders.push_back(c);
+			}
+			else{
+				float half_w = rng.uniform(0.1f, 0.4f), half_d = rng.uniform(0.1f, 0.4f);
+				if(!keepsClear(scenario, x, y, sqrtf(half_w*half_w + half_d*half_d), params.clearance)){
+					continue;
+				}
+				Box box;
+				box.min_x = x - half_w; box.max_x = x + half_w;
+				box.min_y = y - half_d; box.max_y = y + half_d;
+				box.height = rng.uniform(0.2f, 1.0f);
+				setGray(box.rgb, rng);
+				scenario.boxes.push_back(box);
+			}
+			break;
+		}
+	}
+
+	return scenario;
+}
+
+uint64_t standardSuiteSeed(int index){
+	SplitMix64 rng(kStandardSuiteBaseSeed + static_cast<uint64_t>(index));
+	return rng.next();
+}
+
+uint64_t scenarioDigest(const Scenario& scenario){
+	uint64_t h = mix(0, scenario.seed);
+	h = mix(h, floatBits(scenario.width));
+	h = mix(h, floatBits(scenario.depth));
+	h = mix(h, scenario.lighting);
+	h = mix(h, floatBits(scenario.start_x));
+	h = mix(h, floatBits(scenario.start_y));
+	h = mix(h, floatBits(scenario.start_heading));
+	h = mix(h, floatBits(scenario.target.x));
+	h = mix(h, floatBits(scenario.target.y));
+	for(size_t i = 0; i < scenario.boxes.size(); i++){
+		const Box& b = scenario.boxes[i];
+		h = mix(h, floatBits(b.min_x)); h = mix(h, floatBits(b.min_y));
+		h = mix(h, floatBits(b.max_x)); h = mix(h, floatBits(b.max_y));
+		h = mix(h, floatBits(b.height));
+	}
+	for(size_t i = 0; i < scenario.cylinders.size(); i++){
+		const Cylinder& c = scenario.cylinders[i];
+		h = mix(h, floatBits(c.x)); h = mix(h, floatBits(c.y));
+		h = mix(h, floatBits(c.radius)); h = mix(h, floatBits(c.height));
+	}
+	return h;
+}
+
+void writeScenario(FILE* out, const Scenario& scenario){
+	fprintf(out, "scenario %016llx\n", (unsigned long long)scenario.seed);
+	fprintf(out, "  room %.3f %.3f lighting %s clutter_density %.3f\n", scenario.width, scenario.depth,
+			lightingInfo(scenario.lighting).name, scenario.clutter_density);
+	fprintf(out, "  start %.3f %.3f %.3f\n", scenario.start_x, scenario.start_y, scenario.start_heading);
+	fprintf(out, "  target %.3f %.3f r %.3f h %.3f rgb %u %u %u\n", scenario.target.x, scenario.target.y,
+			scenario.target.radius, scenario.target.height,
+			scenario.target.rgb[0], scenario.target.rgb[1], scenario.target.rgb[2]);
+	for(size_t i = 0; i < scenario.boxes.size(); i++){
+		const Box& b = scenario.boxes[i];
+		const char* kind = static_cast<int>(i) < scenario.num_walls ? "wall" :
+						   static_cast<int>(i) < scenario.num_walls + scenario.num_occluders ? "occluder" : "box";
+		fprintf(out, "  %s %.3f %.3f %.3f %.3f h %.3f\n", kind, b.min_x, b.min_y, b.max_x, b.max_y, b.height);
+	}
+	for(size_t i = 0; i < scenario.cylinders.size(); i++){
+		const Cylinder& c = scenario.cylinders[i];
+		fprintf(out, "  cylinder %.3f %.3f r %.3f h %.3f\n", c.x, c.y, c.radius, c.height);
+	}
+}
+
+} // namespace alpha_pkg
@@ -0,0 +1,274 @@
+/************************************************************
+ * Name: segmentation.cpp
+
+ * Description: Implementation of the blob segmentation
+ 				declared in segmentation.h
+ ************************************************************/
+
+#include <alpha_pkg/segmentation.h>
+#include <algorithm>
+
+namespace alpha_pkg {
+
+namespace {
+
+// Pixels per cell side of the coarse level of segmentPyramid()
+const int kCoarseStep = 4;
+
+// Class index of the lowest set bit, -1 for no class
+inline int lowestClass(uint32_t bits){
+	return bits ? __builtin_ctz(bits) : -1;
+}
+
+} // namespace
+
+// Up to a quarter of the pixels can start a run, like cmvision
+Segmenter::Segmenter(int width, int height, uint32_t min_area)
+	: width_(width), height_(height), min_area_(min_area),
+	  runs_(width*height/4 + 1), regions_(width*height/4 + 1), region_of_(width*height/4 + 1),
+	  reported_(width*height/4 + 1), row_classes_(width),
+	  coarse_cols_((width + kCoarseStep - 1)/kCoarseStep), coarse_rows_((height + kCoarseStep - 1)/kCoarseStep),
+	  coarse_(coarse_cols_*coarse_rows_), dilated_(coarse_cols_*coarse_rows_), spans_(coarse_cols_){
+	stats_.pixels = 0;
+	stats_.runs = 0;
+	stats_.regions = 0;
+	stats_.truncated = false;
+}
+
+int Segmenter::root(int run){
+	while(runs_[run].parent != run){
+		runs_[run].parent = runs_[runs_[run].parent].parent;
+		run = runs_[run].parent;
+	}
+	return run;
+}
+
+/************************************************************
+ * Function Name: encodeRow
+
+ * Description: Classifies columns [x0, x1) of `row` and
+ 				appends their runs, joining every run to the
+ 				overlapping runs of the same class on the row
+ 				above as it goes. Runs keep image coordinates,
+ 				so a row can be encoded in several spans, left
+ 				to right.
+*************************************************************/
+
+void Segmenter::encodeRow(const uint8_t* pixel, int row, int x0, int x1, const ColorTable& table,
+						  size_t& num_runs, size_t& above_first, size_t above_end){
+	int8_t* classes = &row_classes_[0];
+	for(int i = x0; i < x1; i++){
+		classes[i] = lowestClass(table.classifyRgb(pixel[3*i], pixel[3*i + 1], pixel[3*i + 2]));
+	}
+	stats_.pixels += x1 - x0;
+
+	int x = x0;
+	while(x < x1){
+		int color = classes[x];
+		int start = x++;
+		while(x < x1 && classes[x] == color){
+			x++;
+		}
+		if(color < 0){
+			continue;
+		}
+		if(num_runs == runs_.size()){
+			stats_.truncated = true;
+			return;
+		}
+		Run& run = runs_[num_runs];
+		run.x = start;
+		run.width = x - start;
+		run.row = row;
+		run.color = color;
+		run.parent = num_runs;
+
+		// Join the runs of the row above that overlap this one
+		while(above_first < above_end && runs_[above_first].x + runs_[above_first].width <= start){
+			above_first++;
+		}
+		for(size_t k = above_first; k < above_end && runs_[k].x < x; k++){
+			if(runs_[k].color == color){
+				int a = root(k), b = root(num_runs);
+				if(a != b){
+					runs_[a > b ? a : b].parent = a < b ? a : b;
+				}
+			}
+		}
+		num_runs++;
+	}
+}
+
+/************************************************************
+ * Function Name: segment
+
+ * Description: Encodes the rows of the window, then sums the
+ 				runs of each region and reports the large
+ 				enough ones
+*************************************************************/
+
+size_t Segmenter::segment(const uint8_t* rgb, size_t step, const ColorTable& table,
+						  BlobObservation* blobs, size_t max_blobs){
+	ImageWindow window = {0, 0, width_, height_};
+	return segment(rgb, step, table, window, blobs, NULL, max_blobs);
+}
+
+size_t Segmenter::segment(const uint8_t* rgb, size_t step, const ColorTable& table, const ImageWindow& window,
+						  BlobObservation* blobs, ImageWindow* boxes, size_t max_blobs){
+	const int x0 = std::max(window.x0, 0), x1 = std::min(window.x1, width_);
+	const int y0 = std::max(window.y0, 0), y1 = std::min(window.y1, height_);
+	size_t num_runs = 0;
+	size_t above_first = 0, above_end = 0;
+	stats_.truncated = false;
+	stats_.pixels = 0;
+
+	for(int row = y0; row < y1 && x0 < x1 && !stats_.truncated; row++){
+		size_t row_first = num_runs;
+		encodeRow(rgb + row*step, row, x0, x1, table, num_runs, above_first, above_end);
+		above_first = row_first;
+		above_end = num_runs;
+	}
+	return report(table, num_runs, blobs, boxes, max_blobs);
+}
+
+/************************************************************
+ * Function Name: segmentPyramid
+
+ * Description: Classifies one pixel of every kCoarseStep
+ 				cell, on its middle row and alternately on its
+ 				first and middle column so a vertical strip two
+ 				pixels wide is still sampled, marks the cells
+ 				with a class and their eight neighbors, and
+ 				encodes each row only over the spans of marked
+ 				cells
+*************************************************************/
+
+size_t Segmenter::segmentPyramid(const uint8_t* rgb, size_t step, const ColorTable& table,
+								 BlobObservation* blobs, ImageWindow* boxes, size_t max_blobs){
+	const int cols = coarse_cols_, rows = coarse_rows_;
+	stats_.truncated = false;
+	stats_.pixels = static_cast<size_t>(cols)*rows;
+
+	for(int r = 0; r < rows; r++){
+		const uint8_t* pixel = rgb + std::min(r*kCoarseStep + kCoarseStep/2, height_ - 1)*step;
+		uint8_t* coarse = &coarse_[r*cols];
+		int offset = (r & 1)*kCoarseStep/2;
+		for(int c = 0; c < cols; c++){
+			int x = std::min(c*kCoarseStep + offset, width_ - 1);
+			coarse[c] = table.classifyRgb(pixel[3*x], pixel[3*x + 1], pixel[3*x + 2]) != 0;
+		}
+	}
+
+	// Dilate along the rows here, across them while finding spans
+	for(int r = 0; r < rows; r++){
+		const uint8_t* coarse = &coarse_[r*cols];
+		uint8_t* dilated = &dilated_[r*cols];
+		for(int c = 0; c < cols; c++){
+			dilated[c] = coarse[c] | (c > 0 && coarse[c - 1]) | (c + 1 < cols && coarse[c + 1]);
+		}
+	}
+
+	size_t num_runs = 0;
+	size_t above_first = 0, above_end = 0;
+	for(int r = 0; r < rows && !stats_.truncated; r++){
+		const uint8_t* up = &dilated_[std::max(r - 1, 0)*cols];
+		const uint8_t* here = &dilated_[r*cols];
+		const uint8_t* down = &dilated_[std::min(r + 1, rows - 1)*cols];
+		size_t num_spans = 0;
+		for(int c = 0; c < cols; ){
+			if(!(up[c] | here[c] | down[c])){
+				c++;
+				continue;
+			}
+			Span& span = spans_[num_spans++];
+			span.x0 = c*kCoarseStep;
+			while(c < cols && (up[c] | here[c] | down[c])){
+				c++;
+			}
+			span.x1 = std::min(c*kCoarseStep, width_);
+		}
+
+		int row_end = std::min((r + 1)*kCoarseStep, height_);
+		for(int row = r*kCoarseStep; row < row_end && !stats_.truncated; row++){
+			size_t row_first = num_runs;
+			for(size_t i = 0; i < num_spans && !stats_.truncated; i++){
+				encodeRow(rgb + row*step, row, spans_[i].x0, spans_[i].x1, table, num_runs, above_first, above_end);
+			}
+			above_first = row_first;
+			above_end = num_runs;
+		}
+	}
+	return report(table, num_runs, blobs, boxes, max_blobs);
+}
+
+/************************************************************
+ * Function Name: report
+
+ * Description: Sums the runs of every region on its root run
+ 				and writes the max_blobs largest regions of at
+ 				least min_area pixels as blobs, largest first
+*************************************************************/
+
+size_t Segmenter::report(const ColorTable& table, size_t num_runs,
+						 BlobObservation* blobs, ImageWindow* boxes, size_t max_blobs){
+	size_t num_regions = 0;
+	for(size_t i = 0; i < num_runs; i++){
+		int r = root(i);
+		if(r == static_cast<int>(i)){
+			Region& region = regions_[num_regions];
+			region.color = runs_[i].color;
+			region.area = 0;
+			region.sum_x = 0;
+			region.sum_y = 0;
+			region.box.x0 = region.box.y0 = std::max(width_, height_);
+			region.box.x1 = region.box.y1 = 0;
+			region_of_[i] = num_regions++;
+		}
+		const Run& run = runs_[i];
+		Region& region = regions_[region_of_[r]];
+		region.area += run.width;
+		region.sum_x += run.width*(run.x + 0.5*(run.width - 1));
+		region.sum_y += static_cast<double>(run.width)*run.row;
+		region.box.x0 = std::min<int>(region.box.x0, run.x);
+		region.box.x1 = std::max<int>(region.box.x1, run.x + run.width);
+		region.box.y0 = std::min<int>(region.box.y0, run.row);
+		region.box.y1 = std::max<int>(region.box.y1, run.row + 1);
+	}
+
+	// Bounded insertion keeps the max_blobs largest, largest first
+	// and in scan order among equal areas, without a sort buffer
+	size_t count = 0;
+	for(size_t i = 0; i < num_regions; i++){
+		uint32_t area = regions_[i].area;
+		if(area < min_area_ || (count == max_blobs && (count == 0 || area <= regions_[reported_[count - 1]].area))){
+			continue;
+		}
+		size_t j = count < max_blobs ? count++ : count - 1;
+		for(; j > 0 && regions_[reported_[j - 1]].area < area; j--){
+			reported_[j] = reported_[j - 1];
+		}
+		reported_[j] = i;
+	}
+
+	for(size_t i = 0; i < count; i++){
+		const Region& region = regions_[reported_[i]];
+		const ColorClass& color = table.colorClass(region.color);
+		BlobObservation& blob = blobs[i];
+		blob.red = color.rgb[0];
+		blob.green = color.rgb[1];
+		blob.blue = color.rgb[2];
+		blob.reserved = 0;
+		blob.area = region.area;
+		blob.x = region.sum_x/region.area;
+		blob.y = region.sum_y/region.area;
+		if(boxes){
+			boxes[i] = region.box;
+		}
+	}
+
+	stats_.runs = num_runs;
+	stats_.regions = num_regions;
+	return count;
+}
+
+} // namespace alpha_pkg
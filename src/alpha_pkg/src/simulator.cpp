@@ -0,0 +1,328 @@
+/************************************************************
+ * Name: simulator.cpp
+
+ * Description: Implementation of the closed-loop simulation
+ 				declared in simulator.h
+ ************************************************************/
+
+#include <alpha_pkg/simulator.h>
+#include <limits>
+#include <math.h>
+
+namespace alpha_pkg {
+
+namespace {
+
+const size_t kMaxBlobs = 64;
+
+bool circleHitsBox(float x, float y, float r, const Box& box){
+	float cx = x < box.min_x ? box.min_x : (x > box.max_x ? box.max_x : x);
+	float cy = y < box.min_y ? box.min_y : (y > box.max_y ? box.max_y : y);
+	return (x - cx)*(x - cx) + (y - cy)*(y - cy) < r*r;
+}
+
+bool circleHitsCylinder(float x, float y, float r, const Cylinder& cylinder){
+	float dx = x - cylinder.x, dy = y - cylinder.y, reach = r + cylinder.radius;
+	return dx*dx + dy*dy < reach*reach;
+}
+
+} // namespace
+
+SimConfig defaultSimConfig(){
+	SimConfig config;
+	config.control_rate = 10.0;
+	config.time_limit = 120.0;
+	config.robot_radius = 0.18f;
+	config.min_z = 0.7f;
+	config.color = TARGET_PINK_OUT;
+	config.min_blob_area = 10;
+	config.depth_noise.sigma_coeff = 0.0012f;
+	config.depth_noise.dropout = 0.01f;
+	config.depth_noise.seed = 1;
+	config.controller = defaultControllerConfig();
+	config.faults = defaultFaultConfig();
+	config.track_target = false;
+	config.pyramid_search = false;
+	config.check_tracking = false;
+	config.tracker = defaultTrackerConfig();
+	config.contact = defaultContactConfig();
+	config.detect_motion = false;
+	config.motion = defaultMotionConfig();
+	return config;
+}
+
+bool simSucceeded(const SimResult& result, const SimConfig& config){
+	return result.goal_declared && result.target_distance < config.min_z;
+}
+
+Simulator::Simulator(const SimConfig& config, const ColorTable& colors)
+	: config_(config), colors_(colors), target_rgb_(kTargetColors[config.color]),
+	  depth_renderer_(defaultCameraModel(), config.depth_noise),
+	  image_renderer_(defaultCameraModel(), config.depth_noise.seed),
+	  segmenter_(kImageWidth, kImageHeight, config.min_blob_area),
+	  tracker_(config.tracker, kImageWidth, kImageHeight), contact_estimator_(config.contact),
+	  motion_detector_(config.motion),
+	  arena_(1 << 20), depth_(kBandRows*kImageWidth), rgb_(3*kImageWidth*kImageHeight),
+	  blobs_(kMaxBlobs), boxes_(kMaxBlobs), faults_(config.faults), scenario_(NULL), controller_(config.controller){}
+
+void Simulator::reset(const Scenario& scenario){
+	scenario_ = &scenario;
+	depth_renderer_.setScene(scenario);
+	image_renderer_.setScene(scenario);
+	controller_ = Controller(config_.controller);
+	FaultConfig faults = config_.faults;
+	faults.seed ^= scenario.seed;
+	faults_ = FaultInjector(faults);
+	frames_.clear();
+	tracker_.reset();
+	contact_estimator_.reset();
+	motion_detector_.reset();
+
+	inputs_.goal_found = false;
+	inputs_.obstacle_found = false;
+	inputs_.bumper = false;
+	inputs_.goal_area = 0;
+	inputs_.goal_x = 0;
+	inputs_.contact_depth = std::numeric_limits<float>::infinity();
+	inputs_.contact_closing_speed = 0;
+	inputs_.obstacle_moving = false;
+	command_.linear = 0;
+	command_.angular = 0;
+	contact_ = false;
+	reported_contact_ = false;
+	now_ = 0;
+	x_ = scenario.start_x;
+	y_ = scenario.start_y;
+	heading_ = scenario.start_heading;
+
+	result_.seed = scenario.seed;
+	result_.goal_declared = false;
+	result_.time_to_goal = -1;
+	result_.target_distance = 0;
+	result_.bumper_hits = 0;
+	result_.distance = 0;
+	result_.steps = 0;
+	result_.goal_steps = 0;
+	result_.obstacle_steps = 0;
+	result_.segmented_pixels = 0;
+	result_.window_pixels = 0;
+	result_.full_scans = 0;
+	result_.reference_goals = 0;
+	result_.tracked_goals = 0;
+	result_.limited_steps = 0;
+	result_.moving_steps = 0;
+	result_.waiting_steps = 0;
+}
+
+/************************************************************
+ * Function Name: perceive
+
+ * Description: Renders and senses the robot's view, producing
+ 				a depth frame, a blobs message and, on contact
+ 				changes, a bumper event, then hands them to the
+ 				node semantics directly or through the fault
+ 				injector
+*************************************************************/
+
+void Simulator::perceive(){
+	SensedFrame frame;
+	depth_renderer_.setPose(x_, y_, heading_);
+	depth_renderer_.renderDepth(&depth_[0], kBandFirstRow, kBandRows);
+	DepthView view;
+	view.z = &depth_[0];
+	view.stride = 1;
+	view.width = kImageWidth;
+	view.height = kBandRows;
+	view.first_row = kBandFirstRow;
+	arena_.reset();
+	scanDepthBand(view, config_.min_z, arena_, scan_);
+	frame.stamp = now_;
+	frame.close_points = scan_.num_close_points;
+	for(int s = 0; s < kNumSectors; s++){
+		frame.near_depth[s] = scan_.sector_near_depth[s];
+	}
+	frame.close_sectors = closeSectors(scan_, config_.min_z);
+	frame.moving_sectors = 0;
+	if(config_.detect_motion){
+		motion_detector_.update(now_, view, command_.linear, command_.angular);
+		frame.moving_sectors = motion_detector_.movingSectors();
+		result_.moving_steps += frame.moving_sectors != 0;
+	}
+
+	image_renderer_.setPose(x_, y_, heading_);
+	image_renderer_.render(&rgb_[0], 3*kImageWidth);
+	bool full_scan = !config_.track_target || tracker_.fullScanDue();
+	size_t count;
+	if(full_scan && config_.pyramid_search){
+		count = segmenter_.segmentPyramid(&rgb_[0], 3*kImageWidth, colors_, &blobs_[0], &boxes_[0], blobs_.size());
+	}
+	else{
+		count = segmenter_.segment(&rgb_[0], 3*kImageWidth, colors_, tracker_.window(),
+								   &blobs_[0], &boxes_[0], blobs_.size());
+	}
+	result_.segmented_pixels += segmenter_.stats().pixels;
+	result_.window_pixels += full_scan ? 0 : segmenter_.stats().pixels;
+	result_.full_scans += full_scan;
+	frame.has_blobs = count > 0;
+	frame.goal.found = false;
+	if(frame.has_blobs){
+		fuseBlobs(&blobs_[0], count, target_rgb_, frame.goal);
+	}
+	if(config_.track_target){
+		tracker_.update(&blobs_[0], &boxes_[0], count, target_rgb_);
+	}
+	if(config_.check_tracking){
+		GoalEstimate reference;
+		reference.found = false;
+		count = full_scan && !config_.pyramid_search ? count : segmenter_.segment(&rgb_[0], 3*kImageWidth, colors_, &blobs_[0], blobs_.size());
+		if(count > 0){
+			fuseBlobs(&blobs_[0], count, target_rgb_, reference);
+		}
+		result_.reference_goals += reference.found;
+		result_.tracked_goals += reference.found && frame.goal.found;
+	}
+
+	bool bumper_event = contact_ != reported_contact_;
+	if(bumper_event){
+		reported_contact_ = contact_;
+		result_.bumper_hits += contact_;
+	}
+
+	if(!faults_.enabled()){
+		applyDepth(frame);
+		applyBlobs(frame);
+		if(bumper_event){
+			applyBumper(contact_);
+		}
+		return;
+	}
+
+	uint32_t handle = frames_.size();
+	frames_.push_back(frame);
+	faults_.offer(FAULT_DEPTH, now_, handle);
+	faults_.offer(FAULT_BLOBS, now_, handle);
+	if(bumper_event){
+		faults_.offer(FAULT_BUMPER, now_, handle, contact_);
+	}
+	FaultDelivery delivery;
+	while(faults_.poll(now_, delivery)){
+		if(delivery.stream == FAULT_DEPTH){
+			applyDepth(frames_[delivery.handle]);
+		}
+		else if(delivery.stream == FAULT_BLOBS){
+			applyBlobs(frames_[delivery.handle]);
+		}
+		else{
+			applyBumper(delivery.bumper_state == 1);
+		}
+	}
+}
+
+// As PointCloud_Callback
+void Simulator::applyDepth(const SensedFrame& frame){
+	contact_estimator_.update(frame.stamp, frame.near_depth, command_.linear, command_.angular);
+	int sector = contact_estimator_.nearestContact(command_.linear);
+	inputs_.contact_depth = sector < 0 ? std::numeric_limits<float>::infinity() : contact_estimator_.depth(sector);
+	inputs_.contact_closing_speed = sector < 0 ? 0.0f : contact_estimator_.closingSpeed(sector);
+	inputs_.obstacle_moving = (frame.close_sectors & frame.moving_sectors) != 0;
+
+	if(frame.close_points > kObstaclePointThreshold){
+		inputs_.obstacle_found = true;
+	}
+	else if(!inputs_.bumper){
+		inputs_.obstacle_found = false;
+	}
+}
+
+// As blobsCallBack: a message without blobs changes nothing
+void Simulator::applyBlobs(const SensedFrame& frame){
+	if(frame.has_blobs){
+		inputs_.goal_area = frame.goal.area;
+		inputs_.goal_found = frame.goal.found;
+		if(frame.goal.found){
+			inputs_.goal_x = frame.goal.x;
+		}
+	}
+}
+
+// As Bumper_Callback
+void Simulator::applyBumper(bool pressed){
+	inputs_.bumper = pressed;
+	if(pressed){
+		inputs_.obstacle_found = true;
+	}
+}
+
+bool Simulator::collides(float x, float y) const {
+	float r = config_.robot_radius;
+	for(size_t i = 0; i < scenario_->boxes.size(); i++){
+		if(circleHitsBox(x, y, r, scenario_->boxes[i])){
+			return true;
+		}
+	}
+	for(size_t i = 0; i < scenario_->cylinders.size(); i++){
+		if(circleHitsCylinder(x, y, r, scenario_->cylinders[i])){
+			return true;
+		}
+	}
+	return circleHitsCylinder(x, y, r, scenario_->target);
+}
+
+/************************************************************
+ * Function Name: move
+
+ * Description: Unicycle step with the command in effect. A
+ 				move into an obstacle is not made and keeps the
+ 				bumper pressed; turning in place is always made.
+*************************************************************/
+
+void Simulator::move(const Command& command, double dt){
+	heading_ += command.angular*dt;
+	float step = command.linear*dt;
+	float x = x_ - step*sinf(heading_), y = y_ + step*cosf(heading_);
+	contact_ = step != 0 && collides(x, y);
+	if(!contact_){
+		x_ = x;
+		y_ = y;
+		result_.distance += fabsf(step);
+	}
+}
+
+bool Simulator::step(){
+	double dt = 1.0/config_.control_rate;
+	perceive();
+	result_.goal_steps += inputs_.goal_found;
+	result_.obstacle_steps += inputs_.obstacle_found;
+
+	// The last velocity sent stays in effect, like the base
+	Command command;
+	if(controller_.step(now_, inputs_, command)){
+		command_ = command;
+	}
+	result_.limited_steps += controller_.speedLimited();
+	result_.waiting_steps += controller_.waiting();
+	if(controller_.state() == 3){
+		command_.linear = 0;
+		command_.angular = 0;
+	}
+	move(command_, dt);
+	now_ += dt;
+	result_.steps++;
+
+	float dx = x_ - scenario_->target.x, dy = y_ - scenario_->target.y;
+	result_.target_distance = sqrtf(dx*dx + dy*dy) - scenario_->target.radius - config_.robot_radius;
+	if(controller_.state() == 3 && !result_.goal_declared){
+		result_.goal_declared = true;
+		result_.time_to_goal = now_;
+	}
+	return !result_.goal_declared && now_ < config_.time_limit;
+}
+
+SimResult Simulator::run(const Scenario& scenario){
+	reset(scenario);
+	while(step()){
+	}
+	return result_;
+}
+
+} // namespace alpha_pkg
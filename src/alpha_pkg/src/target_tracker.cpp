@@ -0,0 +1,106 @@
+/************************************************************
+ * Name: target_tracker.cpp
+
+ * Description: Implementation of the segmentation window
+ 				tracker declared in target_tracker.h
+ ************************************************************/
+
+#include <alpha_pkg/target_tracker.h>
+#include <algorithm>
+#include <math.h>
+
+namespace alpha_pkg {
+
+TrackerConfig defaultTrackerConfig(){
+	TrackerConfig config;
+	config.full_scan_period = 10;
+	config.margin = 16.0f;
+	config.motion_gain = 2.0f;
+	config.min_area = 50;
+	return config;
+}
+
+TargetTracker::TargetTracker(const TrackerConfig& config, int width, int height)
+	: config_(config), width_(width), height_(height){
+	reset();
+}
+
+void TargetTracker::reset(){
+	detections_ = 0;
+	frames_since_full_ = 0;
+	box_.x0 = box_.y0 = box_.x1 = box_.y1 = 0;
+	vx_ = vy_ = 0;
+}
+
+bool TargetTracker::fullScanDue() const {
+	return detections_ < 2 || (config_.full_scan_period > 0 && frames_since_full_ >= config_.full_scan_period);
+}
+
+/************************************************************
+ * Function Name: window
+
+ * Description: The last box moved by the velocity, widened
+ 				on each side by the margin plus motion_gain
+ 				times the motion per frame on that axis,
+ 				rounded outwards and clipped to the frame
+*************************************************************/
+
+ImageWindow TargetTracker::window() const {
+	ImageWindow window = {0, 0, width_, height_};
+	if(fullScanDue()){
+		return window;
+	}
+	float grow_x = config_.margin + config_.motion_gain*fabsf(vx_);
+	float grow_y = config_.margin + config_.motion_gain*fabsf(vy_);
+	window.x0 = std::max(0, static_cast<int>(floorf(box_.x0 + vx_ - grow_x)));
+	window.x1 = std::min(width_, static_cast<int>(ceilf(box_.x1 + vx_ + grow_x)));
+	window.y0 = std::max(0, static_cast<int>(floorf(box_.y0 + vy_ - grow_y)));
+	window.y1 = std::min(height_, static_cast<int>(ceilf(box_.y1 + vy_ + grow_y)));
+	return window;
+}
+
+/************************************************************
+ * Function Name: update
+
+ * Description: Joins the boxes of the target blobs. Losing
+ 				the target ends tracking, so the next frame is
+ 				a full scan. Otherwise the velocity is the step
+ 				of the box center averaged with the previous
+ 				estimate; the first step sets it.
+*************************************************************/
+
+void TargetTracker::update(const BlobObservation* blobs, const ImageWindow* boxes, size_t count, const uint8_t* color){
+	frames_since_full_ = fullScanDue() ? 1 : frames_since_full_ + 1;
+
+	uint32_t area = 0;
+	ImageWindow box = {width_, height_, 0, 0};
+	for(size_t i = 0; i < count; i++){
+		const BlobObservation& blob = blobs[i];
+		if(blob.red == color[0] && blob.green == color[1] && blob.blue == color[2]){
+			area += blob.area;
+			box.x0 = std::min(box.x0, boxes[i].x0);
+			box.y0 = std::min(box.y0, boxes[i].y0);
+			box.x1 = std::max(box.x1, boxes[i].x1);
+			box.y1 = std::max(box.y1, boxes[i].y1);
+		}
+	}
+	if(area < config_.min_area){
+		detections_ = 0;
+		return;
+	}
+
+	float step_x = 0.5f*((box.x0 + box.x1) - (box_.x0 + box_.x1));
+	float step_y = 0.5f*((box.y0 + box.y1) - (box_.y0 + box_.y1));
+	if(detections_ == 1){
+		vx_ = step_x;
+		vy_ = step_y;
+	}
+	else if(detections_ > 1){
+		vx_ = 0.5f*vx_ + 0.5f*step_x;
+		vy_ = 0.5f*vy_ + 0.5f*step_y;
+	}
+	box_ = box;
+	detections_ = std::min(detections_ + 1, 2);
+}
+
+} // namespace alpha_pkg
@@ -0,0 +1,86 @@
+/************************************************************
+ * Name: velocity_output.cpp
+
+ * Description: Implementation of the change-suppressed
+ 				velocity output stage declared in
+ 				velocity_output.h
+ ************************************************************/
+
+#include <alpha_pkg/velocity_output.h>
+#include <ros/serialization.h>
+#include <math.h>
+
+namespace alpha_pkg {
+
+VelocityOutput::VelocityOutput(const ros::Publisher& publisher, double tolerance, const ros::Duration& keepalive)
+	: publisher_(publisher), tolerance_(tolerance), keepalive_(keepalive),
+	  msg_(boost::make_shared<geometry_msgs::Twist>()), has_published_(false),
+	  requested_(0), published_(0), reported_requested_(0), reported_published_(0),
+	  last_report_(ros::WallTime::now())
+{
+	// Twist is fixed size, so the serialized length never changes.
+	// The extra 4 bytes are the TCPROS length prefix.
+	msg_bytes_ = ros::serialization::serializationLength(*msg_) + 4;
+}
+
+/************************************************************
+ * Function Name: command
+
+ * Description: Publishes the twist (linear.x, angular.z) unless
+ 				it matches the last published one within the
+ 				tolerance and the keep-alive has not expired.
+*************************************************************/
+
+void VelocityOutput::command(double linear, double angular){
+	requested_++;
+
+	ros::Time now = ros::Time::now();
+	if(has_published_ &&
+	   fabs(linear - msg_->linear.x) <= tolerance_ &&
+	   fabs(angular - msg_->angular.z) <= tolerance_ &&
+	   now - last_publish_ < keepalive_){
+		return;
+	}
+
+	// A published message must not be modified while an intra-process
+	// subscriber still holds it; only then do we pay for a new one
+	if(!msg_.unique()){
+		msg_ = boost::make_shared<geometry_msgs::Twist>();
+	}
+	msg_->linear.x = linear; msg_->linear.y = 0.0; msg_->linear.z = 0.0;
+	msg_->angular.x = 0.0; msg_->angular.y = 0.0; msg_->angular.z = angular;
+
+	publisher_.publish(msg_);
+	published_++;
+	has_published_ = true;
+	last_publish_ = now;
+}
+
+/************************************************************
+ * Function Name: reportStats
+
+ * Description: Logs the message and byte rates that the
+ 				callers requested and what was actually sent.
+*************************************************************/
+
+void VelocityOutput::reportStats(){
+	ros::WallTime now = ros::WallTime::now();
+	double elapsed = (now - last_report_).toSec();
+	if(elapsed <= 0.0){
+		return;
+	}
+
+	double requested_rate = (requested_ - reported_requested_)/elapsed;
+	double published_rate = (published_ - reported_published_)/elapsed;
+	double reduction = requested_rate > 0.0 ? 100.0*(1.0 - published_rate/requested_rate) : 0.0;
+
+	ROS_INFO("cmd_vel: requested %.1f msg/s (%.0f B/s), published %.1f msg/s (%.0f B/s), %.1f%% suppressed",
+			 requested_rate, requested_rate*msg_bytes_,
+			 published_rate, published_rate*msg_bytes_, reduction);
+
+	reported_requested_ = requested_;
+	reported_published_ = published_;
+	last_report_ = now;
+}
+
+} // namespace alpha_pkg
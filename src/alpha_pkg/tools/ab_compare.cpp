@@ -0,0 +1,253 @@
+/************************************************************
+ * Name: ab_compare.cpp
+
+ * Description: A/B comparison of two controller configurations
+ 				on identical inputs. The recording is replayed
+ 				once through the perception kernels and sampled
+ 				at the 10 Hz control rate; the same input
+ 				sequence is then fed to controller A and
+ 				controller B on two threads. The tool diffs the
+ 				resulting command streams and state traces,
+ 				lists the divergent segments and prints the KPIs
+ 				of both sides with their deltas.
+
+ 				Replay is open loop: the inputs do not react to
+ 				the commands, so time-to-goal is the time at
+ 				which each controller would declare the goal
+ 				reached on this input sequence.
+
+ * Usage: 		rosrun alpha_pkg ab_compare [-a a.yaml] [-b b.yaml]
+ 				    [-t trace.csv] [-z min_z] [-c color_index]
+ 				    [-g goal_area] [-F faults.yaml] <recording.arec>
+ 				Config files hold "key: value" lines overriding
+ 				the defaults (see controller.h). A faults file
+ 				(see fault_injection.h) perturbs the shared
+ 				input sequence. -g takes the node's
+ 				goal_area_threshold param (px).
+ ************************************************************/
+
+#include <alpha_pkg/controller.h>
+#include <alpha_pkg/replay.h>
+#include <functional>
+#include <thread>
+#include <vector>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+namespace {
+
+const double kControlRate = 10.0;
+const float kCommandTolerance = 1e-3;
+const int kNumStates = 4;
+const size_t kMaxSegmentsShown = 20;
+
+typedef alpha_pkg::Command Command;
+
+struct TraceSample {
+	uint16_t state;
+	Command command;			// velocity in effect after the tick
+};
+
+struct Kpis {
+	double time_in_state[kNumStates];
+	double mean_linear_change;		// m/s per tick
+	double mean_angular_change;		// rad/s per tick
+	double rms_angular_change;
+	int command_changes;
+	double distance;				// m, integral of |linear|
+	double time_to_goal;			// s from start, <0 if never
+};
+
+void runController(const alpha_pkg::ControllerConfig& config,
+				   const std::vector<alpha_pkg::TimedInputs>& inputs,
+				   std::vector<TraceSample>& trace){
+	alpha_pkg::Controller controller(config);
+	Command in_effect = {0.0f, 0.0f};
+	trace.resize(inputs.size());
+	for(size_t i = 0; i < inputs.size(); i++){
+		Command command;
+		if(controller.step(inputs[i].stamp, inputs[i].inputs, command)){
+			in_effect = command;
+		}
+		trace[i].state = controller.state();
+		trace[i].command = in_effect;
+	}
+}
+
+Kpis computeKpis(const std::vector<TraceSample>& trace, double period){
+	Kpis kpis;
+	memset(&kpis, 0, sizeof(kpis));
+	kpis.time_to_goal = -1.0;
+
+	double sum_linear = 0, sum_angular = 0, sum_angular_sq = 0;
+	for(size_t i = 0; i < trace.size(); i++){
+		const TraceSample& sample = trace[i];
+		if(sample.state < kNumStates){
+			kpis.time_in_state[sample.state] += period;
+		}
+		if(sample.state == 3 && kpis.time_to_goal < 0){
+			kpis.time_to_goal = i*period;
+		}
+		kpis.distance += fabs(sample.command.linear)*period;
+		if(i > 0){
+			double dl = fabs(sample.command.linear - trace[i - 1].command.linear);
+			double da = fabs(sample.command.angular - trace[i - 1].command.angular);
+			sum_linear += dl;
+			sum_angular += da;
+			sum_angular_sq += da*da;
+			kpis.command_changes += (dl > kCommandTolerance || da > kCommandTolerance);
+		}
+	}
+	double ticks = trace.size() > 1 ? trace.size() - 1 : 1;
+	kpis.mean_linear_change = sum_linear/ticks;
+	kpis.mean_angular_change = sum_angular/ticks;
+	kpis.rms_angular_change = sqrt(sum_angular_sq/ticks);
+	return kpis;
+}
+
+bool diverges(const TraceSample& a, const TraceSample& b){
+	return a.state != b.state ||
+		   fabs(a.command.linear - b.command.linear) > kCommandTolerance ||
+		   fabs(a.command.angular - b.command.angular) > kCommandTolerance;
+}
+
+void printKpi(const char* name, double a, double b, const char* unit){
+	printf("  %-24s %10.3f %10.3f %+10.3f %s\n", name, a, b, b - a, unit);
+}
+
+void usage(const char* program){
+	fprintf(stderr, "usage: %s [-a a.yaml] [-b b.yaml] [-t trace.csv] [-z min_z] [-c color_index] [-g goal_area] [-F faults.yaml] "
+			"<recording.arec>\n", program);
+}
+
+} // namespace
+
+int main(int argc, char** argv){
+	alpha_pkg::ControllerConfig config_a = alpha_pkg::defaultControllerConfig();
+	alpha_pkg::ControllerConfig config_b = config_a;
+	const char* trace_path = NULL;
+	float min_z = 0.7f;
+	int color = alpha_pkg::TARGET_PINK_OUT;
+	uint32_t goal_area = alpha_pkg::kGoalAreaThreshold;
+	alpha_pkg::FaultConfig faults = alpha_pkg::defaultFaultConfig();
+	std::string error;
+
+	int opt;
+	while((opt = getopt(argc, argv, "a:b:t:z:c:g:F:h")) != -1){
+		switch(opt){
+			case 'a':
+				if(!alpha_pkg::loadControllerConfig(optarg, config_a, error)){
+					fprintf(stderr, "%s\n", error.c_str());
+					return 1;
+				}
+				break;
+			case 'b':
+				if(!alpha_pkg::loadControllerConfig(optarg, config_b, error)){
+					fprintf(stderr, "%s\n", error.c_str());
+					return 1;
+				}
+				break;
+			case 't': trace_path = optarg; break;
+			case 'z': min_z = atof(optarg); break;
+			case 'c': color = atoi(optarg); break;
+			case 'g': goal_area = strtoul(optarg, NULL, 10); break;
+			case 'F':
+				if(!alpha_pkg::loadFaultConfig(optarg, faults, error)){
+					fprintf(stderr, "%s\n", error.c_str());
+					return 1;
+				}
+				break;
+			default: usage(argv[0]); return 1;
+		}
+	}
+	if(optind != argc - 1 || color < 0 || color > 1){
+		usage(argv[0]);
+		return 1;
+	}
+
+	std::vector<alpha_pkg::TimedInputs> inputs;
+	if(!alpha_pkg::sampleControlInputs(argv[optind], min_z, color, goal_area, kControlRate, inputs, error, &faults)){
+		fprintf(stderr, "cannot read %s: %s\n", argv[optind], error.c_str());
+		return 1;
+	}
+	if(inputs.empty()){
+		fprintf(stderr, "%s holds no messages\n", argv[optind]);
+		return 1;
+	}
+
+	// Both sides see the very same input vector
+	std::vector<TraceSample> trace_a, trace_b;
+	std::thread thread_a(runController, std::cref(config_a), std::cref(inputs), std::ref(trace_a));
+	std::thread thread_b(runController, std::cref(config_b), std::cref(inputs), std::ref(trace_b));
+	thread_a.join();
+	thread_b.join();
+
+	double period = 1.0/kControlRate;
+	double start = inputs[0].stamp;
+
+	// Divergent segments
+	size_t divergent_ticks = 0, segments = 0;
+	size_t i = 0;
+	printf("divergence (t from start, s):\n");
+	while(i < inputs.size()){
+		if(!diverges(trace_a[i], trace_b[i])){
+			i++;
+			continue;
+		}
+		size_t first = i;
+		while(i < inputs.size() && diverges(trace_a[i], trace_b[i])){
+			i++;
+		}
+		divergent_ticks += i - first;
+		if(segments < kMaxSegmentsShown){
+			printf("  %8.1f - %8.1f  A: state %u cmd (%.3f, %.3f)  B: state %u cmd (%.3f, %.3f)\n",
+				   inputs[first].stamp - start, inputs[i - 1].stamp - start + period,
+				   trace_a[first].state, trace_a[first].command.linear, trace_a[first].command.angular,
+				   trace_b[first].state, trace_b[first].command.linear, trace_b[first].command.angular);
+		}
+		segments++;
+	}
+	if(segments == 0){
+		printf("  none, the traces are identical\n");
+	}
+	else if(segments > kMaxSegmentsShown){
+		printf("  ... %zu more segments\n", segments - kMaxSegmentsShown);
+	}
+	printf("%zu of %zu ticks divergent in %zu segments\n\n", divergent_ticks, inputs.size(), segments);
+
+	Kpis a = computeKpis(trace_a, period);
+	Kpis b = computeKpis(trace_b, period);
+	printf("  %-24s %10s %10s %10s\n", "kpi", "A", "B", "B-A");
+	char name[32];
+	for(int s = 0; s < kNumStates; s++){
+		snprintf(name, sizeof(name), "time in state %d", s);
+		printKpi(name, a.time_in_state[s], b.time_in_state[s], "s");
+	}
+	printKpi("mean |d linear|/tick", a.mean_linear_change, b.mean_linear_change, "m/s");
+	printKpi("mean |d angular|/tick", a.mean_angular_change, b.mean_angular_change, "rad/s");
+	printKpi("rms d angular/tick", a.rms_angular_change, b.rms_angular_change, "rad/s");
+	printKpi("command changes", a.command_changes, b.command_changes, "");
+	printKpi("commanded distance", a.distance, b.distance, "m");
+	printKpi("time to goal", a.time_to_goal, b.time_to_goal, "s (-1: never)");
+
+	if(trace_path){
+		FILE* out = fopen(trace_path, "w");
+		if(!out){
+			fprintf(stderr, "cannot write %s\n", trace_path);
+			return 1;
+		}
+		fprintf(out, "t,obstacle,goal,bumper,goal_x,goal_area,a_state,a_linear,a_angular,b_state,b_linear,b_angular\n");
+		for(size_t k = 0; k < inputs.size(); k++){
+			const alpha_pkg::ControllerInputs& in = inputs[k].inputs;
+			fprintf(out, "%.3f,%d,%d,%d,%.1f,%u,%u,%.3f,%.3f,%u,%.3f,%.3f\n",
+					inputs[k].stamp - start, in.obstacle_found, in.goal_found, in.bumper, in.goal_x, in.goal_area,
+					trace_a[k].state, trace_a[k].command.linear, trace_a[k].command.angular,
+					trace_b[k].state, trace_b[k].command.linear, trace_b[k].command.angular);
+		}
+		fclose(out);
+	}
+	return 0;
+}
@@ -0,0 +1,386 @@
+/************************************************************
+ * Name: batch_perception.cpp
+
+ * Description: Runs the blob fusion and depth obstacle kernels
+ 				of the node over many recordings (see
+ 				recording.h) on all cores. Each recording is one
+ 				task; tasks are dealt largest first to per-worker
+ 				queues and idle workers steal from the back of
+ 				the others' queues.
+
+ 				For every recording a <name>.decisions.csv with
+ 				one line per depth or blobs message is written
+ 				to the output directory, with the nearest and the
+ 				near (5th percentile) depth of each sector, and
+ 				aggregate detection statistics are printed at the
+ 				end.
+
+ 				-k checks depth frames with the two-level check
+ 				of the given stride (see checkDepthBand()). -V
+ 				verifies it against the full scan of every
+ 				frame: an obstacle decision may only differ when
+ 				the full count is within `tolerance` points of
+ 				the threshold, otherwise the frame is reported
+ 				and the exit status is 3. -g takes the node's
+ 				goal_area_threshold param (px).
+
+ * Usage: 		rosrun alpha_pkg batch_perception [-j workers]
+ 				    [-o out_dir] [-z min_z] [-c color_index]
+ 				    [-g goal_area] [-k stride] [-V tolerance] <recording.arec>...
+ ************************************************************/
+
+#include <alpha_pkg/perception.h>
+#include <alpha_pkg/recording.h>
+#include <alpha_pkg/replay.h>
+#include <algorithm>
+#include <atomic>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
+
+namespace {
+
+struct Options {
+	int workers;
+	std::string out_dir;
+	float min_z;
+	int color;
+	uint32_t goal_area;			// px, as the node's goal_area_threshold
+	alpha_pkg::CoarseCheck check;
+	bool verify;
+	size_t tolerance;			// points around the threshold
+	std::vector<std::string> files;
+};
+
+struct Stats {
+	uint64_t depth_frames;
+	uint64_t obstacle_frames;
+	uint64_t blob_messages;
+	uint64_t goal_messages;
+	uint64_t obstacle_onsets;
+	uint64_t goal_onsets;
+	uint64_t bumper_presses;
+	uint64_t close_points;
+	uint64_t points_read;
+	uint64_t coarse_frames;
+	uint64_t disagreements;		// -V: decisions unlike the full scan's
+	uint64_t violations;		// -V: of those, outside the tolerance
+	uint64_t bytes;
+	uint64_t failed_files;
+
+	void add(const Stats& other){
+		depth_frames += other.depth_frames;
+		obstacle_frames += other.obstacle_frames;
+		blob_messages += other.blob_messages;
+		goal_messages += other.goal_messages;
+		obstacle_onsets += other.obstacle_onsets;
+		goal_onsets += other.goal_onsets;
+		bumper_presses += other.bumper_presses;
+		close_points += other.close_points;
+		points_read += other.points_read;
+		coarse_frames += other.coarse_frames;
+		disagreements += other.disagreements;
+		violations += other.violations;
+		bytes += other.bytes;
+		failed_files += other.failed_files;
+	}
+};
+
+/************************************************************
+ * Class Name: TaskQueue
+
+ * Description: Per-worker deque of recording indices. The
+ 				owner takes from the front, thieves from the
+ 				back.
+*************************************************************/
+
+class TaskQueue {
+public:
+	void push(size_t task){
+		std::lock_guard<std::mutex> lock(mutex_);
+		tasks_.push_back(task);
+	}
+	bool pop(size_t& task){
+		std::lock_guard<std::mutex> lock(mutex_);
+		if(tasks_.empty()){
+			return false;
+		}
+		task = tasks_.front();
+		tasks_.pop_front();
+		return true;
+	}
+	bool steal(size_t& task){
+		std::lock_guard<std::mutex> lock(mutex_);
+		if(tasks_.empty()){
+			return false;
+		}
+		task = tasks_.back();
+		tasks_.pop_back();
+		return true;
+	}
+
+private:
+	std::mutex mutex_;
+	std::deque<size_t> tasks_;
+};
+
+/************************************************************
+ * Struct Name: Worker
+
+ * Description: Statistics of one worker
+*************************************************************/
+
+struct Worker {
+	Worker() : tasks_done(0), steals(0) {
+		memset(&stats, 0, sizeof(stats));
+	}
+
+	Stats stats;
+	uint64_t tasks_done;
+	uint64_t steals;
+};
+
+std::string baseName(const std::string& path){
+	size_t slash = path.find_last_of('/');
+	std::string name = slash == std::string::npos ? path : path.substr(slash + 1);
+	size_t dot = name.find_last_of('.');
+	return dot == std::string::npos ? name : name.substr(0, dot);
+}
+
+/************************************************************
+ * Function Name: processRecording
+
+ * Description: Replays one recording through the kernels with
+ 				the same flag semantics as the node callbacks
+ 				and writes its decisions file. The decode
+ 				buffers are per recording, so a stolen task
+ 				shares nothing with its original worker. With
+ 				-V a second replay scans every depth frame in
+ 				full for comparison.
+*************************************************************/
+
+void processRecording(const std::string& path, const Options& options, Worker& worker){
+	alpha_pkg::RecordingReader reader;
+	std::string error;
+	if(!reader.open(path, error)){
+		fprintf(stderr, "cannot read %s: %s\n", path.c_str(), error.c_str());
+		worker.stats.failed_files++;
+		return;
+	}
+
+	std::string out_path = options.out_dir + "/" + baseName(path) + ".decisions.csv";
+	FILE* out = fopen(out_path.c_str(), "w");
+	if(!out){
+		fprintf(stderr, "cannot write %s\n", out_path.c_str());
+		worker.stats.failed_files++;
+		return;
+	}
+	fprintf(out, "stamp,kind,obstacle,close_points,goal_found,goal_x,goal_area");
+	for(int s = 0; s < alpha_pkg::kNumSectors; s++){
+		fprintf(out, ",sector%d", s);
+	}
+	for(int s = 0; s < alpha_pkg::kNumSectors; s++){
+		fprintf(out, ",near%d", s);
+	}
+	fprintf(out, "\n");
+
+	alpha_pkg::ReplayPerception perception(options.min_z, options.color, options.goal_area);
+	alpha_pkg::ReplayPerception reference(options.min_z, options.color, options.goal_area);
+	perception.setCoarseCheck(options.check);
+	const alpha_pkg::DepthScan& scan = perception.scan();
+	const alpha_pkg::ControllerInputs& inputs = perception.inputs();
+
+	for(size_t i = 0; i < reader.size(); i++){
+		const alpha_pkg::IndexEntry& entry = reader.index()[i];
+		worker.stats.bytes += entry.size;
+
+		bool was_obstacle = inputs.obstacle_found;
+		bool was_found = inputs.goal_found;
+		bool was_bumper = inputs.bumper;
+		if(!perception.apply(reader, entry)){
+			fprintf(stderr, "%s: corrupt chunk at %.3f\n", path.c_str(), entry.stamp);
+			continue;
+		}
+
+		if(entry.type == alpha_pkg::CHUNK_DEPTH){
+			worker.stats.depth_frames++;
+			worker.stats.obstacle_frames += inputs.obstacle_found;
+			worker.stats.obstacle_onsets += inputs.obstacle_found && !was_obstacle;
+			worker.stats.close_points += scan.num_close_points;
+			worker.stats.points_read += scan.points_read;
+			worker.stats.coarse_frames += scan.coarse;
+			if(options.verify && reference.apply(reader, entry)){
+				size_t full = reference.scan().num_close_points;
+				bool blocked = full > alpha_pkg::kObstaclePointThreshold;
+				if(blocked != (scan.num_close_points > alpha_pkg::kObstaclePointThreshold)){
+					worker.stats.disagreements++;
+					size_t distance = blocked ? full - alpha_pkg::kObstaclePointThreshold : alpha_pkg::kObstaclePointThreshold - full;
+					if(distance > options.tolerance){
+						worker.stats.violations++;
+						fprintf(stderr, "%s: %.3f: %s on the sample, %lu close points in full\n", path.c_str(), entry.stamp,
+								blocked ? "clear" : "blocked", (unsigned long)full);
+					}
+				}
+			}
+		}
+		else if(entry.type == alpha_pkg::CHUNK_BLOBS){
+			worker.stats.blob_messages++;
+			worker.stats.goal_messages += inputs.goal_found;
+			worker.stats.goal_onsets += inputs.goal_found && !was_found;
+		}
+		else{
+			worker.stats.bumper_presses += inputs.bumper && !was_bumper;
+			continue;
+		}
+
+		fprintf(out, "%.6f,%s,%d,%lu,%d,%.1f,%u", entry.stamp,
+				entry.type == alpha_pkg::CHUNK_DEPTH ? "depth" : "blobs",
+				inputs.obstacle_found, (unsigned long)scan.num_close_points,
+				inputs.goal_found, inputs.goal_x, inputs.goal_area);
+		for(int s = 0; s < alpha_pkg::kNumSectors; s++){
+			fprintf(out, ",%.3f", scan.sector_min_depth[s]);
+		}
+		for(int s = 0; s < alpha_pkg::kNumSectors; s++){
+			fprintf(out, ",%.3f", scan.sector_near_depth[s]);
+		}
+		fprintf(out, "\n");
+	}
+	fclose(out);
+}
+
+void runWorker(size_t id, std::vector<TaskQueue>& queues, const Options& options, Worker& worker){
+	size_t task;
+	while(true){
+		if(queues[id].pop(task)){
+			processRecording(options.files[task], options, worker);
+			worker.tasks_done++;
+			continue;
+		}
+
+		bool stolen = false;
+		for(size_t k = 1; k < queues.size() && !stolen; k++){
+			stolen = queues[(id + k) % queues.size()].steal(task);
+		}
+		if(!stolen){
+			return;
+		}
+		worker.steals++;
+		processRecording(options.files[task], options, worker);
+		worker.tasks_done++;
+	}
+}
+
+void usage(const char* program){
+	fprintf(stderr, "usage: %s [-j workers] [-o out_dir] [-z min_z] [-c color_index] [-g goal_area] [-k stride] "
+			"[-V tolerance] "
+			"<recording.arec>...\n", program);
+}
+
+} // namespace
+
+int main(int argc, char** argv){
+	Options options;
+	options.workers = std::thread::hardware_concurrency() > 0 ? std::thread::hardware_concurrency() : 1;
+	options.out_dir = ".";
+	options.min_z = 0.7f;
+	options.color = alpha_pkg::TARGET_PINK_OUT;
+	options.goal_area = alpha_pkg::kGoalAreaThreshold;
+	options.check = alpha_pkg::defaultCoarseCheck();
+	options.check.stride = 1;
+	options.verify = false;
+	options.tolerance = 0;
+
+	int opt;
+	while((opt = getopt(argc, argv, "j:o:z:c:g:k:V:h")) != -1){
+		switch(opt){
+			case 'j': options.workers = atoi(optarg); break;
+			case 'o': options.out_dir = optarg; break;
+			case 'z': options.min_z = atof(optarg); break;
+			case 'c': options.color = atoi(optarg); break;
+			case 'g': options.goal_area = strtoul(optarg, NULL, 10); break;
+			case 'k': options.check.stride = atoi(optarg); break;
+			case 'V':
+				options.verify = true;
+				options.tolerance = atoi(optarg);
+				break;
+			default: usage(argv[0]); return 1;
+		}
+	}
+	for(int i = optind; i < argc; i++){
+		options.files.push_back(argv[i]);
+	}
+	if(options.files.empty() || options.workers < 1 || options.color < 0 || options.color > 1 || options.check.stride < 1){
+		usage(argv[0]);
+		return 1;
+	}
+
+	// Deal the largest recordings first so the tail of the run is short
+	std::vector<std::pair<off_t, size_t> > by_size;
+	for(size_t i = 0; i < options.files.size(); i++){
+		struct stat st;
+		by_size.push_back(std::make_pair(stat(options.files[i].c_str(), &st) == 0 ? st.st_size : 0, i));
+	}
+	std::sort(by_size.rbegin(), by_size.rend());
+
+	size_t num_workers = std::min<size_t>(options.workers, options.files.size());
+	std::vector<TaskQueue> queues(num_workers);
+	for(size_t i = 0; i < by_size.size(); i++){
+		queues[i % num_workers].push(by_size[i].second);
+	}
+
+	timespec start, end;
+	clock_gettime(CLOCK_MONOTONIC, &start);
+
+	std::vector<Worker> workers(num_workers);
+	std::vector<std::thread> threads;
+	for(size_t i = 0; i < num_workers; i++){
+		threads.push_back(std::thread(runWorker, i, std::ref(queues), std::cref(options), std::ref(workers[i])));
+	}
+	for(size_t i = 0; i < threads.size(); i++){
+		threads[i].join();
+	}
+
+	clock_gettime(CLOCK_MONOTONIC, &end);
+	double elapsed = (end.tv_sec - start.tv_sec) + (end.tv_nsec - start.tv_nsec)*1e-9;
+
+	Stats total;
+	memset(&total, 0, sizeof(total));
+	for(size_t i = 0; i < workers.size(); i++){
+		total.add(workers[i].stats);
+		printf("worker %zu: %lu recordings, %lu stolen, %lu depth frames\n", i,
+			   (unsigned long)workers[i].tasks_done, (unsigned long)workers[i].steals,
+			   (unsigned long)workers[i].stats.depth_frames);
+	}
+
+	double depth_frames = total.depth_frames > 0 ? total.depth_frames : 1;
+	double blob_messages = total.blob_messages > 0 ? total.blob_messages : 1;
+	printf("recordings:        %zu (%lu failed)\n", options.files.size(), (unsigned long)total.failed_files);
+	printf("depth frames:      %lu, obstacle in %.1f%%, %lu onsets, %.1f close points/frame\n",
+		   (unsigned long)total.depth_frames, 100.0*total.obstacle_frames/depth_frames,
+		   (unsigned long)total.obstacle_onsets, total.close_points/depth_frames);
+	printf("depth points read: %.0f/frame (%.1f%% of the band), %.1f%% of the frames decided on the sample\n",
+		   total.points_read/depth_frames, 100.0*total.points_read/depth_frames/(alpha_pkg::kBandRows*alpha_pkg::kImageWidth),
+		   100.0*total.coarse_frames/depth_frames);
+	if(options.verify){
+		printf("verification:      %lu decisions differ from the full scan, %lu beyond %lu points of the threshold\n",
+			   (unsigned long)total.disagreements, (unsigned long)total.violations, (unsigned long)options.tolerance);
+	}
+	printf("blob messages:     %lu, goal in %.1f%%, %lu onsets\n",
+		   (unsigned long)total.blob_messages, 100.0*total.goal_messages/blob_messages,
+		   (unsigned long)total.goal_onsets);
+	printf("bumper presses:    %lu\n", (unsigned long)total.bumper_presses);
+	printf("throughput:        %.0f depth frames/s, %.1f MB/s on %zu workers (%.2f s)\n",
+		   total.depth_frames/elapsed, total.bytes/elapsed/1e6, num_workers, elapsed);
+	if(total.failed_files > 0){
+		return 2;
+	}
+	return total.violations > 0 ? 3 : 0;
+}
@@ -0,0 +1,574 @@
+/************************************************************
+ * Name: color_calibrate.cpp
+
+ * Description: Computes the [Thresholds] line of one colors.txt
+ 				class from labeled frames. The target pixels
+ 				are the ones inside the labeled rectangles of
+ 				each image, the rest are background; images
+ 				without a rectangle are negatives. The search
+ 				maximizes the pixel IoU of the class box, i.e.
+ 				target pixels inside / (target pixels + other
+ 				pixels inside), over boxes on a 64-level YUV
+ 				grid:
+
+ 				1. every sampled pixel goes into a target or a
+ 				   background 64^3 histogram, per worker, and
+ 				   the histograms become 3D prefix sums so any
+ 				   box is counted with 8 lookups;
+ 				2. all boxes of the 16-level grid are scored,
+ 				   the (y_low, y_high) pairs being dealt to the
+ 				   workers;
+ 				3. the best box is refined one bound at a time
+ 				   on the 64-level grid until nothing improves.
+
+ 				Pixels that a class listed earlier in the file
+ 				claims can never be reported as the target
+ 				(the lowest class bit wins), so they count as
+ 				missed whatever the box.
+
+ 				The current and the calibrated thresholds are
+ 				then both checked at full resolution with the
+ 				segmenter and the goal fusion of the node: a
+ 				positive image counts as detected when the goal
+ 				is found with its centroid inside a rectangle,
+ 				a negative image as a false goal when the goal
+ 				is found at all. The colors file is written
+ 				with only the calibrated class changed.
+
+ 				Labels file, one line per rectangle, corners in
+ 				pixels (x1, y1 excluded), paths relative to the
+ 				labels file:
+ 				<image.ppm> <x0> <y0> <x1> <y1>
+ 				<negative.ppm>
+ 				sim_run -D writes such a set from the simulator.
+
+ * Usage: 		rosrun alpha_pkg color_calibrate [-f colors.txt]
+ 				    [-c class] [-j workers] [-s subsample]
+ 				    [-o out_colors.txt] <labels.txt>
+ ************************************************************/
+
+#include <alpha_pkg/color_table.h>
+#include <alpha_pkg/image_io.h>
+#include <alpha_pkg/perception.h>
+#include <alpha_pkg/segmentation.h>
+#include <atomic>
+#include <chrono>
+#include <functional>
+#include <string>
+#include <thread>
+#include <vector>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+namespace {
+
+const int kShift = 2;						// 8-bit value to 64-level bin
+const int kBins = 256 >> kShift;
+const int kCoarseStep = 4;					// bins per coarse level
+const int kPrefixSide = kBins + 1;
+
+struct Rect {
+	int x0, y0, x1, y1;
+};
+
+struct LabeledImage {
+	std::string path;
+	std::vector<Rect> rects;
+};
+
+struct Box {
+	int low[3], high[3];					// inclusive bins, Y U V
+};
+
+struct Histograms {
+	std::vector<uint32_t> target, background;
+	uint64_t target_pixels;					// including claimed ones
+	uint64_t claimed;						// target pixels another class takes
+	uint64_t pixels;
+
+	Histograms() : target(kBins*kBins*kBins), background(kBins*kBins*kBins),
+				   target_pixels(0), claimed(0), pixels(0) {}
+};
+
+// Counts of an image set under one table, at full resolution
+struct Check {
+	uint64_t target_hits, target_pixels, false_hits;
+	int positives, detected, negatives, false_goals;
+};
+
+inline size_t bin(int y, int u, int v){
+	return (static_cast<size_t>(y)*kBins + u)*kBins + v;
+}
+
+bool insideAny(const std::vector<Rect>& rects, int x, int y){
+	for(size_t r = 0; r < rects.size(); r++){
+		if(x >= rects[r].x0 && x < rects[r].x1 && y >= rects[r].y0 && y < rects[r].y1){
+			return true;
+		}
+	}
+	return false;
+}
+
+/************************************************************
+ * Function Name: loadLabels
+
+ * Description: Reads the labels file; the rectangles of one
+ 				image may be spread over several lines
+*************************************************************/
+
+bool loadLabels(const std::string& path, std::vector<LabeledImage>& images, std::string& error){
+	FILE* file = fopen(path.c_str(), "r");
+	if(!file){
+		error = "cannot open " + path;
+		return false;
+	}
+	size_t slash = path.rfind('/');
+	std::string directory = slash == std::string::npos ? "" : path.substr(0, slash + 1);
+
+	char line[1024];
+	int line_number = 0;
+	while(fgets(line, sizeof(line), file)){
+		line_number++;
+		char* comment = strchr(line, '#');
+		if(comment){
+			*comment = '\0';
+		}
+		char name[512];
+		Rect rect;
+		int fields = sscanf(line, " %511s %d %d %d %d", name, &rect.x0, &rect.y0, &rect.x1, &rect.y1);
+		if(fields <= 0){
+			continue;
+		}
+		if((fields != 1 && fields != 5) || (fields == 5 && (rect.x1 <= rect.x0 || rect.y1 <= rect.y0))){
+			char buffer[32];
+			snprintf(buffer, sizeof(buffer), ":%d", line_number);
+			error = "cannot parse " + path + buffer;
+			fclose(file);
+			return false;
+		}
+		std::string image_path = name[0] == '/' ? std::string(name) : directory + name;
+		size_t i = 0;
+		while(i < images.size() && images[i].path != image_path){
+			i++;
+		}
+		if(i == images.size()){
+			images.push_back(LabeledImage());
+			images.back().path = image_path;
+		}
+		if(fields == 5){
+			images[i].rects.push_back(rect);
+		}
+	}
+	fclose(file);
+	return true;
+}
+
+/************************************************************
+ * Function Name: accumulate
+
+ * Description: Worker of step 1: histograms every subsample-th
+ 				pixel of every subsample-th row of its images
+*************************************************************/
+
+void accumulate(const std::vector<LabeledImage>& images, const alpha_pkg::ColorTable& table, uint32_t earlier_classes,
+				int subsample, std::atomic<size_t>& next, Histograms& histograms, std::atomic<bool>& failed){
+	std::vector<uint8_t> rgb;
+	for(size_t i = next++; i < images.size(); i = next++){
+		int width, height;
+		std::string error;
+		if(!alpha_pkg::readPpm(images[i].path, rgb, width, height, error)){
+			fprintf(stderr, "%s\n", error.c_str());
+			failed = true;
+			continue;
+		}
+		for(int row = 0; row < height; row += subsample){
+			const uint8_t* pixel = &rgb[static_cast<size_t>(row)*3*width];
+			for(int col = 0; col < width; col += subsample){
+				const uint8_t* p = pixel + 3*col;
+				int y, u, v;
+				alpha_pkg::rgbToYuv(p[0], p[1], p[2], y, u, v);
+				bool target = insideAny(images[i].rects, col, row);
+				histograms.pixels++;
+				histograms.target_pixels += target;
+				if(table.classify(y, u, v) & earlier_classes){
+					histograms.claimed += target;
+					continue;
+				}
+				size_t b = bin(y >> kShift, u >> kShift, v >> kShift);
+				if(target){
+					histograms.target[b]++;
+				}
+				else{
+					histograms.background[b]++;
+				}
+			}
+		}
+	}
+}
+
+// Inclusive 3D prefix sums with a zero border: sums[y+1][u+1][v+1]
+// holds the count of bins [0, y] x [0, u] x [0, v]
+void prefixSums(const std::vector<uint32_t>& histogram, std::vector<uint64_t>& sums){
+	sums.assign(static_cast<size_t>(kPrefixSide)*kPrefixSide*kPrefixSide, 0);
+	for(int y = 0; y < kBins; y++){
+		for(int u = 0; u < kBins; u++){
+			for(int v = 0; v < kBins; v++){
+				size_t at = (static_cast<size_t>(y + 1)*kPrefixSide + u + 1)*kPrefixSide + v + 1;
+				sums[at] = histogram[bin(y, u, v)];
+			}
+		}
+	}
+	const size_t strides[3] = {static_cast<size_t>(kPrefixSide)*kPrefixSide, kPrefixSide, 1};
+	for(int axis = 0; axis < 3; axis++){
+		for(size_t at = strides[axis]; at < sums.size(); at++){
+			bool border = (at/strides[axis]) % kPrefixSide == 0;
+			if(!border){
+				sums[at] += sums[at - strides[axis]];
+			}
+		}
+	}
+}
+
+inline uint64_t boxCount(const std::vector<uint64_t>& sums, const Box& box){
+	const size_t side = kPrefixSide;
+	size_t y[2] = {static_cast<size_t>(box.low[0]), static_cast<size_t>(box.high[0]) + 1};
+	size_t u[2] = {static_cast<size_t>(box.low[1]), static_cast<size_t>(box.high[1]) + 1};
+	size_t v[2] = {static_cast<size_t>(box.low[2]), static_cast<size_t>(box.high[2]) + 1};
+	int64_t count = 0;
+	for(int corner = 0; corner < 8; corner++){
+		int a = corner & 1, b = (corner >> 1) & 1, c = (corner >> 2) & 1;
+		int64_t value = sums[(y[a]*side + u[b])*side + v[c]];
+		count += ((a + b + c) % 2 == 1) ? value : -value;
+	}
+	return count;
+}
+
+struct Scorer {
+	std::vector<uint64_t> target, background;
+	uint64_t target_pixels;
+
+	double iou(const Box& box) const {
+		uint64_t hits = boxCount(target, box);
+		uint64_t false_hits = boxCount(background, box);
+		return target_pixels + false_hits > 0 ? static_cast<double>(hits)/(target_pixels + false_hits) : 0;
+	}
+};
+
+/************************************************************
+ * Function Name: coarseSearch
+
+ * Description: Worker of step 2. Takes (y_low, y_high) pairs
+ 				of the 16-level grid by index and scores every
+ 				U and V range with them.
+*************************************************************/
+
+void coarseSearch(const Scorer& scorer, std::atomic<int>& next, Box& best, double& best_iou){
+	const int levels = kBins/kCoarseStep;
+	const int pairs = levels*(levels + 1)/2;
+	best_iou = -1;
+	for(int p = next++; p < pairs; p = next++){
+		int y_low = 0, rest = p;
+		while(rest >= levels - y_low){
+			rest -= levels - y_low;
+			y_low++;
+		}
+		Box box;
+		box.low[0] = y_low*kCoarseStep;
+		box.high[0] = (y_low + rest + 1)*kCoarseStep - 1;
+		for(int u_low = 0; u_low < levels; u_low++){
+			for(int u_high = u_low; u_high < levels; u_high++){
+				box.low[1] = u_low*kCoarseStep;
+				box.high[1] = (u_high + 1)*kCoarseStep - 1;
+				for(int v_low = 0; v_low < levels; v_low++){
+					for(int v_high = v_low; v_high < levels; v_high++){
+						box.low[2] = v_low*kCoarseStep;
+						box.high[2] = (v_high + 1)*kCoarseStep - 1;
+						double iou = scorer.iou(box);
+						if(iou > best_iou){
+							best_iou = iou;
+							best = box;
+						}
+					}
+				}
+			}
+		}
+	}
+}
+
+/************************************************************
+ * Function Name: refine
+
+ * Description: Step 3: moves each bound to its best value with
+ 				the others fixed, until a full round changes
+ 				nothing
+*************************************************************/
+
+double refine(const Scorer& scorer, Box& box){
+	double best_iou = scorer.iou(box);
+	bool improved = true;
+	while(improved){
+		improved = false;
+		for(int channel = 0; channel < 3; channel++){
+			for(int side = 0; side < 2; side++){
+				Box candidate = box;
+				int& bound = side == 0 ? candidate.low[channel] : candidate.high[channel];
+				int first = side == 0 ? 0 : box.low[channel];
+				int last = side == 0 ? box.high[channel] : kBins - 1;
+				for(int value = first; value <= last; value++){
+					bound = value;
+					double iou = scorer.iou(candidate);
+					if(iou > best_iou + 1e-12){
+						best_iou = iou;
+						box = candidate;
+						improved = true;
+					}
+				}
+			}
+		}
+	}
+	return best_iou;
+}
+
+/************************************************************
+ * Function Name: checkImages
+
+ * Description: Worker of the validation: segments its images
+ 				with `table` at full resolution and counts the
+ 				target pixels of the class, the goal detections
+ 				and the false goals
+*************************************************************/
+
+void checkImages(const std::vector<LabeledImage>& images, const alpha_pkg::ColorTable& table, int target_class,
+				 std::atomic<size_t>& next, Check& check){
+	memset(&check, 0, sizeof(check));
+	std::vector<uint8_t> rgb;
+	std::vector<alpha_pkg::BlobObservation> blobs(64);
+	alpha_pkg::Segmenter segmenter(alpha_pkg::kImageWidth, alpha_pkg::kImageHeight, 10);
+	const uint8_t* color = table.colorClass(target_class).rgb;
+	for(size_t i = next++; i < images.size(); i = next++){
+		int width, height;
+		std::string error;
+		if(!alpha_pkg::readPpm(images[i].path, rgb, width, height, error)){
+			continue;
+		}
+		for(int row = 0; row < height; row++){
+			for(int col = 0; col < width; col++){
+				const uint8_t* p = &rgb[3*(static_cast<size_t>(row)*width + col)];
+				uint32_t bits = table.classifyRgb(p[0], p[1], p[2]);
+				bool hit = bits && __builtin_ctz(bits) == target_class;
+				if(insideAny(images[i].rects, col, row)){
+					check.target_pixels++;
+					check.target_hits += hit;
+				}
+				else{
+					check.false_hits += hit;
+				}
+			}
+		}
+
+		if(width != alpha_pkg::kImageWidth || height != alpha_pkg::kImageHeight){
+			continue;
+		}
+		size_t count = segmenter.segment(&rgb[0], 3*width, table, &blobs[0], blobs.size());
+		alpha_pkg::GoalEstimate goal;
+		alpha_pkg::fuseBlobs(&blobs[0], count, color, goal);
+		if(images[i].rects.empty()){
+			check.negatives++;
+			check.false_goals += goal.found;
+		}
+		else{
+			check.positives++;
+			check.detected += goal.found &&
+							  insideAny(images[i].rects, static_cast<int>(goal.x) + alpha_pkg::kImageWidth/2,
+										static_cast<int>(goal.y));
+		}
+	}
+}
+
+Check checkAll(const std::vector<LabeledImage>& images, const alpha_pkg::ColorTable& table, int target_class, int workers){
+	std::atomic<size_t> next(0);
+	std::vector<Check> checks(workers);
+	std::vector<std::thread> threads;
+	for(int w = 0; w < workers; w++){
+		threads.push_back(std::thread(checkImages, std::cref(images), std::cref(table), target_class,
+									  std::ref(next), std::ref(checks[w])));
+	}
+	Check total;
+	memset(&total, 0, sizeof(total));
+	for(int w = 0; w < workers; w++){
+		threads[w].join();
+		total.target_hits += checks[w].target_hits;
+		total.target_pixels += checks[w].target_pixels;
+		total.false_hits += checks[w].false_hits;
+		total.positives += checks[w].positives;
+		total.detected += checks[w].detected;
+		total.negatives += checks[w].negatives;
+		total.false_goals += checks[w].false_goals;
+	}
+	return total;
+}
+
+void printCheck(const char* name, const alpha_pkg::ColorClass& color, const Check& check){
+	double iou = check.target_pixels + check.false_hits > 0 ?
+				 static_cast<double>(check.target_hits)/(check.target_pixels + check.false_hits) : 0;
+	printf("  %-11s ( %3d:%3d, %3d:%3d, %3d:%3d )  %9.3f  %5d/%-5d %5d/%-5d\n", name,
+		   color.y_low, color.y_high, color.u_low, color.u_high, color.v_low, color.v_high,
+		   iou, check.detected, check.positives, check.false_goals, check.negatives);
+}
+
+double secondsSince(const std::chrono::steady_clock::time_point& start){
+	return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+void usage(const char* program){
+	fprintf(stderr, "usage: %s [-f colors.txt] [-c class] [-j workers] [-s subsample] "
+			"[-o out_colors.txt] <labels.txt>\n", program);
+}
+
+} // namespace
+
+int main(int argc, char** argv){
+	std::string colors_path = "colors.txt";
+	std::string class_name = "PinkOut";
+	std::string out_path = "colors_calibrated.txt";
+	int workers = std::thread::hardware_concurrency();
+	int subsample = 1;
+	int opt;
+	while((opt = getopt(argc, argv, "f:c:j:s:o:h")) != -1){
+		switch(opt){
+			case 'f': colors_path = optarg; break;
+			case 'c': class_name = optarg; break;
+			case 'j': workers = atoi(optarg); break;
+			case 's': subsample = atoi(optarg); break;
+			case 'o': out_path = optarg; break;
+			default: usage(argv[0]); return 1;
+		}
+	}
+	if(optind + 1 != argc || subsample < 1){
+		usage(argv[0]);
+		return 1;
+	}
+	workers = workers > 0 ? workers : 1;
+
+	std::string error;
+	alpha_pkg::ColorTable table;
+	std::vector<LabeledImage> images;
+	if(!table.load(colors_path, error) || !loadLabels(argv[optind], images, error)){
+		fprintf(stderr, "%s\n", error.c_str());
+		return 1;
+	}
+	int target_class = table.findName(class_name);
+	if(target_class < 0){
+		fprintf(stderr, "no class %s in %s\n", class_name.c_str(), colors_path.c_str());
+		return 1;
+	}
+	uint32_t earlier_classes = (1u << target_class) - 1;
+
+	// 1. Histograms
+	std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+	std::vector<Histograms> partial(workers);
+	std::atomic<size_t> next_image(0);
+	std::atomic<bool> failed(false);
+	std::vector<std::thread> threads;
+	for(int w = 0; w < workers; w++){
+		threads.push_back(std::thread(accumulate, std::cref(images), std::cref(table), earlier_classes, subsample,
+									  std::ref(next_image), std::ref(partial[w]), std::ref(failed)));
+	}
+	Histograms histograms;
+	for(int w = 0; w < workers; w++){
+		threads[w].join();
+		for(size_t b = 0; b < histograms.target.size(); b++){
+			histograms.target[b] += partial[w].target[b];
+			histograms.background[b] += partial[w].background[b];
+		}
+		histograms.target_pixels += partial[w].target_pixels;
+		histograms.claimed += partial[w].claimed;
+		histograms.pixels += partial[w].pixels;
+	}
+	threads.clear();
+	partial.clear();
+	if(failed){
+		return 1;
+	}
+	if(histograms.target_pixels == 0){
+		fprintf(stderr, "no labeled target pixels\n");
+		return 1;
+	}
+	Scorer scorer;
+	scorer.target_pixels = histograms.target_pixels;
+	prefixSums(histograms.target, scorer.target);
+	prefixSums(histograms.background, scorer.background);
+	double histogram_time = secondsSince(start);
+
+	// 2. Coarse grid, in parallel
+	start = std::chrono::steady_clock::now();
+	std::atomic<int> next_pair(0);
+	std::vector<Box> bests(workers);
+	std::vector<double> best_ious(workers);
+	for(int w = 0; w < workers; w++){
+		threads.push_back(std::thread(coarseSearch, std::cref(scorer), std::ref(next_pair),
+									  std::ref(bests[w]), std::ref(best_ious[w])));
+	}
+	Box best = bests[0];
+	double best_iou = -1;
+	for(int w = 0; w < workers; w++){
+		threads[w].join();
+		if(best_ious[w] > best_iou){
+			best_iou = best_ious[w];
+			best = bests[w];
+		}
+	}
+	threads.clear();
+	double coarse_iou = best_iou;
+	double coarse_time = secondsSince(start);
+
+	// 3. Refinement
+	start = std::chrono::steady_clock::now();
+	best_iou = refine(scorer, best);
+	double refine_time = secondsSince(start);
+
+	alpha_pkg::ColorTable calibrated;
+	for(size_t c = 0; c < table.numClasses(); c++){
+		alpha_pkg::ColorClass color = table.colorClass(c);
+		if(static_cast<int>(c) == target_class){
+			color.y_low = best.low[0] << kShift;
+			color.y_high = (best.high[0] << kShift) | ((1 << kShift) - 1);
+			color.u_low = best.low[1] << kShift;
+			color.u_high = (best.high[1] << kShift) | ((1 << kShift) - 1);
+			color.v_low = best.low[2] << kShift;
+			color.v_high = (best.high[2] << kShift) | ((1 << kShift) - 1);
+		}
+		calibrated.addClass(color);
+	}
+
+	int positives = 0;
+	for(size_t i = 0; i < images.size(); i++){
+		positives += !images[i].rects.empty();
+	}
+	printf("%lu images (%d with targets), %.1f M pixels sampled, %.2f M labeled as %s\n",
+		   (unsigned long)images.size(), positives, histograms.pixels*1e-6, histograms.target_pixels*1e-6,
+		   class_name.c_str());
+	if(histograms.claimed > 0){
+		printf("  %.1f%% of the labeled pixels belong to an earlier class and cannot be %s\n",
+			   100.0*histograms.claimed/histograms.target_pixels, class_name.c_str());
+	}
+	printf("search: histograms %.2f s, coarse grid IoU %.3f in %.2f s on %d workers, refined IoU %.3f in %.3f s\n",
+		   histogram_time, coarse_iou, coarse_time, workers, best_iou, refine_time);
+
+	start = std::chrono::steady_clock::now();
+	Check before = checkAll(images, table, target_class, workers);
+	Check after = checkAll(images, calibrated, target_class, workers);
+	printf("full resolution check (%.2f s):\n", secondsSince(start));
+	printf("  %-11s %-33s  %9s  %-11s %-11s\n", "", "thresholds (Y, U, V)", "pixel IoU", "detected", "false goals");
+	printCheck("current", table.colorClass(target_class), before);
+	printCheck("calibrated", calibrated.colorClass(target_class), after);
+
+	if(!calibrated.save(out_path, error)){
+		fprintf(stderr, "%s\n", error.c_str());
+		return 1;
+	}
+	printf("wrote %s\n", out_path.c_str());
+	return 0;
+}
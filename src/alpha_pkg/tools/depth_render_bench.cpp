@@ -0,0 +1,113 @@
+/************************************************************
+ * Name: depth_render_bench.cpp
+
+ * Description: Throughput of the simulator depth renderer.
+ 				Renders the obstacle band for the first scenarios
+ 				of the standard suite, turning in place from the
+ 				start pose, and prints frames per second on one
+ 				core. Each frame is also run through
+ 				scanDepthBand() as a sanity check of the output.
+
+ * Usage: 		rosrun alpha_pkg depth_render_bench [-s scenarios]
+ 				    [-n frames] [-f z|points|mm] [-g sigma_coeff]
+ 				    [-d dropout]
+ ************************************************************/
+
+#include <alpha_pkg/depth_renderer.h>
+#include <alpha_pkg/recording.h>
+#include <chrono>
+#include <vector>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+namespace {
+
+enum Format { FORMAT_Z, FORMAT_POINTS, FORMAT_MM };
+
+void usage(const char* program){
+	fprintf(stderr, "usage: %s [-s scenarios] [-n frames] [-f z|points|mm] [-g sigma_coeff] [-d dropout]\n", program);
+}
+
+} // namespace
+
+int main(int argc, char** argv){
+	int scenarios = 100, frames = 100;
+	Format format = FORMAT_Z;
+	alpha_pkg::DepthNoise noise;
+	noise.sigma_coeff = 0.0012f;
+	noise.dropout = 0.01f;
+	noise.seed = 1;
+
+	int opt;
+	while((opt = getopt(argc, argv, "s:n:f:g:d:h")) != -1){
+		switch(opt){
+			case 's': scenarios = atoi(optarg); break;
+			case 'n': frames = atoi(optarg); break;
+			case 'f':
+				if(strcmp(optarg, "z") == 0) format = FORMAT_Z;
+				else if(strcmp(optarg, "points") == 0) format = FORMAT_POINTS;
+				else if(strcmp(optarg, "mm") == 0) format = FORMAT_MM;
+				else { usage(argv[0]); return 1; }
+				break;
+			case 'g': noise.sigma_coeff = atof(optarg); break;
+			case 'd': noise.dropout = atof(optarg); break;
+			default: usage(argv[0]); return 1;
+		}
+	}
+	if(optind != argc || scenarios <= 0 || frames <= 0){
+		usage(argv[0]);
+		return 1;
+	}
+
+	const size_t pixels = static_cast<size_t>(alpha_pkg::kBandRows)*alpha_pkg::kImageWidth;
+	alpha_pkg::DepthRenderer renderer(alpha_pkg::defaultCameraModel(), noise);
+	std::vector<float> z(format == FORMAT_POINTS ? 4*pixels : pixels);
+	std::vector<uint16_t> mm(pixels);
+	alpha_pkg::FrameArena arena(1 << 20);
+	alpha_pkg::DepthScan scan;
+	alpha_pkg::ScenarioParams params = alpha_pkg::defaultScenarioParams();
+
+	double render_time = 0;
+	size_t close_points = 0;
+	for(int i = 0; i < scenarios; i++){
+		alpha_pkg::Scenario scenario = alpha_pkg::generateScenario(alpha_pkg::standardSuiteSeed(i), params);
+		renderer.setScene(scenario);
+		for(int f = 0; f < frames; f++){
+			std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+			renderer.setPose(scenario.start_x, scenario.start_y, scenario.start_heading + 0.05f*f);
+			if(format == FORMAT_Z){
+				renderer.renderDepth(&z[0], alpha_pkg::kBandFirstRow, alpha_pkg::kBandRows);
+			}
+			else if(format == FORMAT_POINTS){
+				renderer.renderPoints(&z[0], 4, alpha_pkg::kBandFirstRow, alpha_pkg::kBandRows);
+			}
+			else{
+				renderer.renderDepthImage(&mm[0], alpha_pkg::kBandFirstRow, alpha_pkg::kBandRows);
+			}
+			render_time += std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+			// Same check as the node, on whatever format was rendered
+			alpha_pkg::DepthView view;
+			if(format == FORMAT_MM){
+				alpha_pkg::millimetresToDepth(&mm[0], pixels, &z[0]);
+			}
+			view.z = format == FORMAT_POINTS ? &z[2] : &z[0];
+			view.stride = format == FORMAT_POINTS ? 4 : 1;
+			view.width = alpha_pkg::kImageWidth;
+			view.height = alpha_pkg::kBandRows;
+			view.first_row = alpha_pkg::kBandFirstRow;
+			arena.reset();
+			alpha_pkg::scanDepthBand(view, 0.7f, arena, scan);
+			close_points += scan.num_close_points;
+		}
+	}
+
+	double total = static_cast<double>(scenarios)*frames;
+	printf("%d scenarios x %d frames, %s band of %zu pixels\n", scenarios, frames,
+		   format == FORMAT_Z ? "z" : format == FORMAT_POINTS ? "PointXYZ" : "uint16 mm", pixels);
+	printf("  %.0f frames/s per core, %.2f ns/pixel\n", total/render_time, render_time/(total*pixels)*1e9);
+	printf("  mean close points %.1f\n", close_points/total);
+	return 0;
+}
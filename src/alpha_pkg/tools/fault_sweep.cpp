@@ -0,0 +1,450 @@
+/************************************************************
+ * Name: fault_sweep.cpp
+
+ * Description: Measures how the follower's KPIs degrade as a
+ 				function of each fault rate. Every fault of the
+ 				sweep (see kFaults) is raised through the given
+ 				levels on top of a base fault config, one fault
+ 				at a time, and the KPIs of every level are
+ 				printed next to the fault-free baseline.
+
+ 				Closed loop (default): scenarios of the standard
+ 				suite run in the simulator; KPIs are success and
+ 				goal rates, time to goal, bumper hits and
+ 				distance travelled.
+
+ 				Open loop (-r): the recording is replayed
+ 				through the injector with -m fault seeds per
+ 				level and the controller runs on the perturbed
+ 				inputs; KPIs are the share of ticks whose state
+ 				or command diverges from the fault-free run, the
+ 				goal rate, time to goal and command changes.
+
+ 				Levels are probabilities for rate faults and
+ 				seconds for delay faults. -g takes the node's
+ 				goal_area_threshold param (px) for the replay.
+
+ * Usage: 		rosrun alpha_pkg fault_sweep [-r recording.arec]
+ 				    [-n scenarios] [-m repeats] [-k fault]
+ 				    [-l 0,0.05,0.1,0.2,0.4] [-F base.yaml]
+ 				    [-a controller.yaml] [-f colors.txt]
+ 				    [-c color_index] [-g goal_area] [-t time_limit]
+ 				    [-j workers] [-o out.csv]
+ ************************************************************/
+
+#include <alpha_pkg/replay.h>
+#include <alpha_pkg/simulator.h>
+#include <atomic>
+#include <functional>
+#include <string>
+#include <thread>
+#include <vector>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+namespace {
+
+typedef alpha_pkg::FaultConfig FaultConfig;
+
+const double kControlRate = 10.0;
+const float kCommandTolerance = 1e-3;
+
+void setDelay(FaultConfig& config, int stream, float level){
+	config.streams[stream].delay = level;
+}
+
+void depthDelay(FaultConfig& config, float level){ setDelay(config, alpha_pkg::FAULT_DEPTH, level); }
+void blobsDelay(FaultConfig& config, float level){ setDelay(config, alpha_pkg::FAULT_BLOBS, level); }
+void depthDrop(FaultConfig& config, float level){ config.streams[alpha_pkg::FAULT_DEPTH].drop = level; }
+void blobsDrop(FaultConfig& config, float level){ config.streams[alpha_pkg::FAULT_BLOBS].drop = level; }
+void bumperDrop(FaultConfig& config, float level){ config.streams[alpha_pkg::FAULT_BUMPER].drop = level; }
+void bounce(FaultConfig& config, float level){ config.bounce = level; }
+
+void duplicate(FaultConfig& config, float level){
+	for(int s = 0; s < alpha_pkg::NUM_FAULT_STREAMS; s++){
+		config.streams[s].duplicate = level;
+	}
+}
+
+void reorder(FaultConfig& config, float level){
+	config.streams[alpha_pkg::FAULT_DEPTH].reorder = level;
+	config.streams[alpha_pkg::FAULT_BLOBS].reorder = level;
+}
+
+struct SweptFault {
+	const char* name;
+	void (*apply)(FaultConfig& config, float level);
+};
+
+const SweptFault kFaults[] = {
+	{"depth_delay", depthDelay},
+	{"blobs_delay", blobsDelay},
+	{"depth_drop", depthDrop},
+	{"blobs_drop", blobsDrop},
+	{"bumper_drop", bumperDrop},
+	{"duplicate", duplicate},
+	{"reorder", reorder},
+	{"bounce", bounce}};
+const int kNumFaults = sizeof(kFaults)/sizeof(kFaults[0]);
+
+// One fault config of the sweep; config 0 is the baseline
+struct SweepPoint {
+	int fault;				// -1 for the baseline
+	float level;
+	FaultConfig faults;
+};
+
+// KPIs of one sweep point, averaged over its runs
+struct Kpis {
+	int runs;
+	double success;			// sim: fraction of runs
+	double declared;		// fraction of runs reaching state 3
+	double time_to_goal;	// s, mean over runs reaching state 3
+	double bumper_hits;		// sim: per run
+	double distance;		// sim: m per run
+	double divergence;		// replay: fraction of ticks
+	double command_changes;	// replay: per run
+};
+
+/************************************************************
+ * Function Name: simWorker
+
+ * Description: Runs (point, scenario) items of the closed-loop
+ 				sweep until none is left
+*************************************************************/
+
+void simWorker(const alpha_pkg::SimConfig& base, const alpha_pkg::ColorTable& colors,
+			   const std::vector<SweepPoint>& points, int scenarios, std::atomic<int>& next,
+			   std::vector<alpha_pkg::SimResult>& results){
+	alpha_pkg::ScenarioParams params = alpha_pkg::defaultScenarioParams();
+	int count = points.size()*scenarios;
+	for(int item = next++; item < count; item = next++){
+		alpha_pkg::SimConfig config = base;
+		config.faults = points[item/scenarios].faults;
+		alpha_pkg::Simulator simulator(config, colors);
+		alpha_pkg::Scenario scenario = alpha_pkg::generateScenario(alpha_pkg::standardSuiteSeed(item % scenarios), params);
+		results[item] = simulator.run(scenario);
+	}
+}
+
+struct Trace {
+	std::vector<uint16_t> states;
+	std::vector<alpha_pkg::Command> commands;
+};
+
+void runController(const alpha_pkg::ControllerConfig& config,
+				   const std::vector<alpha_pkg::TimedInputs>& inputs, Trace& trace){
+	alpha_pkg::Controller controller(config);
+	alpha_pkg::Command in_effect = {0.0f, 0.0f};
+	trace.states.resize(inputs.size());
+	trace.commands.resize(inputs.size());
+	for(size_t i = 0; i < inputs.size(); i++){
+		alpha_pkg::Command command;
+		if(controller.step(inputs[i].stamp, inputs[i].inputs, command)){
+			in_effect = command;
+		}
+		trace.states[i] = controller.state();
+		trace.commands[i] = in_effect;
+	}
+}
+
+bool differs(const alpha_pkg::Command& a, const alpha_pkg::Command& b){
+	return fabs(a.linear - b.linear) > kCommandTolerance || fabs(a.angular - b.angular) > kCommandTolerance;
+}
+
+struct ReplayRun {
+	bool ok;
+	double divergence;
+	double time_to_goal;	// <0 if never
+	int command_changes;
+};
+
+/************************************************************
+ * Function Name: replayWorker
+
+ * Description: Runs (point, repeat) items of the open-loop
+ 				sweep against the fault-free trace
+*************************************************************/
+
+void replayWorker(const std::string& path, float min_z, int color, uint32_t goal_area,
+				  const alpha_pkg::ControllerConfig& controller, const Trace& clean,
+				  const std::vector<SweepPoint>& points, int repeats, std::atomic<int>& next,
+				  std::vector<ReplayRun>& runs){
+	int count = points.size()*repeats;
+	std::vector<alpha_pkg::TimedInputs> inputs;
+	std::string error;
+	Trace trace;
+	for(int item = next++; item < count; item = next++){
+		FaultConfig faults = points[item/repeats].faults;
+		faults.seed += item % repeats;
+		ReplayRun& run = runs[item];
+		run.ok = alpha_pkg::sampleControlInputs(path, min_z, color, goal_area, kControlRate, inputs, error, &faults);
+		if(!run.ok){
+			continue;
+		}
+		runController(controller, inputs, trace);
+
+		size_t n = std::min(trace.states.size(), clean.states.size());
+		size_t divergent = 0;
+		run.time_to_goal = -1;
+		run.command_changes = 0;
+		for(size_t i = 0; i < trace.states.size(); i++){
+			if(i < n && (trace.states[i] != clean.states[i] || differs(trace.commands[i], clean.commands[i]))){
+				divergent++;
+			}
+			if(trace.states[i] == 3 && run.time_to_goal < 0){
+				run.time_to_goal = i/kControlRate;
+			}
+			if(i > 0 && differs(trace.commands[i], trace.commands[i - 1])){
+				run.command_changes++;
+			}
+		}
+		run.divergence = n ? static_cast<double>(divergent)/n : 0;
+	}
+}
+
+bool parseLevels(const char* text, std::vector<float>& levels){
+	levels.clear();
+	const char* p = text;
+	while(*p){
+		char* end;
+		float level = strtof(p, &end);
+		if(end == p || level < 0){
+			return false;
+		}
+		levels.push_back(level);
+		p = *end == ',' ? end + 1 : end;
+		if(*end && *end != ','){
+			return false;
+		}
+	}
+	return !levels.empty();
+}
+
+void usage(const char* program){
+	fprintf(stderr, "usage: %s [-r recording.arec] [-n scenarios] [-m repeats] [-k fault] [-l levels] "
+			"[-F base.yaml] [-a controller.yaml] [-f colors.txt] [-c color_index] [-g goal_area] "
+			"[-t time_limit] [-j workers] [-o out.csv]\nfaults:", program);
+	for(int f = 0; f < kNumFaults; f++){
+		fprintf(stderr, " %s", kFaults[f].name);
+	}
+	fprintf(stderr, "\n");
+}
+
+} // namespace
+
+int main(int argc, char** argv){
+	const char* recording = NULL;
+	int scenarios = 20;
+	int repeats = 10;
+	int only_fault = -1;
+	std::vector<float> levels;
+	parseLevels("0.05,0.1,0.2,0.4", levels);
+	int workers = std::thread::hardware_concurrency();
+	std::string colors_path = "colors.txt";
+	const char* csv_path = NULL;
+	alpha_pkg::SimConfig config = alpha_pkg::defaultSimConfig();
+	uint32_t goal_area = alpha_pkg::kGoalAreaThreshold;
+	std::string error;
+
+	int opt;
+	while((opt = getopt(argc, argv, "r:n:m:k:l:F:a:f:c:g:t:j:o:h")) != -1){
+		switch(opt){
+			case 'r': recording = optarg; break;
+			case 'n': scenarios = atoi(optarg); break;
+			case 'm': repeats = atoi(optarg); break;
+			case 'k':
+				only_fault = 0;
+				while(only_fault < kNumFaults && strcmp(kFaults[only_fault].name, optarg) != 0){
+					only_fault++;
+				}
+				if(only_fault == kNumFaults){
+					fprintf(stderr, "unknown fault '%s'\n", optarg);
+					usage(argv[0]);
+					return 1;
+				}
+				break;
+			case 'l':
+				if(!parseLevels(optarg, levels)){
+					fprintf(stderr, "cannot parse levels '%s'\n", optarg);
+					return 1;
+				}
+				break;
+			case 'F':
+				if(!alpha_pkg::loadFaultConfig(optarg, config.faults, error)){
+					fprintf(stderr, "%s\n", error.c_str());
+					return 1;
+				}
+				break;
+			case 'a':
+				if(!alpha_pkg::loadControllerConfig(optarg, config.controller, error)){
+					fprintf(stderr, "%s\n", error.c_str());
+					return 1;
+				}
+				break;
+			case 'f': colors_path = optarg; break;
+			case 'c': config.color = atoi(optarg); break;
+			case 'g': goal_area = strtoul(optarg, NULL, 10); break;
+			case 't': config.time_limit = atof(optarg); break;
+			case 'j': workers = atoi(optarg); break;
+			case 'o': csv_path = optarg; break;
+			default: usage(argv[0]); return 1;
+		}
+	}
+	if(optind != argc || scenarios <= 0 || repeats <= 0 || config.color < 0 || config.color > 1){
+		usage(argv[0]);
+		return 1;
+	}
+	workers = workers > 0 ? workers : 1;
+
+	// Baseline, then every level of every swept fault
+	std::vector<SweepPoint> points;
+	SweepPoint baseline = {-1, 0.0f, config.faults};
+	points.push_back(baseline);
+	for(int f = 0; f < kNumFaults; f++){
+		if(only_fault >= 0 && f != only_fault){
+			continue;
+		}
+		for(size_t l = 0; l < levels.size(); l++){
+			if(levels[l] == 0){
+				continue;
+			}
+			SweepPoint point = {f, levels[l], config.faults};
+			kFaults[f].apply(point.faults, levels[l]);
+			points.push_back(point);
+		}
+	}
+
+	std::vector<Kpis> kpis(points.size());
+	memset(&kpis[0], 0, kpis.size()*sizeof(Kpis));
+	std::atomic<int> next(0);
+	std::vector<std::thread> threads;
+	if(!recording){
+		alpha_pkg::ColorTable colors;
+		if(!colors.load(colors_path, error)){
+			fprintf(stderr, "%s\n", error.c_str());
+			return 1;
+		}
+		std::vector<alpha_pkg::SimResult> results(points.size()*scenarios);
+		for(int w = 0; w < workers; w++){
+			threads.push_back(std::thread(simWorker, std::cref(config), std::cref(colors), std::cref(points),
+										  scenarios, std::ref(next), std::ref(results)));
+		}
+		for(size_t w = 0; w < threads.size(); w++){
+			threads[w].join();
+		}
+		for(size_t i = 0; i < results.size(); i++){
+			const alpha_pkg::SimResult& result = results[i];
+			Kpis& k = kpis[i/scenarios];
+			k.runs++;
+			k.success += alpha_pkg::simSucceeded(result, config);
+			k.declared += result.goal_declared;
+			k.time_to_goal += result.goal_declared ? result.time_to_goal : 0;
+			k.bumper_hits += result.bumper_hits;
+			k.distance += result.distance;
+		}
+	}
+	else{
+		std::vector<alpha_pkg::TimedInputs> inputs;
+		if(!alpha_pkg::sampleControlInputs(recording, config.min_z, config.color, goal_area, kControlRate, inputs, error)){
+			fprintf(stderr, "cannot read %s: %s\n", recording, error.c_str());
+			return 1;
+		}
+		Trace clean;
+		runController(config.controller, inputs, clean);
+		std::vector<ReplayRun> runs(points.size()*repeats);
+		for(int w = 0; w < workers; w++){
+			threads.push_back(std::thread(replayWorker, std::string(recording), config.min_z, config.color, goal_area,
+										  std::cref(config.controller), std::cref(clean), std::cref(points),
+										  repeats, std::ref(next), std::ref(runs)));
+		}
+		for(size_t w = 0; w < threads.size(); w++){
+			threads[w].join();
+		}
+		for(size_t i = 0; i < runs.size(); i++){
+			const ReplayRun& run = runs[i];
+			if(!run.ok){
+				continue;
+			}
+			Kpis& k = kpis[i/repeats];
+			k.runs++;
+			k.declared += run.time_to_goal >= 0;
+			k.time_to_goal += run.time_to_goal >= 0 ? run.time_to_goal : 0;
+			k.divergence += run.divergence;
+			k.command_changes += run.command_changes;
+		}
+	}
+	for(size_t p = 0; p < kpis.size(); p++){
+		Kpis& k = kpis[p];
+		k.time_to_goal = k.declared ? k.time_to_goal/k.declared : -1;
+		if(k.runs){
+			k.success /= k.runs;
+			k.declared /= k.runs;
+			k.bumper_hits /= k.runs;
+			k.distance /= k.runs;
+			k.divergence /= k.runs;
+			k.command_changes /= k.runs;
+		}
+	}
+
+	FILE* csv = csv_path ? fopen(csv_path, "w") : NULL;
+	if(csv_path && !csv){
+		fprintf(stderr, "cannot create %s\n", csv_path);
+		return 1;
+	}
+	if(csv){
+		fprintf(csv, "fault,level,runs,success,declared,time_to_goal,bumper_hits,distance,divergence,command_changes\n");
+	}
+
+	if(recording){
+		printf("open loop on %s, %d fault seeds per level\n", recording, repeats);
+	}
+	else{
+		printf("closed loop on %d scenarios per level\n", scenarios);
+	}
+	int last_fault = -2;
+	for(size_t p = 0; p < points.size(); p++){
+		const SweepPoint& point = points[p];
+		const Kpis& k = kpis[p];
+		const char* name = point.fault < 0 ? "none" : kFaults[point.fault].name;
+		if(csv){
+			fprintf(csv, "%s,%g,%d,%.4f,%.4f,%.2f,%.3f,%.3f,%.4f,%.1f\n", name, point.level, k.runs, k.success,
+					k.declared, k.time_to_goal, k.bumper_hits, k.distance, k.divergence, k.command_changes);
+		}
+		if(point.fault == -1){
+			continue;
+		}
+
+		// Each fault's table starts with the baseline row
+		const Kpis* rows[2] = {&kpis[0], &k};
+		float row_levels[2] = {0.0f, point.level};
+		for(int r = point.fault == last_fault; r < 2; r++){
+			const Kpis& row = *rows[r];
+			if(r == 0){
+				printf("\n%s\n", name);
+				if(recording){
+					printf("  %8s %10s %9s %9s %9s\n", "level", "diverged", "goal", "time [s]", "changes");
+				}
+				else{
+					printf("  %8s %8s %9s %9s %8s %8s\n", "level", "success", "declared", "time [s]", "bumps", "dist [m]");
+				}
+			}
+			if(recording){
+				printf("  %8g %9.1f%% %8.1f%% %9.1f %9.1f\n", row_levels[r], 100.0*row.divergence,
+					   100.0*row.declared, row.time_to_goal, row.command_changes);
+			}
+			else{
+				printf("  %8g %7.1f%% %8.1f%% %9.1f %8.2f %8.2f\n", row_levels[r], 100.0*row.success,
+					   100.0*row.declared, row.time_to_goal, row.bumper_hits, row.distance);
+			}
+		}
+		last_fault = point.fault;
+	}
+	if(csv){
+		fclose(csv);
+	}
+	return 0;
+}
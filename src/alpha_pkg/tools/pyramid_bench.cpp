@@ -0,0 +1,120 @@
+/************************************************************
+ * Name: pyramid_bench.cpp
+
+ * Description: Cost per frame of the coarse-to-fine color
+ 				search (Segmenter::segmentPyramid) against full
+ 				resolution segmentation. Renders RGB frames of
+ 				the first scenarios of the standard suite from
+ 				the start pose, turning in place so the target
+ 				is ahead, to the side or out of view, and runs
+ 				both on every frame. Prints the time and pixels
+ 				classified per frame and how often the target
+ 				estimate (area and weighted centroid, as fused
+ 				for blobsCallBack) differs between them.
+
+ * Usage: 		rosrun alpha_pkg pyramid_bench [-s scenarios]
+ 				    [-n frames] [-f colors.txt]
+ ************************************************************/
+
+#include <alpha_pkg/image_renderer.h>
+#include <alpha_pkg/segmentation.h>
+#include <chrono>
+#include <string>
+#include <vector>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+namespace {
+
+const size_t kMaxBlobs = 64;
+
+void usage(const char* program){
+	fprintf(stderr, "usage: %s [-s scenarios] [-n frames] [-f colors.txt]\n", program);
+}
+
+} // namespace
+
+int main(int argc, char** argv){
+	int scenarios = 20, frames = 64;
+	std::string colors_path = "colors.txt";
+
+	int opt;
+	while((opt = getopt(argc, argv, "s:n:f:h")) != -1){
+		switch(opt){
+			case 's': scenarios = atoi(optarg); break;
+			case 'n': frames = atoi(optarg); break;
+			case 'f': colors_path = optarg; break;
+			default: usage(argv[0]); return 1;
+		}
+	}
+	if(optind != argc || scenarios <= 0 || frames <= 0){
+		usage(argv[0]);
+		return 1;
+	}
+
+	alpha_pkg::ColorTable colors;
+	std::string error;
+	if(!colors.load(colors_path, error)){
+		fprintf(stderr, "%s\n", error.c_str());
+		return 1;
+	}
+
+	alpha_pkg::Segmenter segmenter(alpha_pkg::kImageWidth, alpha_pkg::kImageHeight, 10);
+	std::vector<uint8_t> rgb(3*alpha_pkg::kImageWidth*alpha_pkg::kImageHeight);
+	alpha_pkg::BlobObservation full_blobs[kMaxBlobs], pyramid_blobs[kMaxBlobs];
+	alpha_pkg::ScenarioParams params = alpha_pkg::defaultScenarioParams();
+	const size_t step = 3*alpha_pkg::kImageWidth;
+
+	double full_time = 0, pyramid_time = 0;
+	double full_pixels = 0, pyramid_pixels = 0;
+	int target_frames = 0, goal_frames = 0, area_differs = 0, goal_differs = 0;
+	double max_area_error = 0, max_centroid_error = 0;
+	for(int i = 0; i < scenarios; i++){
+		alpha_pkg::Scenario scenario = alpha_pkg::generateScenario(alpha_pkg::standardSuiteSeed(i), params);
+		const uint8_t* target_rgb = alpha_pkg::kTargetColors[alpha_pkg::lightingInfo(scenario.lighting).target_class];
+		alpha_pkg::ImageRenderer renderer(alpha_pkg::defaultCameraModel(), scenario.seed);
+		renderer.setScene(scenario);
+		float facing = atan2f(scenario.start_x - scenario.target.x, scenario.target.y - scenario.start_y);
+
+		for(int f = 0; f < frames; f++){
+			renderer.setPose(scenario.start_x, scenario.start_y, facing + 2*M_PI*f/frames);
+			renderer.render(&rgb[0], step);
+
+			std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+			size_t full_count = segmenter.segment(&rgb[0], step, colors, full_blobs, kMaxBlobs);
+			std::chrono::steady_clock::time_point middle = std::chrono::steady_clock::now();
+			full_pixels += segmenter.stats().pixels;
+			size_t pyramid_count = segmenter.segmentPyramid(&rgb[0], step, colors, pyramid_blobs, NULL, kMaxBlobs);
+			std::chrono::steady_clock::time_point end = std::chrono::steady_clock::now();
+			pyramid_pixels += segmenter.stats().pixels;
+			full_time += std::chrono::duration<double>(middle - start).count();
+			pyramid_time += std::chrono::duration<double>(end - middle).count();
+
+			alpha_pkg::GoalEstimate full, pyramid;
+			alpha_pkg::fuseBlobs(full_blobs, full_count, target_rgb, full, 0);
+			alpha_pkg::fuseBlobs(pyramid_blobs, pyramid_count, target_rgb, pyramid, 0);
+			target_frames += full.found;
+			goal_frames += full.area > alpha_pkg::kGoalAreaThreshold;
+			goal_differs += (full.area > alpha_pkg::kGoalAreaThreshold) != (pyramid.area > alpha_pkg::kGoalAreaThreshold);
+			if(full.area != pyramid.area){
+				area_differs++;
+				max_area_error = std::max(max_area_error, fabs(1.0 - static_cast<double>(pyramid.area)/full.area));
+			}
+			if(full.found && pyramid.found){
+				max_centroid_error = std::max(max_centroid_error, static_cast<double>(hypotf(full.x - pyramid.x, full.y - pyramid.y)));
+			}
+		}
+	}
+
+	double total = static_cast<double>(scenarios)*frames;
+	printf("%d scenarios x %d frames, target in %d frames, goal in %d\n", scenarios, frames, target_frames, goal_frames);
+	printf("  %-8s %10s %12s\n", "search", "us/frame", "px/frame");
+	printf("  %-8s %10.0f %12.0f\n", "full", 1e6*full_time/total, full_pixels/total);
+	printf("  %-8s %10.0f %12.0f\n", "pyramid", 1e6*pyramid_time/total, pyramid_pixels/total);
+	printf("  speedup %.2fx\n", full_time/pyramid_time);
+	printf("  target area differs in %d frames (max %.2f%%), goal decision in %d, max centroid shift %.2f px\n",
+		   area_differs, 100*max_area_error, goal_differs, max_centroid_error);
+	return 0;
+}
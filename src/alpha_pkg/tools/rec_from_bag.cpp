@@ -0,0 +1,122 @@
+/************************************************************
+ * Name: rec_from_bag.cpp
+
+ * Description: Converts a rosbag of a run into the native
+ 				recording format (see recording.h). Depth
+ 				clouds are reduced to the obstacle band, blobs
+ 				and bumper events are copied. Chunks are stamped
+ 				with the bag receive time, which is also the
+ 				order they are replayed in.
+
+ * Usage: 		rosrun alpha_pkg rec_from_bag <in.bag> <out.arec>
+ 				    [depth topic] [blobs topic] [bumper topic]
+ ************************************************************/
+
+#include <alpha_pkg/recording.h>
+#include <cmvision/Blobs.h>
+#include <kobuki_msgs/BumperEvent.h>
+#include <pcl/point_types.h>
+#include <pcl_conversions/pcl_conversions.h>
+#include <rosbag/bag.h>
+#include <rosbag/view.h>
+#include <sensor_msgs/PointCloud2.h>
+#include <stdio.h>
+#include <vector>
+
+int main(int argc, char** argv){
+	if(argc < 3){
+		fprintf(stderr, "usage: %s <in.bag> <out.arec> [depth topic] [blobs topic] [bumper topic]\n", argv[0]);
+		return 1;
+	}
+	std::string depth_topic = argc > 3 ? argv[3] : "/camera/depth/points";
+	std::string blobs_topic = argc > 4 ? argv[4] : "/blobs";
+	std::string bumper_topic = argc > 5 ? argv[5] : "/mobile_base/events/bumper";
+
+	rosbag::Bag bag;
+	try{
+		bag.open(argv[1], rosbag::bagmode::Read);
+	}
+	catch(const rosbag::BagException& e){
+		fprintf(stderr, "cannot open %s: %s\n", argv[1], e.what());
+		return 1;
+	}
+
+	alpha_pkg::RecordingWriter writer;
+	if(!writer.open(argv[2])){
+		fprintf(stderr, "cannot create %s\n", argv[2]);
+		return 1;
+	}
+
+	std::vector<std::string> topics;
+	topics.push_back(depth_topic);
+	topics.push_back(blobs_topic);
+	topics.push_back(bumper_topic);
+	rosbag::View view(bag, rosbag::TopicQuery(topics));
+
+	pcl::PointCloud<pcl::PointXYZ> cloud;
+	std::vector<alpha_pkg::BlobObservation> blobs;
+	size_t depth_frames = 0, skipped_frames = 0, blob_messages = 0, bumper_events = 0;
+	bool ok = true;
+
+	for(rosbag::View::iterator it = view.begin(); ok && it != view.end(); ++it){
+		double stamp = it->getTime().toSec();
+
+		sensor_msgs::PointCloud2::ConstPtr depth = it->instantiate<sensor_msgs::PointCloud2>();
+		if(depth){
+			pcl::fromROSMsg(*depth, cloud);
+			if(cloud.width != alpha_pkg::kImageWidth || cloud.height != alpha_pkg::kImageHeight){
+				skipped_frames++;
+				continue;
+			}
+			alpha_pkg::DepthView depth_view;
+			depth_view.z = &cloud.points[0].z;
+			depth_view.stride = sizeof(pcl::PointXYZ)/sizeof(float);
+			depth_view.width = cloud.width;
+			depth_view.height = cloud.height;
+			depth_view.first_row = 0;
+			ok = writer.writeDepth(stamp, depth_view);
+			depth_frames++;
+			continue;
+		}
+
+		cmvision::Blobs::ConstPtr blobs_msg = it->instantiate<cmvision::Blobs>();
+		if(blobs_msg){
+			blobs.resize(blobs_msg->blobs.size());
+			for(size_t i = 0; i < blobs.size(); i++){
+				const cmvision::Blob& in = blobs_msg->blobs[i];
+				blobs[i].red = in.red;
+				blobs[i].green = in.green;
+				blobs[i].blue = in.blue;
+				blobs[i].reserved = 0;
+				blobs[i].area = in.area;
+				blobs[i].x = in.x;
+				blobs[i].y = in.y;
+			}
+			ok = writer.writeBlobs(stamp, blobs.empty() ? NULL : &blobs[0], blobs.size());
+			blob_messages++;
+			continue;
+		}
+
+		kobuki_msgs::BumperEvent::ConstPtr bumper = it->instantiate<kobuki_msgs::BumperEvent>();
+		if(bumper){
+			ok = writer.writeBumper(stamp, bumper->bumper, bumper->state);
+			bumper_events++;
+		}
+	}
+	bag.close();
+
+	uint64_t raw = writer.rawDepthBytes(), encoded = writer.encodedDepthBytes();
+	ok = writer.close() && ok;
+	if(!ok){
+		fprintf(stderr, "write to %s failed\n", argv[2]);
+		return 1;
+	}
+
+	printf("%zu depth frames (%zu skipped, not 640x480), %zu blob messages, %zu bumper events\n",
+		   depth_frames, skipped_frames, blob_messages, bumper_events);
+	if(encoded > 0){
+		printf("depth band: %.1f MB raw uint16, %.1f MB coded (%.1fx)\n",
+			   raw/1e6, encoded/1e6, static_cast<double>(raw)/encoded);
+	}
+	return 0;
+}
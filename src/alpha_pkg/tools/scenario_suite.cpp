@@ -0,0 +1,97 @@
+/************************************************************
+ * Name: scenario_suite.cpp
+
+ * Description: Lists and summarizes procedurally generated
+ 				scenarios. Without arguments it generates the
+ 				standard suite and prints its distribution
+ 				(lighting, target class, room size, clutter,
+ 				occluders) and a suite digest. The digest
+ 				changes if any scenario changes, so a build
+ 				that prints the same digest reproduces the
+ 				suite exactly.
+
+ * Usage: 		rosrun alpha_pkg scenario_suite [-n count]
+ 				    [-s seed] [-d]
+ 				-n  number of suite scenarios (default: all)
+ 				-s  describe the scenario of this seed only
+ 				-d  dump every scenario of the suite
+ ************************************************************/
+
+#include <alpha_pkg/perception.h>
+#include <alpha_pkg/scenario.h>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+namespace {
+
+void usage(const char* program){
+	fprintf(stderr, "usage: %s [-n count] [-s seed] [-d]\n", program);
+}
+
+} // namespace
+
+int main(int argc, char** argv){
+	int count = alpha_pkg::kStandardSuiteSize;
+	bool single = false, dump = false;
+	uint64_t seed = 0;
+
+	int opt;
+	while((opt = getopt(argc, argv, "n:s:dh")) != -1){
+		switch(opt){
+			case 'n': count = atoi(optarg); break;
+			case 's': single = true; seed = strtoull(optarg, NULL, 0); break;
+			case 'd': dump = true; break;
+			default: usage(argv[0]); return 1;
+		}
+	}
+	if(optind != argc || count <= 0){
+		usage(argv[0]);
+		return 1;
+	}
+
+	alpha_pkg::ScenarioParams params = alpha_pkg::defaultScenarioParams();
+	if(single){
+		alpha_pkg::writeScenario(stdout, alpha_pkg::generateScenario(seed, params));
+		return 0;
+	}
+
+	int per_lighting[alpha_pkg::NUM_LIGHTING_PROFILES] = {0};
+	int per_class[2] = {0, 0};
+	int per_occluders[8] = {0};
+	double area = 0, obstacles = 0, target_distance = 0;
+	uint64_t digest = 0;
+	for(int i = 0; i < count; i++){
+		alpha_pkg::Scenario scenario = alpha_pkg::generateScenario(alpha_pkg::standardSuiteSeed(i), params);
+		if(dump){
+			alpha_pkg::writeScenario(stdout, scenario);
+		}
+		per_lighting[scenario.lighting]++;
+		per_class[alpha_pkg::lightingInfo(scenario.lighting).target_class]++;
+		per_occluders[scenario.num_occluders < 7 ? scenario.num_occluders : 7]++;
+		area += scenario.width*scenario.depth;
+		obstacles += scenario.boxes.size() - scenario.num_walls + scenario.cylinders.size();
+		float dx = scenario.target.x - scenario.start_x, dy = scenario.target.y - scenario.start_y;
+		target_distance += sqrt(dx*dx + dy*dy);
+		digest = digest*1099511628211ull ^ alpha_pkg::scenarioDigest(scenario);
+	}
+
+	printf("%d scenarios, base seed %016llx\n", count, (unsigned long long)alpha_pkg::kStandardSuiteBaseSeed);
+	printf("  mean room area        %8.2f m^2\n", area/count);
+	printf("  mean obstacles        %8.2f\n", obstacles/count);
+	printf("  mean target distance  %8.2f m\n", target_distance/count);
+	printf("  lighting:\n");
+	for(int i = 0; i < alpha_pkg::NUM_LIGHTING_PROFILES; i++){
+		printf("    %-18s %6d\n", alpha_pkg::lightingInfo(static_cast<alpha_pkg::LightingProfile>(i)).name, per_lighting[i]);
+	}
+	printf("  target class: Pink %d, PinkOut %d\n", per_class[alpha_pkg::TARGET_PINK], per_class[alpha_pkg::TARGET_PINK_OUT]);
+	printf("  occluders:");
+	for(int i = 0; i < 8; i++){
+		if(per_occluders[i]){
+			printf(" %d:%d", i, per_occluders[i]);
+		}
+	}
+	printf("\n  digest %016llx\n", (unsigned long long)digest);
+	return 0;
+}
@@ -0,0 +1,446 @@
+/************************************************************
+ * Name: sensor_load.cpp
+
+ * Description: Saturation stress test of the node's sensor
+ 				inputs. Publishes synthetic 640x480 clouds on
+ 				/camera/depth/points and/or blob lists on /blobs
+ 				to a running alpha_pkg_node through a local
+ 				roscore, stepping the rate up for each load
+ 				configuration. Before and after every step the
+ 				node's metrics endpoint is scraped, which gives
+ 				per step:
+ 				- the processing rate (alpha_frames_processed_total),
+ 				- queue drops, from header sequence gaps
+ 				  (alpha_frames_dropped_total),
+ 				- message age, header stamp to callback entry
+ 				  (alpha_message_age_seconds, mean and p95),
+ 				- CPU per frame (process_cpu_seconds_total over
+ 				  the frames processed),
+ 				- callback time and the processing capacity it
+ 				  allows, 1 / mean callback time
+ 				  (alpha_callback_latency_seconds).
+ 				A rate is sustainable when the node processes at
+ 				least 95% of what was published with a p95 age
+ 				under the limit; the highest such rate is
+ 				reported per configuration.
+
+ 				The node only runs callbacks from spinOnce() in
+ 				its 10 Hz loop and takes depth with a queue of
+ 				one, so depth above the loop rate shows drops and
+ 				reads saturated whatever its cost: the
+ 				sustainable depth rate is the loop rate. The
+ 				capacity column is the processing limit.
+
+ 				The depth kernel only accepts 640x480 organized
+ 				clouds, so configurations vary the streams and
+ 				the blobs per message rather than the cloud
+ 				resolution.
+
+ * Usage: 		roscore
+ 				rosrun alpha_pkg alpha_pkg_node
+ 				rosrun alpha_pkg sensor_load [-r 5,10,20,...]
+ 				    [-d seconds] [-A age_limit] [-p metrics_port]
+ 				    [-k config]
+ ************************************************************/
+
+#include <alpha_pkg/perception.h>
+#include <cmvision/Blobs.h>
+#include <pcl/point_types.h>
+#include <pcl_conversions/pcl_conversions.h>
+#include <pcl_ros/point_cloud.h>
+#include <ros/ros.h>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <string>
+#include <sys/socket.h>
+#include <unistd.h>
+#include <utility>
+#include <vector>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+namespace {
+
+typedef pcl::PointCloud<pcl::PointXYZ> PointCloud;
+typedef std::vector<std::pair<std::string, double> > Samples;
+
+const double kSustainedFraction = 0.95;
+const int kMaxFailedSteps = 2;
+
+struct LoadConfig {
+	const char* name;
+	bool depth;
+	int blobs;				// blobs per /blobs message, 0: none published
+};
+
+const LoadConfig kConfigs[] = {
+	{"depth", true, 0},
+	{"blobs_1", false, 1},
+	{"blobs_64", false, 64},
+	{"depth+blobs_16", true, 16}};
+const int kNumConfigs = sizeof(kConfigs)/sizeof(kConfigs[0]);
+
+/************************************************************
+ * Function Name: scrapeMetrics
+
+ * Description: GET /metrics from the node and keep the samples
+ 				as ("name{labels}", value) in exposition order
+*************************************************************/
+
+bool scrapeMetrics(int port, Samples& samples){
+	int fd = socket(AF_INET, SOCK_STREAM, 0);
+	if(fd < 0){
+		return false;
+	}
+	sockaddr_in addr;
+	memset(&addr, 0, sizeof(addr));
+	addr.sin_family = AF_INET;
+	addr.sin_port = htons(port);
+	addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+	const char request[] = "GET /metrics HTTP/1.0\r\n\r\n";
+	if(connect(fd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) != 0 ||
+	   write(fd, request, sizeof(request) - 1) != static_cast<ssize_t>(sizeof(request) - 1)){
+		close(fd);
+		return false;
+	}
+	std::string response;
+	char buffer[4096];
+	ssize_t n;
+	while((n = read(fd, buffer, sizeof(buffer))) > 0){
+		response.append(buffer, n);
+	}
+	close(fd);
+
+	size_t body = response.find("\r\n\r\n");
+	if(response.compare(0, 12, "HTTP/1.0 200") != 0 || body == std::string::npos){
+		return false;
+	}
+	samples.clear();
+	size_t line = body + 4;
+	while(line < response.size()){
+		size_t end = response.find('\n', line);
+		if(end == std::string::npos){
+			end = response.size();
+		}
+		size_t space = response.rfind(' ', end);
+		if(response[line] != '#' && space != std::string::npos && space > line){
+			samples.push_back(std::make_pair(response.substr(line, space - line),
+											 atof(response.c_str() + space + 1)));
+		}
+		line = end + 1;
+	}
+	return true;
+}
+
+double sample(const Samples& samples, const std::string& key){
+	for(size_t i = 0; i < samples.size(); i++){
+		if(samples[i].first == key){
+			return samples[i].second;
+		}
+	}
+	return 0;
+}
+
+double delta(const Samples& before, const Samples& after, const std::string& key){
+	return sample(after, key) - sample(before, key);
+}
+
+/************************************************************
+ * Function Name: deltaPercentile
+
+ * Description: Percentile of the observations a histogram made
+ 				between two scrapes, as the upper bound of the
+ 				bucket it falls in (+inf past the last bound)
+*************************************************************/
+
+double deltaPercentile(const Samples& before, const Samples& after, const std::string& name,
+					   const std::string& labels, double fraction){
+	std::string prefix = name + "_bucket{" + labels + ",le=\"";
+	double total = delta(before, after, name + "_count{" + labels + "}");
+	if(total <= 0){
+		return 0;
+	}
+	for(size_t i = 0; i < after.size(); i++){
+		const std::string& key = after[i].first;
+		if(key.compare(0, prefix.size(), prefix) != 0){
+			continue;
+		}
+		if(after[i].second - sample(before, key) >= fraction*total){
+			std::string le = key.substr(prefix.size());
+			return le.compare(0, 4, "+Inf") == 0 ? INFINITY : atof(le.c_str());
+		}
+	}
+	return INFINITY;
+}
+
+struct StreamStep {
+	double published;		// messages
+	double processed;		// messages
+	double dropped;			// messages
+	double age_mean;		// s
+	double age_p95;			// s
+	double callbacks;		// callbacks timed
+	double callback_time;	// s, summed over them
+};
+
+struct Step {
+	double rate;			// Hz requested
+	double achieved;		// Hz actually published
+	StreamStep streams[2];	// depth, blobs
+	double cpu_per_frame;	// s
+	bool sustainable;
+};
+
+StreamStep streamStep(const Samples& before, const Samples& after, const char* stream, double published){
+	std::string labels = std::string("stream=\"") + stream + "\"";
+	StreamStep step;
+	step.published = published;
+	step.processed = delta(before, after, "alpha_frames_processed_total{" + labels + "}");
+	step.dropped = delta(before, after, "alpha_frames_dropped_total{" + labels + "}");
+	double count = delta(before, after, "alpha_message_age_seconds_count{" + labels + "}");
+	step.age_mean = count > 0 ? delta(before, after, "alpha_message_age_seconds_sum{" + labels + "}")/count : 0;
+	step.age_p95 = deltaPercentile(before, after, "alpha_message_age_seconds", labels, 0.95);
+	std::string callback = std::string("{callback=\"") + stream + "\"}";
+	step.callbacks = delta(before, after, "alpha_callback_latency_seconds_count" + callback);
+	step.callback_time = delta(before, after, "alpha_callback_latency_seconds_sum" + callback);
+	return step;
+}
+
+// Band half at 2.5 m, a 160x120 patch at 0.5 m so the close-point
+// path of the kernel runs as well
+void fillCloud(PointCloud& cloud){
+	cloud.width = alpha_pkg::kImageWidth;
+	cloud.height = alpha_pkg::kImageHeight;
+	cloud.is_dense = false;
+	cloud.points.resize(cloud.width*cloud.height);
+	cloud.header.frame_id = "camera_depth_optical_frame";
+	for(int row = 0; row < alpha_pkg::kImageHeight; row++){
+		for(int col = 0; col < alpha_pkg::kImageWidth; col++){
+			pcl::PointXYZ& point = cloud.points[row*alpha_pkg::kImageWidth + col];
+			bool close = row >= 240 && row < 360 && col >= 240 && col < 400;
+			point.z = close ? 0.5f : 2.5f;
+			point.x = (col - 319.5f)*point.z/525.0f;
+			point.y = (row - 239.5f)*point.z/525.0f;
+		}
+	}
+}
+
+// `count` target blobs summing to more than the goal area
+void fillBlobs(cmvision::Blobs& message, int count){
+	message.image_width = alpha_pkg::kImageWidth;
+	message.image_height = alpha_pkg::kImageHeight;
+	message.blob_count = count;
+	message.blobs.resize(count);
+	for(int i = 0; i < count; i++){
+		cmvision::Blob& blob = message.blobs[i];
+		blob.name = "PinkOut";
+		blob.red = alpha_pkg::kTargetColors[alpha_pkg::TARGET_PINK_OUT][0];
+		blob.green = alpha_pkg::kTargetColors[alpha_pkg::TARGET_PINK_OUT][1];
+		blob.blue = alpha_pkg::kTargetColors[alpha_pkg::TARGET_PINK_OUT][2];
+		blob.area = 4000/count + 1;
+		blob.x = 300 + i % 40;
+		blob.y = 240;
+		blob.left = blob.x - 10;
+		blob.right = blob.x + 10;
+		blob.top = blob.y - 10;
+		blob.bottom = blob.y + 10;
+	}
+}
+
+bool parseRates(const char* text, std::vector<double>& rates){
+	rates.clear();
+	const char* p = text;
+	while(*p){
+		char* end;
+		double rate = strtod(p, &end);
+		if(end == p || rate <= 0 || (*end && *end != ',')){
+			return false;
+		}
+		rates.push_back(rate);
+		p = *end ? end + 1 : end;
+	}
+	return !rates.empty();
+}
+
+void usage(const char* program){
+	fprintf(stderr, "usage: %s [-r 5,10,20,...] [-d seconds] [-A age_limit] [-p metrics_port] [-k config]\nconfigs:", program);
+	for(int c = 0; c < kNumConfigs; c++){
+		fprintf(stderr, " %s", kConfigs[c].name);
+	}
+	fprintf(stderr, "\n");
+}
+
+} // namespace
+
+int main(int argc, char** argv){
+	ros::init(argc, argv, "sensor_load", ros::init_options::AnonymousName);
+
+	std::vector<double> rates;
+	parseRates("5,10,15,20,30,45,60,90,120", rates);
+	double duration = 5.0;
+	double age_limit = 0.25;
+	int port = 9105;
+	int only_config = -1;
+
+	int opt;
+	while((opt = getopt(argc, argv, "r:d:A:p:k:h")) != -1){
+		switch(opt){
+			case 'r':
+				if(!parseRates(optarg, rates)){
+					fprintf(stderr, "cannot parse rates '%s'\n", optarg);
+					return 1;
+				}
+				break;
+			case 'd': duration = atof(optarg); break;
+			case 'A': age_limit = atof(optarg); break;
+			case 'p': port = atoi(optarg); break;
+			case 'k':
+				only_config = 0;
+				while(only_config < kNumConfigs && strcmp(kConfigs[only_config].name, optarg) != 0){
+					only_config++;
+				}
+				if(only_config == kNumConfigs){
+					usage(argv[0]);
+					return 1;
+				}
+				break;
+			default: usage(argv[0]); return 1;
+		}
+	}
+	if(optind != argc || duration <= 0){
+		usage(argv[0]);
+		return 1;
+	}
+
+	Samples before, after;
+	if(!scrapeMetrics(port, before)){
+		fprintf(stderr, "cannot scrape http://127.0.0.1:%d/metrics, is alpha_pkg_node running?\n", port);
+		return 1;
+	}
+
+	ros::NodeHandle nh;
+	ros::Publisher depth_publisher = nh.advertise<PointCloud>("/camera/depth/points", 1);
+	ros::Publisher blobs_publisher = nh.advertise<cmvision::Blobs>("/blobs", 50);
+	ros::WallDuration(1.0).sleep();
+	if(depth_publisher.getNumSubscribers() == 0 || blobs_publisher.getNumSubscribers() == 0){
+		fprintf(stderr, "warning: the node has not subscribed to both topics yet\n");
+	}
+
+	PointCloud::Ptr cloud(new PointCloud);
+	fillCloud(*cloud);
+	cmvision::Blobs blobs;
+	uint32_t depth_seq = 0, blobs_seq = 0;
+
+	for(int c = 0; c < kNumConfigs && ros::ok(); c++){
+		if(only_config >= 0 && c != only_config){
+			continue;
+		}
+		const LoadConfig& config = kConfigs[c];
+		if(config.blobs > 0){
+			fillBlobs(blobs, config.blobs);
+		}
+		printf("\n%s\n  %7s %8s %10s %8s %9s %9s %9s %9s %9s %10s\n", config.name, "rate", "sent",
+			   "processed", "dropped", "age mean", "age p95", "callback", "capacity", "stream", "cpu/frame");
+		double best = 0;
+		const char* names[2] = {"depth", "blobs"};
+		double callbacks[2] = {0, 0}, callback_time[2] = {0, 0};
+		int failed = 0;
+		for(size_t r = 0; r < rates.size() && failed < kMaxFailedSteps && ros::ok(); r++){
+			// Let the previous step drain before the baseline scrape
+			ros::WallDuration(0.5).sleep();
+			if(!scrapeMetrics(port, before)){
+				fprintf(stderr, "lost the metrics endpoint\n");
+				return 1;
+			}
+
+			Step step;
+			step.rate = rates[r];
+			int published = 0;
+			ros::WallRate rate(rates[r]);
+			ros::WallTime start = ros::WallTime::now();
+			while((ros::WallTime::now() - start).toSec() < duration && ros::ok()){
+				ros::Time now = ros::Time::now();
+				if(config.depth){
+					cloud->header.seq = depth_seq++;
+					pcl_conversions::toPCL(now, cloud->header.stamp);
+					depth_publisher.publish(cloud);
+				}
+				if(config.blobs > 0){
+					blobs.header.seq = blobs_seq++;
+					blobs.header.stamp = now;
+					blobs_publisher.publish(blobs);
+				}
+				published++;
+				rate.sleep();
+			}
+			double elapsed = (ros::WallTime::now() - start).toSec();
+			step.achieved = published/elapsed;
+
+			// Give the node one control period to take the tail
+			ros::WallDuration(0.2).sleep();
+			if(!scrapeMetrics(port, after)){
+				fprintf(stderr, "lost the metrics endpoint\n");
+				return 1;
+			}
+			step.streams[0] = streamStep(before, after, "depth", config.depth ? published : 0);
+			step.streams[1] = streamStep(before, after, "blobs", config.blobs > 0 ? published : 0);
+			double frames = step.streams[0].processed + step.streams[1].processed;
+			step.cpu_per_frame = frames > 0 ? delta(before, after, "process_cpu_seconds_total")/frames : 0;
+
+			step.sustainable = true;
+			for(int s = 0; s < 2; s++){
+				const StreamStep& stream = step.streams[s];
+				if(stream.published > 0 && (stream.processed < kSustainedFraction*stream.published ||
+											stream.age_p95 > age_limit)){
+					step.sustainable = false;
+				}
+			}
+			if(step.sustainable){
+				best = step.achieved;
+				failed = 0;
+			}
+			else{
+				failed++;
+			}
+
+			bool first = true;
+			for(int s = 0; s < 2; s++){
+				const StreamStep& stream = step.streams[s];
+				if(stream.published == 0){
+					continue;
+				}
+				callbacks[s] += stream.callbacks;
+				callback_time[s] += stream.callback_time;
+				double mean = stream.callbacks > 0 ? stream.callback_time/stream.callbacks : 0;
+				if(first){
+					printf("  %7.1f", step.achieved);
+				}
+				else{
+					printf("  %7s", "");
+				}
+				printf(" %8.0f %10.0f %8.0f %7.1fms %7.1fms %7.2fms %7.0fHz %9s", stream.published, stream.processed,
+					   stream.dropped, 1000.0*stream.age_mean, 1000.0*stream.age_p95, 1000.0*mean,
+					   mean > 0 ? 1.0/mean : 0.0, names[s]);
+				if(first){
+					printf(" %8.2fms  %s", 1000.0*step.cpu_per_frame, step.sustainable ? "ok" : "saturated");
+				}
+				printf("\n");
+				first = false;
+			}
+		}
+		printf("  sustainable maximum: %.1f Hz", best);
+		if(config.depth){
+			printf(" (depth is capped by the node's 10 Hz loop)");
+		}
+		printf("\n");
+		for(int s = 0; s < 2; s++){
+			if(callbacks[s] > 0 && callback_time[s] > 0){
+				printf("  %s processing capacity: %.0f Hz (%.2f ms per callback)\n", names[s],
+					   callbacks[s]/callback_time[s], 1000.0*callback_time[s]/callbacks[s]);
+			}
+		}
+	}
+	return 0;
+}
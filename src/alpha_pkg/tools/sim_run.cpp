@@ -0,0 +1,314 @@
+/************************************************************
+ * Name: sim_run.cpp
+
+ * Description: Runs the follower headless on scenarios of the
+ 				standard suite (see scenario.h): rendering,
+ 				colors.txt segmentation, the perception kernels,
+ 				the controller and a unicycle base in closed
+ 				loop. Scenarios are spread over worker threads;
+ 				the result of every scenario can be written to a
+ 				CSV file and the KPIs are summarized per
+ 				lighting profile.
+
+ 				A scenario counts as a success when the
+ 				controller declares the goal (state 3) with the
+ 				robot's edge closer to the target than the
+ 				min_z stop distance.
+
+ * Usage: 		rosrun alpha_pkg sim_run [-n scenarios] [-j workers]
+ 				    [-f colors.txt] [-a controller.yaml]
+ 				    [-c color_index] [-t time_limit] [-o out.csv]
+ 				    [-F faults.yaml] [-R full_scan_period] [-P]
+ 				    [-T contact_time] [-M wait_time] [-D dump_dir]
+ 				See fault_injection.h for the faults file. -R
+ 				segments a window around the tracked goal with
+ 				a full scan every full_scan_period frames (see
+ 				target_tracker.h), -P searches the frames that
+ 				are not windowed coarse to fine; both report the
+ 				pixels classified per frame and the goal recall
+ 				against a full scan of the same frames. -T sets
+ 				the controller's contact_time (see controller.h)
+ 				and reports how often it capped the speed. -M
+ 				flags moving obstacles (see motion_detector.h)
+ 				and sets the controller's wait_time; the
+ 				standard scenes are static, so every flag is a
+ 				false positive. -D writes two frames of every
+ 				scenario lit for the -c color into dump_dir,
+ 				from the start pose as generated and turned to
+ 				the target, as PPM images plus the labels.txt
+ 				color_calibrate reads: the box of the visible
+ 				target pixels, or none.
+ ************************************************************/
+
+#include <alpha_pkg/image_io.h>
+#include <alpha_pkg/simulator.h>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <functional>
+#include <string>
+#include <thread>
+#include <vector>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+namespace {
+
+struct Summary {
+	int runs;
+	int declared;
+	int successes;
+	double time_to_goal;		// sum over successes
+	int bumper_hits;
+	double distance;
+
+	Summary() : runs(0), declared(0), successes(0), time_to_goal(0), bumper_hits(0), distance(0) {}
+};
+
+void worker(const alpha_pkg::SimConfig& config, const alpha_pkg::ColorTable& colors,
+			std::atomic<int>& next, int count, std::vector<alpha_pkg::SimResult>& results){
+	alpha_pkg::Simulator simulator(config, colors);
+	alpha_pkg::ScenarioParams params = alpha_pkg::defaultScenarioParams();
+	for(int i = next++; i < count; i = next++){
+		alpha_pkg::Scenario scenario = alpha_pkg::generateScenario(alpha_pkg::standardSuiteSeed(i), params);
+		results[i] = simulator.run(scenario);
+	}
+}
+
+/************************************************************
+ * Function Name: dumpFrames
+
+ * Description: Writes the color_calibrate input of the first
+ 				`count` scenarios: the frames of the ones whose
+ 				lighting shows the `color` target and a labels
+ 				file with the box of the target pixels of each
+ 				frame
+*************************************************************/
+
+bool dumpFrames(const std::string& dir, const alpha_pkg::SimConfig& config, int count, std::string& error){
+	std::string labels_path = dir + "/labels.txt";
+	FILE* labels = fopen(labels_path.c_str(), "w");
+	if(!labels){
+		error = "cannot create " + labels_path;
+		return false;
+	}
+	alpha_pkg::ImageRenderer renderer(alpha_pkg::defaultCameraModel(), config.depth_noise.seed);
+	alpha_pkg::DepthRenderer geometry(alpha_pkg::defaultCameraModel(), config.depth_noise);
+	std::vector<uint8_t> rgb(3*alpha_pkg::kImageWidth*alpha_pkg::kImageHeight);
+	std::vector<uint8_t> surfaces(alpha_pkg::kImageWidth*alpha_pkg::kImageHeight);
+	alpha_pkg::ScenarioParams params = alpha_pkg::defaultScenarioParams();
+	bool ok = true;
+	for(int i = 0; i < count && ok; i++){
+		alpha_pkg::Scenario scenario = alpha_pkg::generateScenario(alpha_pkg::standardSuiteSeed(i), params);
+		if(alpha_pkg::lightingInfo(scenario.lighting).target_class != config.color){
+			continue;
+		}
+		renderer.setScene(scenario);
+		geometry.setScene(scenario);
+		// The target comes after the boxes in the surface labels
+		uint8_t target = alpha_pkg::DepthRenderer::kSurfaceObstacle + scenario.boxes.size();
+		float headings[2] = {scenario.start_heading,
+							 atan2f(scenario.start_x - scenario.target.x, scenario.target.y - scenario.start_y)};
+		for(int k = 0; k < 2 && ok; k++){
+			renderer.setPose(scenario.start_x, scenario.start_y, headings[k]);
+			renderer.render(&rgb[0], 3*alpha_pkg::kImageWidth);
+			geometry.setPose(scenario.start_x, scenario.start_y, headings[k]);
+			geometry.renderSurfaces(&surfaces[0], 0, alpha_pkg::kImageHeight);
+
+			char name[32];
+			snprintf(name, sizeof(name), "%04d_%d.ppm", i, k);
+			ok = alpha_pkg::writePpm(dir + "/" + name, &rgb[0], alpha_pkg::kImageWidth, alpha_pkg::kImageHeight,
+									 3*alpha_pkg::kImageWidth, error);
+
+			alpha_pkg::ImageWindow box = {alpha_pkg::kImageWidth, alpha_pkg::kImageHeight, 0, 0};
+			for(int row = 0; row < alpha_pkg::kImageHeight; row++){
+				for(int col = 0; col < alpha_pkg::kImageWidth; col++){
+					if(surfaces[row*alpha_pkg::kImageWidth + col] == target){
+						box.x0 = std::min(box.x0, col);
+						box.y0 = std::min(box.y0, row);
+						box.x1 = std::max(box.x1, col + 1);
+						box.y1 = std::max(box.y1, row + 1);
+					}
+				}
+			}
+			if(box.x1 > box.x0){
+				fprintf(labels, "%s %d %d %d %d\n", name, box.x0, box.y0, box.x1, box.y1);
+			}
+			else{
+				fprintf(labels, "%s\n", name);
+			}
+		}
+	}
+	fclose(labels);
+	return ok;
+}
+
+void printSummary(const char* name, const Summary& summary){
+	if(summary.runs == 0){
+		return;
+	}
+	printf("  %-18s %5d %7.1f%% %7.1f%% %9.1f %8.2f %8.2f\n", name, summary.runs,
+		   100.0*summary.successes/summary.runs, 100.0*summary.declared/summary.runs,
+		   summary.successes ? summary.time_to_goal/summary.successes : 0.0,
+		   static_cast<double>(summary.bumper_hits)/summary.runs, summary.distance/summary.runs);
+}
+
+void usage(const char* program){
+	fprintf(stderr, "usage: %s [-n scenarios] [-j workers] [-f colors.txt] [-a controller.yaml] "
+			"[-c color_index] [-t time_limit] [-o out.csv] [-F faults.yaml] [-R full_scan_period] [-P] "
+			"[-T contact_time] [-M wait_time] [-D dump_dir]\n", program);
+}
+
+} // namespace
+
+int main(int argc, char** argv){
+	int count = 200;
+	int workers = std::thread::hardware_concurrency();
+	std::string colors_path = "colors.txt";
+	const char* csv_path = NULL;
+	const char* dump_dir = NULL;
+	alpha_pkg::SimConfig config = alpha_pkg::defaultSimConfig();
+	std::string error;
+
+	int opt;
+	while((opt = getopt(argc, argv, "n:j:f:a:c:t:o:F:R:PT:M:D:h")) != -1){
+		switch(opt){
+			case 'n': count = atoi(optarg); break;
+			case 'j': workers = atoi(optarg); break;
+			case 'f': colors_path = optarg; break;
+			case 'a':
+				if(!alpha_pkg::loadControllerConfig(optarg, config.controller, error)){
+					fprintf(stderr, "%s\n", error.c_str());
+					return 1;
+				}
+				break;
+			case 'c': config.color = atoi(optarg); break;
+			case 't': config.time_limit = atof(optarg); break;
+			case 'o': csv_path = optarg; break;
+			case 'F':
+				if(!alpha_pkg::loadFaultConfig(optarg, config.faults, error)){
+					fprintf(stderr, "%s\n", error.c_str());
+					return 1;
+				}
+				break;
+			case 'R':
+				config.track_target = true;
+				config.check_tracking = true;
+				config.tracker.full_scan_period = atoi(optarg);
+				break;
+			case 'P':
+				config.pyramid_search = true;
+				config.check_tracking = true;
+				break;
+			case 'T': config.controller.contact_time = atof(optarg); break;
+			case 'M':
+				config.detect_motion = true;
+				config.controller.wait_time = atof(optarg);
+				break;
+			case 'D': dump_dir = optarg; break;
+			default: usage(argv[0]); return 1;
+		}
+	}
+	if(optind != argc || count <= 0 || config.color < 0 || config.color > 1){
+		usage(argv[0]);
+		return 1;
+	}
+	workers = workers > 0 ? workers : 1;
+
+	alpha_pkg::ColorTable colors;
+	if(!colors.load(colors_path, error)){
+		fprintf(stderr, "%s\n", error.c_str());
+		return 1;
+	}
+	if(dump_dir && !dumpFrames(dump_dir, config, count, error)){
+		fprintf(stderr, "%s\n", error.c_str());
+		return 1;
+	}
+
+	std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+	std::vector<alpha_pkg::SimResult> results(count);
+	std::atomic<int> next(0);
+	std::vector<std::thread> threads;
+	for(int w = 0; w < workers; w++){
+		threads.push_back(std::thread(worker, std::cref(config), std::cref(colors), std::ref(next), count, std::ref(results)));
+	}
+	for(size_t w = 0; w < threads.size(); w++){
+		threads[w].join();
+	}
+	double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+	FILE* csv = csv_path ? fopen(csv_path, "w") : NULL;
+	if(csv_path && !csv){
+		fprintf(stderr, "cannot create %s\n", csv_path);
+		return 1;
+	}
+	if(csv){
+		fprintf(csv, "index,seed,lighting,success,goal_declared,time_to_goal,target_distance,bumper_hits,distance,steps,goal_steps,obstacle_steps\n");
+	}
+
+	Summary total, per_lighting[alpha_pkg::NUM_LIGHTING_PROFILES];
+	alpha_pkg::ScenarioParams params = alpha_pkg::defaultScenarioParams();
+	long steps = 0, full_scans = 0, reference_goals = 0, tracked_goals = 0, limited_steps = 0;
+	long moving_steps = 0, waiting_steps = 0;
+	double pixels = 0, window_pixels = 0;
+	for(int i = 0; i < count; i++){
+		const alpha_pkg::SimResult& result = results[i];
+		alpha_pkg::LightingProfile lighting = alpha_pkg::generateScenario(result.seed, params).lighting;
+		bool success = alpha_pkg::simSucceeded(result, config);
+		Summary* sums[2] = {&total, &per_lighting[lighting]};
+		for(int k = 0; k < 2; k++){
+			sums[k]->runs++;
+			sums[k]->declared += result.goal_declared;
+			sums[k]->successes += success;
+			sums[k]->time_to_goal += success ? result.time_to_goal : 0;
+			sums[k]->bumper_hits += result.bumper_hits;
+			sums[k]->distance += result.distance;
+		}
+		steps += result.steps;
+		pixels += result.segmented_pixels;
+		window_pixels += result.window_pixels;
+		full_scans += result.full_scans;
+		reference_goals += result.reference_goals;
+		tracked_goals += result.tracked_goals;
+		limited_steps += result.limited_steps;
+		moving_steps += result.moving_steps;
+		waiting_steps += result.waiting_steps;
+		if(csv){
+			fprintf(csv, "%d,%016llx,%s,%d,%d,%.1f,%.3f,%d,%.3f,%d,%d,%d\n", i, (unsigned long long)result.seed,
+					alpha_pkg::lightingInfo(lighting).name, success, result.goal_declared, result.time_to_goal,
+					result.target_distance, result.bumper_hits, result.distance, result.steps,
+					result.goal_steps, result.obstacle_steps);
+		}
+	}
+	if(csv){
+		fclose(csv);
+	}
+
+	printf("%d scenarios, %ld control steps in %.1f s on %d workers (%.0f steps/s)\n",
+		   count, steps, elapsed, workers, steps/elapsed);
+	printf("  %-18s %5s %8s %8s %9s %8s %8s\n", "lighting", "runs", "success", "declared", "time [s]", "bumps", "dist [m]");
+	for(int i = 0; i < alpha_pkg::NUM_LIGHTING_PROFILES; i++){
+		printSummary(alpha_pkg::lightingInfo(static_cast<alpha_pkg::LightingProfile>(i)).name, per_lighting[i]);
+	}
+	printSummary("all", total);
+	if(config.controller.contact_time > 0){
+		printf("speed capped for a %.1f s time to contact in %.1f%% of the steps\n",
+			   config.controller.contact_time, 100.0*limited_steps/steps);
+	}
+	if(config.detect_motion){
+		printf("moving obstacle flagged in %.2f%% of the steps, stopped waiting in %.2f%%\n",
+			   100.0*moving_steps/steps, 100.0*waiting_steps/steps);
+	}
+	if(config.check_tracking){
+		const double frame_pixels = alpha_pkg::kImageWidth*alpha_pkg::kImageHeight;
+		long windows = steps - full_scans;
+		printf("segmentation: %.0f px/frame (%.1f%% of full); %.1f%% of the frames in a window of %.0f px on average\n",
+			   pixels/steps, 100.0*pixels/steps/frame_pixels, 100.0*windows/steps,
+			   windows ? window_pixels/windows : 0.0);
+		printf("goal recall against a full scan: %.2f%% (%ld of %ld frames)\n",
+			   reference_goals ? 100.0*tracked_goals/reference_goals : 100.0, tracked_goals, reference_goals);
+	}
+	return 0;
+}